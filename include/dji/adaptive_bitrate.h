@@ -0,0 +1,169 @@
+/**
+ * @file adaptive_bitrate.h
+ * @brief Adapts a running stream's bitrate and resolution to the uplink.
+ *
+ * AdaptiveBitrateController feeds StreamingStatus telemetry and the BLE link
+ * health score to a pluggable BitratePolicy and re-configures the live stream
+ * when the policy asks for other settings, at most once per cooldown period.
+ */
+
+#ifndef DJI_ADAPTIVE_BITRATE_H
+#define DJI_ADAPTIVE_BITRATE_H
+
+#include "dji/constants.h"
+#include "dji/scheduler.h"
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <functional>
+#include <memory>
+
+namespace dji {
+
+class Device;
+
+struct StreamSettings {
+    Resolution resolution = Resolution::Res1080p;
+    uint16_t bitrateKbps = 4000;
+    FPS fps = FPS::FPS25;
+
+    bool operator==(const StreamSettings &other) const {
+        return resolution == other.resolution && bitrateKbps == other.bitrateKbps &&
+               fps == other.fps;
+    }
+    bool operator!=(const StreamSettings &other) const {
+        return !(*this == other);
+    }
+};
+
+struct StreamTelemetry {
+    // Throughput the camera reports pushing to the ingest server; -1 if unknown.
+    int deliveredKbps = -1;
+    // LinkHealthMonitor score of the BLE link.
+    int linkScore = 100;
+};
+
+/**
+ * @brief Decides the stream settings from telemetry samples.
+ *
+ * Policies may keep state between samples (e.g. for hysteresis); reset() is
+ * called whenever the controller starts.
+ */
+class BitratePolicy {
+public:
+    virtual ~BitratePolicy() = default;
+
+    // ceiling: the settings the stream was started with, the best allowed.
+    virtual void reset(const StreamSettings &ceiling) = 0;
+    // Returns the settings to run next; returning current keeps them.
+    virtual StreamSettings decide(const StreamSettings &current,
+                                  const StreamTelemetry &telemetry) = 0;
+};
+
+/**
+ * @brief Steps along a ladder of settings.
+ *
+ * Drops straight to the best rung the delivered throughput sustains after
+ * downgradeAfter consecutive samples below downgradeRatio of the bitrate, and
+ * climbs one rung at a time after upgradeAfter consecutive good samples, which
+ * is the hysteresis. An upgrade that has to be undone before it was confirmed
+ * by upgradeAfter good samples doubles the wait for the next one (up to
+ * maxUpgradeBackoff times), so a ceiling in the uplink does not cause flapping.
+ * No upgrade is attempted while the BLE link scores below
+ * minLinkScoreToUpgrade: a congested 2.4 GHz band tends to hurt both radios.
+ */
+class LadderBitratePolicy : public BitratePolicy {
+public:
+    struct Options {
+        double downgradeRatio = 0.85;
+        int downgradeAfter = 3;
+        int upgradeAfter = 20;
+        int maxUpgradeBackoff = 16;
+        int minLinkScoreToUpgrade = 70;
+    };
+
+    explicit LadderBitratePolicy(const QList<StreamSettings> &ladder = defaultLadder());
+    LadderBitratePolicy(const QList<StreamSettings> &ladder, const Options &options);
+
+    // Best first. The frame rate of the ceiling is kept on every rung.
+    static QList<StreamSettings> defaultLadder();
+
+    void reset(const StreamSettings &ceiling) override;
+    StreamSettings decide(const StreamSettings &current, const StreamTelemetry &telemetry) override;
+
+    QList<StreamSettings> rungs() const {
+        return m_rungs;
+    }
+
+private:
+    QList<StreamSettings> m_ladder;
+    Options m_options;
+    QList<StreamSettings> m_rungs;
+    int m_badSamples = 0;
+    int m_goodSamples = 0;
+    int m_upgradeAfter = 0;
+    // Set after an upgrade until upgradeAfter good samples confirm it.
+    bool m_probing = false;
+    int m_probeSamples = 0;
+};
+
+class AdaptiveBitrateController : public QObject {
+    Q_OBJECT
+public:
+    using TelemetryDecoder = std::function<StreamTelemetry(const QByteArray &payload)>;
+
+    explicit AdaptiveBitrateController(Device *device, QObject *parent = nullptr);
+    ~AdaptiveBitrateController() override;
+
+    // Takes ownership. Defaults to a LadderBitratePolicy.
+    void setPolicy(std::unique_ptr<BitratePolicy> policy);
+    // Replaces the StreamingStatus decoder, e.g. for firmware with another layout.
+    void setTelemetryDecoder(TelemetryDecoder decoder);
+    // Bytes 2-3 of StreamingStatus, little endian; inferred from captures.
+    static StreamTelemetry decodeStreamingStatus(const QByteArray &payload);
+
+    // Cap on the reconfiguration rate. The cooldown starts with each
+    // reconfiguration, not with start(); samples are not evaluated during it,
+    // since they still reflect the previous settings.
+    void setMinReconfigureInterval(int ms) {
+        m_minReconfigureIntervalMs = ms;
+    }
+    int minReconfigureInterval() const {
+        return m_minReconfigureIntervalMs;
+    }
+
+    void start(const StreamSettings &ceiling);
+    void stop();
+    bool isRunning() const {
+        return m_running;
+    }
+    StreamSettings settings() const {
+        return m_settings;
+    }
+    int reconfigureCount() const {
+        return m_reconfigureCount;
+    }
+
+    // Evaluates one sample; StreamingStatus pushes arrive here when running.
+    void onTelemetry(const StreamTelemetry &telemetry);
+
+signals:
+    void settingsChanged(const StreamSettings &settings, int deliveredKbps);
+    void log(const QString &message);
+
+private:
+    void onStreamingStatus(const QByteArray &payload);
+
+    Device *m_device;
+    std::unique_ptr<BitratePolicy> m_policy;
+    TelemetryDecoder m_decoder;
+    StreamSettings m_settings;
+    ElapsedTimer m_lastReconfigure;
+    int m_minReconfigureIntervalMs = 10000;
+    int m_reconfigureCount = 0;
+    bool m_running = false;
+};
+
+} // namespace dji
+
+#endif // DJI_ADAPTIVE_BITRATE_H
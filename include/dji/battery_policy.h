@@ -0,0 +1,82 @@
+/**
+ * @file battery_policy.h
+ * @brief Battery history, time-to-empty prediction and threshold actions.
+ */
+
+#ifndef DJI_BATTERY_POLICY_H
+#define DJI_BATTERY_POLICY_H
+
+#include <QList>
+#include <QtGlobal>
+
+namespace dji {
+
+enum class BatteryAction {
+    // Only emit DeviceManager::batteryThresholdReached().
+    Alert,
+    // Halve the stream bitrate (not below 600 kbps).
+    LowerBitrate,
+    // Drop to 25 fps.
+    LowerFrameRate,
+    StopStreaming,
+};
+
+/**
+ * @brief Fires once when the battery is at or below percentage, or when the
+ * predicted time to empty is at or below minutesToEmpty; -1 disables either
+ * condition. It re-arms once the battery is clearly above percentage again.
+ */
+struct BatteryThreshold {
+    int percentage = -1;
+    int minutesToEmpty = -1;
+    BatteryAction action = BatteryAction::Alert;
+};
+
+struct BatteryPolicy {
+    QList<BatteryThreshold> thresholds;
+    // Discharge rate is estimated over this much history.
+    int historyWindowMs = 10 * 60 * 1000;
+};
+
+/**
+ * @brief Battery readings of one device over time.
+ *
+ * The camera reports whole percents, so only changes are stored. The
+ * discharge rate is the least-squares slope over the window, which smooths
+ * out readings that bounce under changing load.
+ */
+class BatteryHistory {
+public:
+    struct Sample {
+        qint64 timeMs;
+        int percentage;
+    };
+
+    void addSample(qint64 timeMs, int percentage);
+    void setWindow(int windowMs) {
+        m_windowMs = windowMs;
+    }
+    void clear() {
+        m_samples.clear();
+    }
+
+    // -1 before the first reading.
+    int percentage() const {
+        return m_samples.isEmpty() ? -1 : m_samples.last().percentage;
+    }
+    QList<Sample> samples() const {
+        return m_samples;
+    }
+    // Percent per minute; positive while discharging, 0 while unknown.
+    double dischargeRatePerMinute() const;
+    // -1 while unknown or not discharging.
+    qint64 timeToEmptyMs() const;
+
+private:
+    QList<Sample> m_samples;
+    int m_windowMs = 10 * 60 * 1000;
+};
+
+} // namespace dji
+
+#endif // DJI_BATTERY_POLICY_H
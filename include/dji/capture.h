@@ -0,0 +1,58 @@
+/**
+ * @file capture.h
+ * @brief Qt-free format of recorded DUML traffic.
+ *
+ * A capture is the 8-byte magic "DJICAP1\n" followed by records. A record is
+ * an 11-byte header, the little-endian timestamp in microseconds (8 bytes),
+ * the device index (2 bytes) and the direction (1 byte), followed by one
+ * complete frame. Frames carry their own length and CRCs, so a reader that
+ * starts anywhere in a capture can find the next record with findRecord().
+ * CaptureRecorder writes captures; tools/capture_analyze.cpp reads them.
+ */
+
+#ifndef DJI_CAPTURE_H
+#define DJI_CAPTURE_H
+
+#include "dji/protocol.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace dji::capture {
+
+constexpr char magic[] = "DJICAP1\n";
+constexpr size_t magicSize = sizeof(magic) - 1;
+constexpr size_t recordHeaderSize = 11;
+constexpr size_t maxRecordSize = recordHeaderSize + protocol::maxFrameSize;
+
+enum class Direction : uint8_t {
+    Received = 0,
+    Sent = 1,
+};
+
+struct Record {
+    uint64_t timestampUs = 0;
+    uint16_t device = 0;
+    Direction direction = Direction::Received;
+    protocol::FrameView frame;
+    // Header and frame.
+    size_t size = 0;
+};
+
+// True if data starts with the capture magic.
+bool hasMagic(const uint8_t *data, size_t size);
+
+// Writes the record header for a frame into out, which holds at least
+// recordHeaderSize bytes.
+void writeRecordHeader(uint64_t timestampUs, uint16_t device, Direction direction, uint8_t *out);
+
+// Reads the record at the start of data and returns its size, or 0 if no
+// valid record starts there or it is cut off.
+size_t readRecord(const uint8_t *data, size_t size, Record *record);
+
+// Offset of the first valid record in data, or size if there is none. A
+// record cut off by the end of data is not found.
+size_t findRecord(const uint8_t *data, size_t size);
+
+} // namespace dji::capture
+
+#endif // DJI_CAPTURE_H
@@ -0,0 +1,62 @@
+/**
+ * @file capture_recorder.h
+ * @brief Records the frames of one or more devices into a capture.
+ *
+ * The recorder listens to the devices it is attached to and writes every
+ * frame they send or receive, in the format of capture.h, to a QIODevice.
+ * Timestamps count from the construction of the recorder on the library
+ * clock, so they are virtual under a VirtualScheduler. Devices may live on
+ * different threads; records are written whole, one at a time.
+ */
+
+#ifndef DJI_CAPTURE_RECORDER_H
+#define DJI_CAPTURE_RECORDER_H
+
+#include "dji/capture.h"
+#include "dji/device_listener.h"
+#include "dji/scheduler.h"
+#include <QList>
+#include <QMutex>
+#include <QPointer>
+
+class QIODevice;
+
+namespace dji {
+
+class CaptureRecorder : public DeviceListener {
+public:
+    // Writes the capture magic to output, which must be open for writing and
+    // outlive the recorder.
+    explicit CaptureRecorder(QIODevice *output);
+    ~CaptureRecorder() override;
+
+    CaptureRecorder(const CaptureRecorder &) = delete;
+    CaptureRecorder &operator=(const CaptureRecorder &) = delete;
+
+    // Starts recording device and returns its index in the capture.
+    // Attaching a device again returns the index it already has.
+    int attach(Device *device);
+    void detach(Device *device);
+
+    quint64 recordCount() const;
+    // Records that could not be written in full.
+    quint64 writeErrors() const;
+
+    void messageReceived(Device *device, const Message &msg) override;
+    void messageSent(Device *device, const Message &msg) override;
+
+private:
+    void record(Device *device, capture::Direction direction, const Message &msg);
+
+    QIODevice *m_output;
+    ElapsedTimer m_clock;
+    mutable QMutex m_mutex;
+    // Index in the capture; detached devices keep theirs, as nullptr.
+    QList<QPointer<Device>> m_devices;
+    quint64 m_records = 0;
+    quint64 m_writeErrors = 0;
+};
+
+} // namespace dji
+
+#endif // DJI_CAPTURE_RECORDER_H
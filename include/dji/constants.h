@@ -1,8 +1,7 @@
 #ifndef DJI_CONSTANTS_H
 #define DJI_CONSTANTS_H
 
-#include <QByteArray>
-#include <QString>
+#include <cstddef>
 #include <cstdint>
 
 namespace dji {
@@ -90,8 +89,9 @@ inline uint8_t deviceTypeToStabilizationByte(DeviceType t) {
     }
 }
 
-inline DeviceType identifyDeviceType(const QByteArray &manufacturerData) {
-    if (manufacturerData.size() < 2)
+// From the manufacturer data (company 0x08AA) of the advertisement.
+inline DeviceType identifyDeviceType(const uint8_t *manufacturerData, size_t size) {
+    if (size < 2)
         return DeviceType::Undefined;
 
     if (manufacturerData[0] == 0x12 && manufacturerData[1] == 0x00)
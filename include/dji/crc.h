@@ -1,14 +1,14 @@
 #ifndef DJI_CRC_H
 #define DJI_CRC_H
 
-#include <QByteArray>
+#include <QByteArrayView>
 #include <cstdint>
 
 namespace dji {
 
-uint8_t crc8(const QByteArray &data);
+uint8_t crc8(QByteArrayView data);
 
-uint16_t crc16(const QByteArray &data);
+uint16_t crc16(QByteArrayView data);
 
 } // namespace dji
 
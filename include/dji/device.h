@@ -6,17 +6,31 @@
 #ifndef DJI_DEVICE_H
 #define DJI_DEVICE_H
 
+#include "dji/device_listener.h"
+#include "dji/frame_pool.h"
 #include "dji/message.h"
+#include "dji/unknown_message_profiler.h"
 #include <QBluetoothDeviceInfo>
+#include <QList>
+#include <QLowEnergyConnectionParameters>
 #include <QLowEnergyController>
 #include <QLowEnergyService>
 #include <QObject>
+#include <memory>
 
 namespace dji {
 
 class SubsystemPairer;
 class SubsystemStreamer;
 class SubsystemConfigurer;
+class LinkHealthMonitor;
+
+// BLE connection parameter sets a Device can ask the central to use.
+enum class ConnectionProfile {
+    Balanced,   // 30-50 ms interval, roughly what centrals pick on their own
+    LowLatency, // 7.5-15 ms, for the request/response bursts of provisioning
+    LowPower,   // 100-125 ms with slave latency, for a stream that runs on its own
+};
 
 class Device : public QObject {
     Q_OBJECT
@@ -58,9 +72,47 @@ public:
         return m_deviceInfo;
     }
 
+    QBluetoothAddress localAdapter() const {
+        return m_localAdapter;
+    }
+    void setLocalAdapter(const QBluetoothAddress &adapter) {
+        m_localAdapter = adapter;
+    }
+
     virtual bool isConnected() const;
     virtual bool isInitialized() const;
 
+    // Negotiated ATT MTU; writes are split into pieces of mtu() - 3 bytes.
+    int mtu() const {
+        return m_mtu;
+    }
+    static constexpr int defaultMtu = 23;
+    static QList<QByteArray> splitForMtu(const QByteArray &frame, int mtu);
+    // Messages handed to messageReceived().
+    const FramePool &framePool() const {
+        return m_framePool;
+    }
+
+    // Tallies received frames of unknown types; off by default. Turning it
+    // off drops what was collected.
+    void setUnknownMessageProfiling(bool enabled);
+    // nullptr while profiling is off. May be called and read from any
+    // thread; a profiler that was handed out stays valid after profiling is
+    // turned off, it just stops receiving frames.
+    std::shared_ptr<UnknownMessageProfiler> unknownMessageProfiler() const;
+
+    // Requested now if connected, otherwise as soon as the link comes up.
+    // The central may pick different values; see connectionParameters().
+    void requestConnectionProfile(ConnectionProfile profile);
+    ConnectionProfile connectionProfile() const {
+        return m_connectionProfile;
+    }
+    // Effective parameters as last reported by the controller.
+    QLowEnergyConnectionParameters connectionParameters() const {
+        return m_connectionParameters;
+    }
+    static QLowEnergyConnectionParameters parametersFor(ConnectionProfile profile);
+
     SubsystemPairer *pairer() {
         return m_pairer;
     }
@@ -70,6 +122,34 @@ public:
     SubsystemConfigurer *configurer() {
         return m_configurer;
     }
+    LinkHealthMonitor *linkHealth() {
+        return m_linkHealth;
+    }
+
+    // Asks the controller for the RSSI; the answer arrives as rssiRead().
+    virtual void readRssi();
+
+    // Listeners are not owned; remove one before destroying it. Adding or
+    // removing one from a callback takes effect from the next event.
+    void addListener(DeviceListener *listener);
+    void removeListener(DeviceListener *listener);
+    // Calls callback(listener) for every listener; used by the subsystems.
+    template <typename Callback>
+    void notifyListeners(Callback &&callback) {
+        if (m_listeners.isEmpty())
+            return;
+        ++m_notifying;
+        const qsizetype count = m_listeners.size();
+        for (qsizetype i = 0; i < count; ++i) {
+            if (DeviceListener *listener = m_listeners.at(i)) {
+                callback(listener);
+            }
+        }
+        if (--m_notifying == 0 && m_listenersRemoved) {
+            m_listeners.removeAll(nullptr);
+            m_listenersRemoved = false;
+        }
+    }
 
 signals:
     void connected();
@@ -79,6 +159,9 @@ signals:
     void log(const QString &message);
 
     void messageReceived(const Message &msg);
+    void rssiRead(int rssi);
+    void connectionProfileChanged(dji::ConnectionProfile profile);
+    void connectionParametersUpdated(const QLowEnergyConnectionParameters &parameters);
     void nameChanged();
     void addressChanged();
     void deviceTypeChanged();
@@ -87,6 +170,8 @@ private slots:
     void onControllerConnected();
     void onControllerDisconnected();
     void onControllerError(QLowEnergyController::Error error);
+    void onMtuChanged(int mtu);
+    void onConnectionUpdated(const QLowEnergyConnectionParameters &parameters);
     void onServiceDiscovered(const QBluetoothUuid &newService);
     void onServiceDiscoveryFinished();
     void onServiceStateChanged(QLowEnergyService::ServiceState newState);
@@ -97,13 +182,23 @@ private slots:
 protected:
     void discoverCharacteristics();
     void receiveNotification(const QByteArray &data);
+    // Bytes to drop from the front of data: a frame, parsed into *parsed, noise
+    // before a start byte, or a false start byte. 0 when the frame at the
+    // front is still incomplete.
+    qsizetype takeFrame(QByteArrayView data, bool logging, Message **parsed);
+    // Hands a received frame to the listeners, then emits messageReceived().
+    void deliverMessage(const Message &msg);
+    // Accounts for a frame handed to the link.
+    void notifyMessageSent(const Message &msg);
 
     SubsystemPairer *m_pairer;
     SubsystemStreamer *m_streamer;
     SubsystemConfigurer *m_configurer;
+    LinkHealthMonitor *m_linkHealth;
     DeviceType m_deviceType = DeviceType::Unknown;
 
     QBluetoothDeviceInfo m_deviceInfo;
+    QBluetoothAddress m_localAdapter;
     QLowEnergyController *m_controller = nullptr;
     QLowEnergyService *m_service = nullptr;
 
@@ -111,6 +206,20 @@ protected:
     QLowEnergyCharacteristic m_charSender;
     QLowEnergyCharacteristic m_charPairingRequestor;
 
+    // Notifications may carry part of a frame, or several frames.
+    QByteArray m_rxBuffer;
+    FramePool m_framePool;
+    // Replaced on the thread of the device, loaded atomically elsewhere.
+    std::shared_ptr<UnknownMessageProfiler> m_unknownMessageProfiler;
+    QList<DeviceListener *> m_listeners;
+    // Removed while notifying; nulled, and dropped once notifying is done.
+    int m_notifying = 0;
+    bool m_listenersRemoved = false;
+    int m_mtu = defaultMtu;
+    ConnectionProfile m_connectionProfile = ConnectionProfile::Balanced;
+    // Balanced is only requested explicitly when switching back to it.
+    bool m_connectionProfileRequested = false;
+    QLowEnergyConnectionParameters m_connectionParameters;
     bool m_initialized = false;
 };
 
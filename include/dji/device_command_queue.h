@@ -0,0 +1,109 @@
+/**
+ * @file device_command_queue.h
+ * @brief Thread-safe command submission and state snapshots for a DeviceManager.
+ *
+ * DeviceManager is a plain QObject and must only be touched from the thread it
+ * lives on. DeviceCommandQueue can be called from any thread (REST handlers,
+ * automation scripts, ...): commands go through a lock-free multi-producer
+ * queue and are executed on the manager's thread, each returning a QFuture that
+ * completes with the outcome. Readers get an immutable snapshot of the
+ * per-device state that is republished on the owner thread on every change.
+ */
+
+#ifndef DJI_DEVICE_COMMAND_QUEUE_H
+#define DJI_DEVICE_COMMAND_QUEUE_H
+
+#include "dji/device_manager.h"
+#include "dji/mpsc_queue.h"
+#include <QFuture>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPromise>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace dji {
+
+class Device;
+class DeviceFlow;
+
+struct DeviceStateSnapshot {
+    Device *device = nullptr;
+    QString address;
+    bool isPaired = false;
+    bool isWiFiConnected = false;
+    bool isStreaming = false;
+    bool hasActiveFlow = false;
+};
+
+struct DeviceManagerSnapshot {
+    quint64 generation = 0;
+    QList<DeviceStateSnapshot> devices;
+
+    const DeviceStateSnapshot *find(Device *dev) const {
+        for (const DeviceStateSnapshot &s : devices) {
+            if (s.device == dev)
+                return &s;
+        }
+        return nullptr;
+    }
+};
+
+class DeviceCommandQueue : public QObject {
+    Q_OBJECT
+public:
+    // Must be created on the thread owning the manager (or before the manager is moved).
+    explicit DeviceCommandQueue(DeviceManager *manager, QObject *parent = nullptr);
+    ~DeviceCommandQueue() override;
+
+    using FlowFactory = std::function<DeviceFlow *()>;
+
+    // Any thread. The futures complete with the flow result, or false when the
+    // flow was superseded, stopped or the device was not added to the manager.
+    QFuture<bool> connectToWiFiAndStartStreaming(Device *dev, const StreamingOptions &options);
+    // makeFlow runs on the owner thread, so the flow is born there; it is not
+    // called for an unknown device.
+    QFuture<bool> runFlow(Device *dev, FlowFactory makeFlow);
+    QFuture<bool> stop();
+
+    // Any thread, wait-free for the owner: readers only load a shared pointer.
+    std::shared_ptr<const DeviceManagerSnapshot> snapshot() const;
+
+private:
+    using Promise = std::shared_ptr<QPromise<bool>>;
+
+    struct Command {
+        enum class Type { None, StartStreaming, RunFlow, Stop };
+        Type type = Type::None;
+        Device *device = nullptr;
+        FlowFactory makeFlow;
+        StreamingOptions options;
+        Promise promise;
+    };
+
+    QFuture<bool> submit(Command command);
+    void drain();
+    void execute(Command &command);
+    void track(Device *dev, const Promise &promise);
+    void complete(Device *dev, bool success);
+    void failPending(Device *dev);
+    void publishSnapshot();
+
+    static void resolve(const Promise &promise, bool success);
+
+    DeviceManager *m_manager;
+    MpscQueue<Command> m_commands;
+    std::atomic<bool> m_drainScheduled{false};
+
+    // Owner thread only.
+    QHash<Device *, Promise> m_pending;
+
+    std::shared_ptr<const DeviceManagerSnapshot> m_snapshot;
+    quint64 m_generation = 0;
+};
+
+} // namespace dji
+
+#endif // DJI_DEVICE_COMMAND_QUEUE_H
@@ -0,0 +1,99 @@
+/**
+ * @file device_event_bus.h
+ * @brief Coalesces high-frequency device events into one batch per UI tick.
+ *
+ * Every signal of DeviceManager and its devices is its own event-loop post when
+ * the receiver lives on another thread. The bus collects them instead and hands
+ * the UI a single DeviceEventBatch per tick, keeping only the latest value for
+ * state-like events (pairing, WiFi, streaming, battery).
+ */
+
+#ifndef DJI_DEVICE_EVENT_BUS_H
+#define DJI_DEVICE_EVENT_BUS_H
+
+#include "dji/message.h"
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QPointer>
+#include <QSet>
+#include <QStringList>
+
+namespace dji {
+
+class Device;
+class DeviceManager;
+class Timer;
+
+struct DeviceEventBatch {
+    struct DeviceUpdate {
+        Device *device = nullptr;
+        bool isPaired = false;
+        bool isWiFiConnected = false;
+        bool isStreaming = false;
+        bool stateChanged = false;
+        int batteryPercentage = -1;
+        int messagesReceived = 0;
+        Message lastMessage;
+    };
+
+    QList<DeviceUpdate> devices;
+    QStringList logs;
+    QStringList errors;
+    QList<QPair<Device *, bool>> finished;
+    int droppedLogs = 0;
+
+    bool isEmpty() const {
+        return devices.isEmpty() && logs.isEmpty() && errors.isEmpty() && finished.isEmpty() &&
+               droppedLogs == 0;
+    }
+};
+
+class DeviceEventBus : public QObject {
+    Q_OBJECT
+public:
+    static constexpr int defaultTickRateHz = 30;
+    static constexpr int defaultMaxLogsPerBatch = 256;
+
+    explicit DeviceEventBus(DeviceManager *manager, QObject *parent = nullptr);
+
+    void setTickRate(int hz);
+    int tickRate() const {
+        return m_tickRateHz;
+    }
+
+    void setMaxLogsPerBatch(int max) {
+        m_maxLogsPerBatch = max;
+    }
+    int maxLogsPerBatch() const {
+        return m_maxLogsPerBatch;
+    }
+
+    void flush();
+
+signals:
+    void batchReady(const DeviceEventBatch &batch);
+
+private slots:
+    void attachDevices();
+
+private:
+    void attachDevice(Device *dev);
+    DeviceEventBatch::DeviceUpdate &pendingUpdate(Device *dev);
+    void appendLog(const QString &message);
+    void schedule();
+
+    QPointer<DeviceManager> m_manager;
+    Timer *m_timer;
+    int m_tickRateHz = defaultTickRateHz;
+    int m_maxLogsPerBatch = defaultMaxLogsPerBatch;
+
+    QSet<Device *> m_attached;
+    QHash<Device *, DeviceEventBatch::DeviceUpdate> m_pendingDevices;
+    DeviceEventBatch m_pending;
+};
+
+} // namespace dji
+
+#endif // DJI_DEVICE_EVENT_BUS_H
@@ -2,11 +2,13 @@
 #define DJI_DEVICE_FLOW_H
 
 #include "dji/device_manager.h"
+#include <QList>
 #include <QObject>
 
 namespace dji {
 
 class Device;
+class Timer;
 
 /**
  * @brief Abstract base class for device operation flows.
@@ -25,8 +27,34 @@ signals:
     void log(const QString &msg);
 };
 
+/**
+ * @brief Camera-side steps a StreamingStarter has already completed.
+ *
+ * Pairing is not listed: it belongs to the BLE session and is redone after
+ * every (re)connection, whereas these survive a dropped link.
+ */
+struct StreamingProgress {
+    bool isPrepared = false;
+    bool isWiFiConnected = false;
+    bool isStreaming = false;
+};
+
 /**
  * @brief Concrete flow for pairing, connecting to WiFi, and starting a live stream.
+ *
+ * After pairing, the flow probes what the camera already does and turns the
+ * remaining work into a plan of only the missing steps. Progress seeded with
+ * setProgress() (e.g. what DeviceManager knows) is trusted for preparation and
+ * WiFi, which the protocol cannot query; a stream believed to be running is
+ * confirmed by a StreamingStatus push within StreamingOptions::probeTimeoutMs.
+ * A camera seen streaming recently skips every step if the stream was started
+ * with the same settings; otherwise only the stream is configured and
+ * started again, with WiFi as seeded. If the BLE link drops mid-flow, the
+ * flow waits for the device to come back, re-pairs and plans again.
+ *
+ * Given several StreamingOptions::wifiNetworks, joining WiFi is preceded by a
+ * scan; the candidates are tried strongest first, and a rejected join moves on
+ * to the next one instead of failing the flow.
  */
 class StreamingStarter : public DeviceFlow {
     Q_OBJECT
@@ -36,17 +64,58 @@ public:
     void start(Device *dev) override;
     void stop() override;
 
+    void setProgress(const StreamingProgress &progress) {
+        m_progress = progress;
+    }
+    StreamingProgress progress() const {
+        return m_progress;
+    }
+
 private slots:
     void onInitialized();
+    void onDisconnected();
     void onPairingComplete();
+    void onStreamingStatus();
+    void onProbeTimeout();
+    void onWifiNetworksChanged();
+    void onScanTimeout();
     void onWifiConnected();
+    void onWifiConnectFailed(const QString &reason);
     void onPrepareComplete();
     void onStartComplete();
     void onError(const QString &msg);
 
 private:
+    enum class Step {
+        Idle,
+        Connecting,
+        Pairing,
+        Probing,
+        Preparing,
+        ScanningWiFi,
+        ConnectingWiFi,
+        Starting,
+        Done
+    };
+
+    void probe();
+    bool isStreamingWithOptions() const;
+    void plan();
+    void advance();
+    QList<WiFiCredentials> wifiCandidates() const;
+    bool scanCoversCandidates() const;
+    void finishScan();
+    void joinNextWiFi();
+
     Device *m_device = nullptr;
     StreamingOptions m_options;
+    StreamingProgress m_progress;
+    Step m_step = Step::Idle;
+    QList<Step> m_plan;
+    Timer *m_probeTimer;
+    Timer *m_scanTimer;
+    // Networks still to try, best first.
+    QList<WiFiCredentials> m_wifiQueue;
 };
 
 } // namespace dji
@@ -0,0 +1,45 @@
+/**
+ * @file device_listener.h
+ * @brief Direct-call hooks into the protocol events of a Device.
+ *
+ * The signals of Device and its subsystems stay the convenient way to follow
+ * a camera from UI code. Code on the protocol path, such as recorders and
+ * metrics, can implement DeviceListener instead: its callbacks are plain
+ * virtual calls on the thread of the device, made just before the matching
+ * signal. Arguments are only valid during the call.
+ */
+
+#ifndef DJI_DEVICE_LISTENER_H
+#define DJI_DEVICE_LISTENER_H
+
+#include "dji/message.h"
+#include <QByteArrayView>
+
+namespace dji {
+
+class Device;
+
+class DeviceListener {
+public:
+    virtual ~DeviceListener() = default;
+
+    // A BLE notification as it arrived, before frames are reassembled.
+    virtual void notificationReceived(Device * /*device*/, QByteArrayView /*data*/) {
+    }
+    // Every received frame, before Device::messageReceived().
+    virtual void messageReceived(Device * /*device*/, const Message & /*msg*/) {
+    }
+    // Every frame handed to the link.
+    virtual void messageSent(Device * /*device*/, const Message & /*msg*/) {
+    }
+    // Before SubsystemStreamer::streamingStatusReceived().
+    virtual void streamingStatusReceived(Device * /*device*/, QByteArrayView /*payload*/) {
+    }
+    // Before SubsystemStreamer::batteryPercentageChanged().
+    virtual void batteryPercentageChanged(Device * /*device*/, int /*percentage*/) {
+    }
+};
+
+} // namespace dji
+
+#endif // DJI_DEVICE_LISTENER_H
@@ -9,8 +9,15 @@
 #ifndef DJI_DEVICE_MANAGER_H
 #define DJI_DEVICE_MANAGER_H
 
+#include "dji/battery_policy.h"
 #include "dji/constants.h"
+#include "dji/scheduler.h"
+#include "dji/slot_map.h"
+#include "dji/wifi_scan.h"
+#include <QBluetoothAddress>
 #include <QBluetoothDeviceInfo>
+#include <QHash>
+#include <QList>
 #include <QObject>
 #include <QString>
 
@@ -18,8 +25,16 @@ class QBluetoothDeviceDiscoveryAgent;
 
 namespace dji {
 
+class AdaptiveBitrateController;
 class Device;
 class DeviceFlow;
+class FleetOperation;
+struct FleetOptions;
+struct StreamSettings;
+
+// Stable reference to a managed device; stops resolving once the device is
+// taken or destroyed, even if its slot is reused by a later device.
+using DeviceHandle = SlotHandle;
 
 struct DiscoveryOptions {
     QString deviceAddrFilter;
@@ -29,10 +44,59 @@ struct DiscoveryOptions {
 struct StreamingOptions {
     QString ssid;
     QString psk;
+    // Ranked alternatives to ssid/psk. With more than one, the flow scans,
+    // joins the strongest network heard and falls back to the next one when
+    // the camera rejects a join.
+    QList<WiFiCredentials> wifiNetworks;
+    // How long a scan may take before the networks heard so far are ranked.
+    int wifiScanTimeoutMs = 3000;
     QString rtmpUrl;
+    // When set, a stream that stops reporting for failoverAfterMs while the
+    // BLE link is healthy is switched to this URL (and back again, should
+    // the backup fail too).
+    QString backupRtmpUrl;
+    int failoverAfterMs = 5000;
+    // Let an AdaptiveBitrateController lower and restore the settings below
+    // (the ceiling) as the uplink allows. See DeviceManager::bitrateController().
+    bool adaptiveBitrate = false;
+    // Prepare and join WiFi but leave the encoder off until
+    // DeviceManager::goLive(), so cameras on standby save power.
+    bool standby = false;
     Resolution resolution = Resolution::Res1080p;
     uint16_t bitrateKbps = 4000;
     FPS fps = FPS::FPS25;
+    // How long to wait for a StreamingStatus confirming a stream that is
+    // believed to be running before starting it again.
+    int probeTimeoutMs = 2000;
+};
+
+// How DeviceManager brings a dropped BLE link back while a device is in use.
+// Off by default: a dropped link then fails the running flow with finished(dev, false).
+struct ReconnectPolicy {
+    bool enabled = false;
+    int maxAttempts = 8;
+    int initialDelayMs = 250;
+    // The delay doubles with every failed attempt up to this cap.
+    int maxDelayMs = 30000;
+    // An attempt that has not re-initialized the device by then counts as failed.
+    int connectTimeoutMs = 15000;
+};
+
+// What a manager knows about a device beyond the device itself, handed from
+// takeDevice() to addDevice() when a device moves between managers.
+struct DeviceTransfer {
+    bool isPaired = false;
+    bool isWiFiConnected = false;
+    bool isPrepared = false;
+    bool hasStreamingOptions = false;
+    StreamingOptions streamingOptions;
+    BatteryHistory batteryHistory;
+    // Percentage each battery threshold fired at; -1 while armed.
+    QList<int> batteryFiredAt;
+    // On the source manager's clock, to rebase the battery history.
+    qint64 takenAtMs = 0;
+    // Child of the device, so it moves along with it.
+    AdaptiveBitrateController *bitrateController = nullptr;
 };
 
 class DeviceManager : public QObject {
@@ -41,18 +105,104 @@ public:
     explicit DeviceManager(Device *device = nullptr, QObject *parent = nullptr);
     ~DeviceManager();
 
+    void addDevice(Device *device);
+    // Adds a device taken from another manager, along with its state.
+    void addDevice(Device *device, const DeviceTransfer &transfer);
+    // Detaches the device from this manager (and from its parent) without
+    // deleting it. Its bitrate controller is destroyed, unless transfer is
+    // given: it then receives the controller and the rest of the state.
+    bool takeDevice(Device *device, DeviceTransfer *transfer = nullptr);
+
     void connectToWiFiAndStartStreaming(Device *dev, const StreamingOptions &options);
     void runFlow(Device *dev, DeviceFlow *flow);
     void startDiscovery(const DiscoveryOptions &options = DiscoveryOptions());
     void stopDiscovery();
     void stop();
+    // Stops the stream and keeps the camera paired and on WiFi, as with
+    // StreamingOptions::standby: a reconnect does not restart it, goLive() does.
+    void stopStreaming(Device *dev);
+    // Disconnects on purpose: no reconnect is attempted for this device.
+    void disconnectDevice(Device *dev);
+    // Moves the device's running stream to another RTMP URL with minimal downtime.
+    bool switchStreamEndpoint(Device *dev, const QString &rtmpUrl);
+    // The device's bitrate controller, created on first use so that its policy
+    // can be set up before streaming starts.
+    AdaptiveBitrateController *bitrateController(Device *dev);
+    // Starts the stream of a device brought up with StreamingOptions::standby.
+    void goLive(Device *dev);
+
+    // Fleet commands: run on every device in the set and report one
+    // FleetOperation::finished() with a result per device.
+    //
+    // startFleet() brings every camera up to the point right before its start
+    // frame, then sends all start frames back to back, so the streams begin
+    // within a few milliseconds of each other.
+    FleetOperation *startFleet(const QList<Device *> &devices, const StreamingOptions &options,
+                               const FleetOptions &fleetOptions);
+    FleetOperation *startFleet(const QList<Device *> &devices, const StreamingOptions &options);
+    // Stopped cameras stay paired and on WiFi, as with StreamingOptions::standby.
+    FleetOperation *stopFleet(const QList<Device *> &devices, int timeoutMs = 5000);
+    FleetOperation *reconfigureFleet(const QList<Device *> &devices,
+                                     const StreamSettings &settings, int timeoutMs = 5000);
+    FleetOperation *setFleetImageStabilization(const QList<Device *> &devices,
+                                               ImageStabilization value, int timeoutMs = 5000);
+
+    // Thresholds are checked on every battery reading of every device.
+    void setBatteryPolicy(const BatteryPolicy &policy) {
+        m_batteryPolicy = policy;
+    }
+    BatteryPolicy batteryPolicy() const {
+        return m_batteryPolicy;
+    }
+    // -1 while unknown.
+    int batteryPercentage(Device *dev) const;
+    qint64 timeToEmpty(Device *dev) const;
+    BatteryHistory batteryHistory(Device *dev) const {
+        return m_battery.value(dev).history;
+    }
+
+    void setReconnectPolicy(const ReconnectPolicy &policy) {
+        m_reconnectPolicy = policy;
+    }
+    ReconnectPolicy reconnectPolicy() const {
+        return m_reconnectPolicy;
+    }
+
+    // Devices run flows with ConnectionProfile::LowLatency and drop to
+    // LowPower once they have been streaming for this long; negative keeps
+    // the central's parameters untouched.
+    void setLowPowerDelay(int ms) {
+        m_lowPowerDelayMs = ms;
+    }
+    int lowPowerDelay() const {
+        return m_lowPowerDelayMs;
+    }
+
+    // Local Bluetooth adapter used for discovery and new connections; null picks the default.
+    void setAdapterAddress(const QBluetoothAddress &address) {
+        m_adapterAddress = address;
+    }
+    QBluetoothAddress adapterAddress() const {
+        return m_adapterAddress;
+    }
 
     bool isPaired(Device *dev = nullptr) const;
     bool isWiFiConnected(Device *dev = nullptr) const;
     bool isStreaming(Device *dev = nullptr) const;
+    bool hasActiveFlow(Device *dev) const;
     Device *device() const;
-    QList<Device *> devices() const {
-        return m_devices;
+    QList<Device *> devices() const;
+
+    // O(1) handle lookups; a null or stale handle resolves to nullptr / false.
+    DeviceHandle handleOf(Device *dev) const {
+        return m_handles.value(dev);
+    }
+    Device *deviceFor(DeviceHandle handle) const;
+    bool isPaired(DeviceHandle handle) const;
+    bool isWiFiConnected(DeviceHandle handle) const;
+    bool isStreaming(DeviceHandle handle) const;
+    int deviceCount() const {
+        return static_cast<int>(m_registry.size());
     }
 
 protected:
@@ -67,33 +217,89 @@ signals:
     void log(const QString &message);
     void error(const QString &message);
     void finished(Device *device, bool success);
+    void reconnecting(Device *device, int attempt, int delayMs);
+    void reconnected(Device *device);
+    void linkDegraded(Device *device, int score, const QString &reason);
+    void linkRecovered(Device *device, int score);
+    void streamEndpointSwitched(Device *device, const QString &rtmpUrl, qint64 downtimeMs);
+    void batteryThresholdReached(Device *device, int percentage, qint64 timeToEmptyMs,
+                                 BatteryAction action);
 
 private slots:
     void onDeviceDiscovered(const QBluetoothDeviceInfo &info);
     void onScanFinished();
     void onScanError();
-    void onPairingComplete(Device *dev);
-    void onWifiConnected(Device *dev);
-    void onPrepareComplete(Device *dev);
-    void onStartComplete(Device *dev);
-    void onStopComplete(Device *dev);
+    void onPairingComplete(DeviceHandle handle);
+    void onWifiConnected(DeviceHandle handle);
+    void onPrepareComplete(DeviceHandle handle);
+    void onStartComplete(DeviceHandle handle);
+    void onStopComplete(DeviceHandle handle);
+    void onDeviceDisconnected(DeviceHandle handle);
+    void onDeviceInitialized(DeviceHandle handle);
+    void onLinkDegraded(DeviceHandle handle, int score, const QString &reason);
+    void onLinkRecovered(DeviceHandle handle, int score);
+    void onEndpointSwitched(DeviceHandle handle, const QString &rtmpUrl, qint64 downtimeMs);
+    void checkStreamFailover();
+    void onBatteryPercentage(DeviceHandle handle, int percentage);
     void onError(Device *dev, const QString &msg);
 
 private:
+    // Hot per-device state, packed contiguously in the registry.
     struct DeviceState {
+        Device *device = nullptr;
+        DeviceFlow *activeFlow = nullptr;
         bool isPaired = false;
         bool isWiFiConnected = false;
         bool isStreaming = false;
         bool isPrepared = false;
-        DeviceFlow *activeFlow = nullptr;
+        // Set while a flow wants this device connected; cleared by stop().
+        bool keepLink = false;
+        bool isReconnecting = false;
+        // The active flow was started internally to resume after a reconnect.
+        bool isResuming = false;
+        int reconnectAttempt = 0;
+        // Bumped to invalidate reconnect timers that are already scheduled.
+        quint32 reconnectToken = 0;
     };
 
-    void addDevice(Device *device);
+    DeviceState *stateOf(Device *dev) {
+        return m_registry.get(m_handles.value(dev));
+    }
+    const DeviceState *stateOf(Device *dev) const {
+        return m_registry.get(m_handles.value(dev));
+    }
+    void forgetDevice(DeviceHandle handle);
+    void startFlow(DeviceHandle handle, DeviceFlow *flow, bool resume);
+    void scheduleReconnect(DeviceHandle handle);
+    void attemptReconnect(DeviceHandle handle, quint32 token);
+    void giveUpReconnect(DeviceHandle handle);
+    int reconnectDelay(int attempt) const;
+    void scheduleLowPower(DeviceHandle handle);
+    void watchForFailover(DeviceHandle handle);
+    // False if the stream is busy and the action has to wait.
+    bool applyBatteryAction(Device *dev, BatteryAction action);
+
+    // Cold per-device battery data, kept out of the registry.
+    struct BatteryState {
+        BatteryHistory history;
+        // Percentage each threshold fired at; -1 while armed.
+        QList<int> firedAt;
+    };
 
-    QList<Device *> m_devices;
-    QMap<Device *, DeviceState> m_deviceStates;
+    SlotMap<DeviceState> m_registry;
+    QHash<Device *, DeviceHandle> m_handles;
+    // Last options per device, to resume streaming after a reconnect.
+    QHash<Device *, StreamingOptions> m_streamingOptions;
+    QHash<Device *, AdaptiveBitrateController *> m_bitrateControllers;
+    BatteryPolicy m_batteryPolicy;
+    QHash<Device *, BatteryState> m_battery;
+    ElapsedTimer m_clock;
+    ReconnectPolicy m_reconnectPolicy;
+    int m_lowPowerDelayMs = 10000;
+    Timer *m_failoverTimer = nullptr;
     QBluetoothDeviceDiscoveryAgent *m_discoveryAgent = nullptr;
     DiscoveryOptions m_discoveryOptions;
+    QBluetoothAddress m_adapterAddress;
 };
 
 } // namespace dji
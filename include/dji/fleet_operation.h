@@ -0,0 +1,146 @@
+/**
+ * @file fleet_operation.h
+ * @brief Commands run on a set of devices with one aggregated completion.
+ *
+ * DeviceManager returns a FleetOperation for every fleet command. It collects
+ * a result per device and emits finished() once, when every device has
+ * reported or the timeout expired. FleetStarter is the synchronized start:
+ * every camera is brought up to the point right before its start frame, then
+ * all start frames are sent together and the achieved skew is reported.
+ */
+
+#ifndef DJI_FLEET_OPERATION_H
+#define DJI_FLEET_OPERATION_H
+
+#include "dji/device_manager.h"
+#include "dji/scheduler.h"
+#include <QList>
+#include <QObject>
+#include <QString>
+
+namespace dji {
+
+class Device;
+
+struct FleetDeviceResult {
+    Device *device = nullptr;
+    bool success = false;
+    QString error;
+    // Synchronized start only: when the start frame was handed to the BLE
+    // stack, relative to the first one, and how long its acknowledgement took.
+    qint64 startOffsetUs = -1;
+    qint64 ackLatencyMs = -1;
+};
+
+struct FleetResult {
+    QList<FleetDeviceResult> devices;
+    // Synchronized start only: spread of the start frame writes and of their
+    // acknowledgements across the cameras that were started; -1 otherwise.
+    qint64 startSkewUs = -1;
+    qint64 ackSkewMs = -1;
+
+    bool success() const {
+        for (const FleetDeviceResult &r : devices) {
+            if (!r.success)
+                return false;
+        }
+        return true;
+    }
+    int succeeded() const {
+        int count = 0;
+        for (const FleetDeviceResult &r : devices) {
+            count += r.success ? 1 : 0;
+        }
+        return count;
+    }
+    const FleetDeviceResult *find(Device *dev) const {
+        for (const FleetDeviceResult &r : devices) {
+            if (r.device == dev)
+                return &r;
+        }
+        return nullptr;
+    }
+};
+
+struct FleetOptions {
+    // Pairing, preparing and joining WiFi, for all cameras together.
+    int stageTimeoutMs = 60000;
+    // Each acknowledgement round (configuration, start, stop, ...). Cameras
+    // whose configuration is not acknowledged in time are started anyway,
+    // see SubsystemStreamer::stageLiveStream().
+    int ackTimeoutMs = 5000;
+};
+
+class FleetOperation : public QObject {
+    Q_OBJECT
+public:
+    FleetOperation(const QList<Device *> &devices, int timeoutMs, QObject *parent = nullptr);
+
+    QList<Device *> devices() const {
+        return m_devices;
+    }
+    bool isFinished() const {
+        return m_finished;
+    }
+    FleetResult result() const {
+        return m_result;
+    }
+
+    // Records a device's outcome; the first report per device wins.
+    void complete(Device *dev, bool success, const QString &error = QString());
+
+signals:
+    void finished(const dji::FleetResult &result);
+
+protected:
+    FleetDeviceResult *resultFor(Device *dev);
+    bool isPending(Device *dev) const;
+    QList<Device *> pendingDevices() const;
+    // Fails every device still pending.
+    void failPending(const QString &error);
+    void restartTimeout(int timeoutMs);
+    virtual void onTimeout();
+    virtual void onAllCompleted();
+    void finish();
+
+    QList<Device *> m_devices;
+    FleetResult m_result;
+    QList<bool> m_reported;
+    Timer *m_timeout;
+    bool m_finished = false;
+};
+
+class FleetStarter : public FleetOperation {
+    Q_OBJECT
+public:
+    FleetStarter(DeviceManager *manager, const QList<Device *> &devices,
+                 const StreamingOptions &options, const FleetOptions &fleetOptions,
+                 QObject *parent = nullptr);
+
+    void start();
+
+protected:
+    void onTimeout() override;
+    void onAllCompleted() override;
+
+private:
+    enum class Phase { Idle, Staging, Configuring, Starting, Done };
+
+    void onFlowFinished(Device *dev, bool success);
+    void configure();
+    void fire();
+    void onStarted(Device *dev);
+    void advanceWhenReady();
+
+    DeviceManager *m_manager;
+    StreamingOptions m_options;
+    FleetOptions m_fleetOptions;
+    Phase m_phase = Phase::Idle;
+    // Devices still in the running phase.
+    QList<Device *> m_waiting;
+    ElapsedTimer m_clock;
+};
+
+} // namespace dji
+
+#endif // DJI_FLEET_OPERATION_H
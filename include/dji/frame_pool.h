@@ -0,0 +1,57 @@
+/**
+ * @file frame_pool.h
+ * @brief Recycled messages for received frames.
+ *
+ * Device hands every received Message to its receivers by reference. Those
+ * that keep it, and every queued connection to another thread, hold a copy
+ * that shares the payload. Parsing the next frame into the same payload
+ * would detach it from them and allocate. Device parses into a small ring
+ * of messages instead, skipping those whose payload a reader still holds.
+ * Readers see an immutable frame that is recycled once the last copy is
+ * gone.
+ */
+
+#ifndef DJI_FRAME_POOL_H
+#define DJI_FRAME_POOL_H
+
+#include "dji/message.h"
+#include <QList>
+
+namespace dji {
+
+class FramePool {
+public:
+    static constexpr int defaultSize = 8;
+
+    explicit FramePool(int size = defaultSize);
+
+    // The first message whose payload no reader holds, to parse the next
+    // frame into. If readers hold all of them, one is taken in turn anyway;
+    // writing its payload then allocates a new one, and misses() counts it.
+    Message *acquire();
+
+    int size() const {
+        return static_cast<int>(m_slots.size());
+    }
+    // Messages whose payload no reader holds.
+    int available() const;
+    quint64 misses() const {
+        return m_misses;
+    }
+
+private:
+    static bool isFree(const Message &msg) {
+        // The reference count is atomic, so this holds whichever thread the
+        // readers dropped their copies on.
+        return msg.payload.isNull() || msg.payload.isDetached();
+    }
+
+    QList<Message> m_slots;
+    // Next one to take when all are held.
+    int m_next = 0;
+    quint64 m_misses = 0;
+};
+
+} // namespace dji
+
+#endif // DJI_FRAME_POOL_H
@@ -0,0 +1,115 @@
+/**
+ * @file link_health_monitor.h
+ * @brief Per-device BLE link quality tracking.
+ *
+ * A dropped link is only reported once the supervision timeout expires. The
+ * monitor watches the signs that come earlier: the cadence of the status and
+ * keepalive messages the camera pushes, the round-trip time of requests, and
+ * the RSSI. It folds them into a 0-100 score and emits degraded() when the
+ * score falls below a threshold, so callers can act before the link is gone.
+ */
+
+#ifndef DJI_LINK_HEALTH_MONITOR_H
+#define DJI_LINK_HEALTH_MONITOR_H
+
+#include "dji/message.h"
+#include "dji/scheduler.h"
+#include <QHash>
+#include <QObject>
+
+namespace dji {
+
+class Device;
+
+struct LinkHealthOptions {
+    int evaluationIntervalMs = 500;
+    // RSSI polling period; 0 or less disables it.
+    int rssiIntervalMs = 5000;
+    // Floor for the learned inbound cadence, so bursts do not look like silence.
+    int minCadenceMs = 500;
+    int degradedScore = 50;
+    // Hysteresis: recovered() needs a clearly better score than degraded().
+    int recoveredScore = 70;
+};
+
+class LinkHealthMonitor : public QObject {
+    Q_OBJECT
+public:
+    explicit LinkHealthMonitor(Device *device);
+
+    void setOptions(const LinkHealthOptions &options);
+    LinkHealthOptions options() const {
+        return m_options;
+    }
+
+    // Started and stopped with the device's link; tests may drive it directly.
+    void start();
+    void stop();
+    bool isRunning() const {
+        return m_running;
+    }
+
+    int score() const {
+        return m_score;
+    }
+    bool isDegraded() const {
+        return m_degraded;
+    }
+    // -1 while unknown.
+    int rttMs() const {
+        return m_rttMs;
+    }
+    int cadenceMs() const {
+        return m_cadenceMs;
+    }
+    qint64 silenceMs() const;
+    // 0 while unknown.
+    int rssi() const {
+        return m_rssi;
+    }
+
+    void onMessageSent(const Message &msg);
+    void onMessageReceived(const Message &msg);
+    void onRssiRead(int rssi);
+
+    // Re-scores right away instead of waiting for the next tick.
+    void evaluate();
+
+signals:
+    void scoreChanged(int score);
+    void degraded(int score, const QString &reason);
+    void recovered(int score);
+
+private:
+    static quint32 requestKey(const Message &msg) {
+        return (static_cast<quint32>(msg.subsystem) << 16) | static_cast<quint16>(msg.msgId);
+    }
+    static bool isHeartbeat(MessageType type) {
+        return type == MessageType::MaybeKeepAlive || type == MessageType::MaybeStatus ||
+               type == MessageType::StreamingStatus;
+    }
+    int cadenceScore() const;
+    int rttScore() const;
+    int rssiScore() const;
+
+    Device *m_device;
+    LinkHealthOptions m_options;
+    Timer *m_evaluationTimer;
+    Timer *m_rssiTimer;
+    ElapsedTimer m_clock;
+
+    QHash<quint32, qint64> m_pendingRequests;
+    qint64 m_lastHeartbeatMs = -1;
+    qint64 m_lastInboundMs = -1;
+    int m_heartbeats = 0;
+    int m_cadenceMs = -1;
+    int m_rttMs = -1;
+    int m_rssi = 0;
+    int m_score = 100;
+    bool m_degraded = false;
+    bool m_running = false;
+};
+
+} // namespace dji
+
+#endif // DJI_LINK_HEALTH_MONITOR_H
@@ -2,27 +2,48 @@
 #define DJI_MESSAGE_H
 
 #include "dji/constants.h"
+#include "dji/protocol.h"
 #include <QByteArray>
+#include <QByteArrayView>
 #include <QString>
 #include <cstdint>
 
 namespace dji {
 
 struct Message {
+    // See protocol.h for the frame layout.
+    static constexpr int headerSize = static_cast<int>(protocol::headerSize);
+    static constexpr int overhead = static_cast<int>(protocol::overhead);
+    static constexpr int maxFrameSize = static_cast<int>(protocol::maxFrameSize);
+    static constexpr int maxPayloadSize = static_cast<int>(protocol::maxPayloadSize);
+
     SubsystemID subsystem = static_cast<SubsystemID>(0);
     MessageID msgId = static_cast<MessageID>(0);
     MessageType msgType = static_cast<MessageType>(0);
     QByteArray payload;
 
-    QByteArray serialize() const;
+    // Returns an empty array (and *ok = false) if the payload does not fit a frame.
+    QByteArray serialize(bool *ok = nullptr) const;
     static Message parse(const QByteArray &data, bool *ok = nullptr);
+    // Parses into *msg and returns false if data is not a valid frame. The
+    // payload reuses its capacity, so parsing every frame into the same
+    // Message allocates nothing once it has seen the largest payload, unless
+    // a receiver kept a copy of it.
+    static bool parseInto(QByteArrayView data, Message *msg);
+    // Total length of the frame starting at data[0], or -1 if the header is
+    // incomplete or invalid.
+    static int frameLength(QByteArrayView data);
 };
 
-uint8_t crc8(const QByteArray &data);
-uint16_t crc16(const QByteArray &data);
+uint8_t crc8(QByteArrayView data);
+uint16_t crc16(QByteArrayView data);
+// identifyDeviceType() of constants.h, e.g. for
+// QBluetoothDeviceInfo::manufacturerData(0x08AA).
+DeviceType identifyDeviceType(const QByteArray &manufacturerData);
 
-QByteArray packString(const QString &s);
-QByteArray packURL(const QString &s);
+// Both return an empty array (and *ok = false) instead of truncating.
+QByteArray packString(const QString &s, bool *ok = nullptr);
+QByteArray packURL(const QString &s, bool *ok = nullptr);
 
 } // namespace dji
 
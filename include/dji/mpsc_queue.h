@@ -0,0 +1,68 @@
+/**
+ * @file mpsc_queue.h
+ * @brief Unbounded lock-free multi-producer/single-consumer queue.
+ */
+
+#ifndef DJI_MPSC_QUEUE_H
+#define DJI_MPSC_QUEUE_H
+
+#include <atomic>
+#include <utility>
+
+namespace dji {
+
+/**
+ * @brief Intrusive linked queue in the style of Dmitry Vyukov's MPSC queue.
+ *
+ * push() is a single atomic exchange and may be called from any number of
+ * threads. pop() must only be called from one consumer thread. A push that is
+ * preempted between its exchange and its link is briefly invisible to the
+ * consumer (pop() returns false); it becomes visible once the producer resumes.
+ */
+template <typename T> class MpscQueue {
+public:
+    MpscQueue() : m_head(new Node), m_tail(m_head.load(std::memory_order_relaxed)) {}
+
+    ~MpscQueue() {
+        T discarded;
+        while (pop(discarded)) {
+        }
+        delete m_tail;
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    void push(T value) {
+        Node *node = new Node;
+        node->value = std::move(value);
+        Node *prev = m_head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // Consumer side only.
+    bool pop(T &out) {
+        Node *tail = m_tail;
+        Node *next = tail->next.load(std::memory_order_acquire);
+        if (!next)
+            return false;
+        out = std::move(next->value);
+        next->value = T();
+        m_tail = next;
+        delete tail;
+        return true;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node *> next{nullptr};
+        T value{};
+    };
+
+    std::atomic<Node *> m_head;
+    Node *m_tail;
+};
+
+} // namespace dji
+
+#endif // DJI_MPSC_QUEUE_H
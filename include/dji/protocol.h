@@ -0,0 +1,74 @@
+/**
+ * @file protocol.h
+ * @brief Qt-free DUML frame codec.
+ *
+ * Plain C++17 over byte pointers, for code that decodes or builds frames
+ * without Qt, e.g. a backend reading captures. The dji_protocol target holds
+ * only this and constants.h; Message and Device build on top of it.
+ */
+
+#ifndef DJI_PROTOCOL_H
+#define DJI_PROTOCOL_H
+
+#include "dji/constants.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace dji::protocol {
+
+// The frame length is 10 bits wide: byte 1 holds the low 8 bits and the low
+// 2 bits of byte 2 the rest, next to the protocol version (1 << 2).
+constexpr size_t headerSize = 11;
+constexpr size_t overhead = headerSize + 2;
+constexpr size_t maxFrameSize = 0x3FF;
+constexpr size_t maxPayloadSize = maxFrameSize - overhead;
+
+uint8_t crc8(const uint8_t *data, size_t size);
+uint16_t crc16(const uint8_t *data, size_t size);
+
+enum class ParseResult {
+    Ok,
+    TooShort,
+    BadMagic,
+    // The length field claims more bytes than given.
+    Incomplete,
+    BadLength,
+    BadVersion,
+    BadHeaderCrc,
+    BadCrc,
+};
+
+const char *toString(ParseResult result);
+
+// Name of a listed message type, or nullptr. Values shared by two names,
+// such as Configure and StartStopStreaming, get both.
+const char *messageTypeName(MessageType type);
+// Listed, and not one of the Unknown0..5 placeholders.
+bool isKnownMessageType(MessageType type);
+
+// A parsed frame; payload points into the parsed bytes.
+struct FrameView {
+    SubsystemID subsystem = static_cast<SubsystemID>(0);
+    MessageID msgId = static_cast<MessageID>(0);
+    MessageType msgType = static_cast<MessageType>(0);
+    const uint8_t *payload = nullptr;
+    size_t payloadSize = 0;
+};
+
+// Total length of the frame starting at data[0], or -1 if the header is
+// incomplete or invalid.
+int frameLength(const uint8_t *data, size_t size);
+// Parses the frame at the start of data; bytes after it are ignored.
+ParseResult parseFrame(const uint8_t *data, size_t size, FrameView *frame);
+
+constexpr size_t frameSize(size_t payloadSize) {
+    return overhead + payloadSize;
+}
+// Writes a frame into out and returns its length, or 0 if the payload does
+// not fit a frame or out is smaller than frameSize(payloadSize).
+size_t serializeFrame(SubsystemID subsystem, MessageID msgId, MessageType msgType,
+                      const uint8_t *payload, size_t payloadSize, uint8_t *out, size_t outSize);
+
+} // namespace dji::protocol
+
+#endif // DJI_PROTOCOL_H
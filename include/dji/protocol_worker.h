@@ -0,0 +1,131 @@
+/**
+ * @file protocol_worker.h
+ * @brief Runs a DeviceManager and its protocol stack on a dedicated thread.
+ *
+ * Frame parsing, CRC, logging and the flow state machines then no longer share
+ * the GUI thread with rendering. The commands may be called from any thread;
+ * they are forwarded to the worker as queued invocations. Results travel back
+ * through a lock-free SPSC queue that is drained on the thread owning the
+ * ProtocolWorker, where the familiar DeviceManager-style signals are re-emitted.
+ * The state mirrors are written by that drain and must only be read on the
+ * owning thread; other threads use commands()->snapshot().
+ */
+
+#ifndef DJI_PROTOCOL_WORKER_H
+#define DJI_PROTOCOL_WORKER_H
+
+#include "dji/device_manager.h"
+#include "dji/spsc_queue.h"
+#include <QBluetoothAddress>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <atomic>
+
+class QThread;
+
+namespace dji {
+
+class Device;
+class DeviceCommandQueue;
+class DeviceFlow;
+
+class ProtocolWorker : public QObject {
+    Q_OBJECT
+public:
+    static constexpr size_t defaultQueueCapacity = 4096;
+
+    explicit ProtocolWorker(const QBluetoothAddress &adapterAddress = QBluetoothAddress(),
+                            QObject *parent = nullptr);
+    ~ProtocolWorker() override;
+
+    void startDiscovery(const DiscoveryOptions &options = DiscoveryOptions());
+    void stopDiscovery();
+    void connectToWiFiAndStartStreaming(Device *dev, const StreamingOptions &options);
+    void runFlow(Device *dev, DeviceFlow *flow);
+    void stop();
+
+    // Mirrors of the worker-side state, updated when the result queue is drained.
+    // Owning thread only.
+    bool isPaired(Device *dev) const;
+    bool isWiFiConnected(Device *dev) const;
+    bool isStreaming(Device *dev) const;
+    QList<Device *> devices() const {
+        return m_devices;
+    }
+
+    QThread *workerThread() const {
+        return m_thread;
+    }
+    // Lives on the worker thread: only connect to it or invoke it queued.
+    DeviceManager *manager() const {
+        return m_manager;
+    }
+    // Thread-safe command submission with completion futures and state snapshots.
+    DeviceCommandQueue *commands() const {
+        return m_commands;
+    }
+
+    quint64 overflowCount() const {
+        return m_overflowCount.load(std::memory_order_relaxed);
+    }
+
+signals:
+    void isPairedChanged(Device *device);
+    void isWiFiConnectedChanged(Device *device);
+    void isStreamingChanged(Device *device);
+    void devicesChanged();
+    void log(const QString &message);
+    void error(const QString &message);
+    void finished(Device *device, bool success);
+
+private:
+    struct Event {
+        enum class Type {
+            None,
+            Log,
+            Error,
+            Finished,
+            Paired,
+            WiFiConnected,
+            Streaming,
+            DevicesChanged
+        };
+        Type type = Type::None;
+        Device *device = nullptr;
+        bool flag = false;
+        QString text;
+        QList<Device *> devices;
+    };
+
+    struct DeviceStateMirror {
+        bool isPaired = false;
+        bool isWiFiConnected = false;
+        bool isStreaming = false;
+    };
+
+    void attachToManager();
+    void adopt(QObject *object);
+    void post(Event event);
+    void flushOverflow();
+    void scheduleDrain();
+    void drain();
+    void dispatch(const Event &event);
+
+    QThread *m_thread;
+    DeviceManager *m_manager;
+    DeviceCommandQueue *m_commands;
+
+    SpscQueue<Event> m_results;
+    std::atomic<bool> m_drainScheduled{false};
+    std::atomic<bool> m_hasOverflow{false};
+    std::atomic<quint64> m_overflowCount{0};
+    QList<Event> m_overflow; // worker thread only
+
+    QList<Device *> m_devices;
+    QHash<Device *, DeviceStateMirror> m_states;
+};
+
+} // namespace dji
+
+#endif // DJI_PROTOCOL_WORKER_H
@@ -0,0 +1,237 @@
+/**
+ * @file scheduler.h
+ * @brief Injectable clock and timers, with a virtual-time implementation.
+ *
+ * Library code measures time with ElapsedTimer and waits with Timer instead
+ * of QElapsedTimer and QTimer. Both go through Scheduler::instance(), which is
+ * the wall clock unless a test installs a VirtualScheduler: time then only
+ * moves when the test advances it, and timeouts, retries and keepalives that
+ * take minutes run instantly and in a fixed order.
+ *
+ * Virtual time is meant for single-threaded tests. The threads of
+ * ProtocolWorker and ShardedDeviceManager keep using Qt's timers.
+ */
+
+#ifndef DJI_SCHEDULER_H
+#define DJI_SCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <functional>
+#include <limits>
+#include <map>
+#include <utility>
+
+class QTimer;
+
+namespace dji {
+
+class Scheduler {
+public:
+    using TimerId = quint64;
+
+    virtual ~Scheduler() = default;
+
+    // Monotonic time in nanoseconds since an arbitrary epoch.
+    virtual qint64 nsecsNow() const = 0;
+    // Runs callback once, delayMs from now, on the scheduling thread. It is
+    // dropped if context is destroyed first. Never returns 0.
+    virtual TimerId schedule(qint64 delayMs, QObject *context, std::function<void()> callback) = 0;
+    // Unknown and already run ids are ignored.
+    virtual void cancel(TimerId id) = 0;
+
+    // The scheduler library timers use; the system one unless replaced.
+    static Scheduler *instance();
+    static Scheduler *system();
+    // Not owned; nullptr restores the system scheduler. Timers keep the
+    // scheduler they were created with, and ElapsedTimers the one they were
+    // started on, so install it first. The pointer itself is atomic, but
+    // swap it only while no other thread uses library timers: they would
+    // pick up whichever scheduler is current, and VirtualScheduler is not
+    // thread-safe.
+    static void setInstance(Scheduler *scheduler);
+};
+
+// Wall clock and Qt's event loop.
+class SystemScheduler : public Scheduler {
+public:
+    SystemScheduler();
+
+    qint64 nsecsNow() const override {
+        return m_epoch.nsecsElapsed();
+    }
+    TimerId schedule(qint64 delayMs, QObject *context, std::function<void()> callback) override;
+    void cancel(TimerId id) override;
+
+private:
+    QElapsedTimer m_epoch;
+    QMutex m_mutex;
+    QHash<TimerId, QPointer<QTimer>> m_timers;
+    TimerId m_nextId = 0;
+};
+
+/**
+ * @brief Time that moves only when advanced.
+ *
+ * Callbacks run in due-time order, those due at the same time in scheduling
+ * order, with nsecsNow() set to their due time. Posted events, such as queued
+ * calls and deleteLater(), are delivered after every callback, as if control
+ * went back to the event loop, and also before time starts to move, so
+ * calls queued from other threads are picked up.
+ */
+class VirtualScheduler : public Scheduler {
+public:
+    explicit VirtualScheduler(qint64 startNs = 0) : m_nowNs(startNs) {
+    }
+
+    qint64 nsecsNow() const override {
+        return m_nowNs;
+    }
+    TimerId schedule(qint64 delayMs, QObject *context, std::function<void()> callback) override;
+    void cancel(TimerId id) override;
+
+    // Moves time forward by ms, running everything that falls due on the way,
+    // including callbacks scheduled by those callbacks.
+    void advance(qint64 ms);
+    // Jumps from one due callback to the next until done() holds or maxMs
+    // have passed; returns done().
+    bool advanceUntil(const std::function<bool()> &done, qint64 maxMs);
+    // Runs what is due now, e.g. zero-delay callbacks.
+    void runDue() {
+        advance(0);
+    }
+
+    int pendingCount() const {
+        return static_cast<int>(m_queue.size());
+    }
+    qint64 elapsedMs() const {
+        return m_nowNs / 1000000;
+    }
+
+private:
+    struct Entry {
+        QPointer<QObject> context;
+        bool hasContext = false;
+        std::function<void()> callback;
+    };
+
+    // Runs the first callback if it is due by untilNs; false if none is.
+    bool runNext(qint64 untilNs);
+    static void deliverPostedEvents();
+
+    qint64 m_nowNs;
+    TimerId m_nextId = 0;
+    // Keyed by due time, then id, which is the scheduling order.
+    std::map<std::pair<qint64, TimerId>, Entry> m_queue;
+    QHash<TimerId, qint64> m_dueNs;
+};
+
+// Installs a scheduler for the lifetime of the scope.
+class ScopedScheduler {
+public:
+    explicit ScopedScheduler(Scheduler *scheduler) : m_previous(Scheduler::instance()) {
+        Scheduler::setInstance(scheduler);
+    }
+    ~ScopedScheduler() {
+        Scheduler::setInstance(m_previous);
+    }
+    ScopedScheduler(const ScopedScheduler &) = delete;
+    ScopedScheduler &operator=(const ScopedScheduler &) = delete;
+
+private:
+    Scheduler *m_previous;
+};
+
+/**
+ * @brief QTimer on top of Scheduler.
+ *
+ * On the system scheduler it keeps a QTimer of its own, so restarting it
+ * allocates nothing.
+ */
+class Timer : public QObject {
+    Q_OBJECT
+public:
+    explicit Timer(QObject *parent = nullptr);
+    ~Timer() override;
+
+    void setInterval(int ms);
+    int interval() const {
+        return m_intervalMs;
+    }
+    void setSingleShot(bool singleShot);
+    bool isSingleShot() const {
+        return m_singleShot;
+    }
+    // Only honoured on the system scheduler.
+    void setTimerType(Qt::TimerType type);
+    bool isActive() const;
+
+    void start();
+    void start(int ms);
+    void stop();
+
+    template <typename Functor>
+    static void singleShot(int ms, const QObject *context, Functor &&functor) {
+        Scheduler::instance()->schedule(ms, const_cast<QObject *>(context),
+                                        std::function<void()>(std::forward<Functor>(functor)));
+    }
+
+signals:
+    void timeout();
+
+private:
+    void fire();
+
+    Scheduler *m_scheduler;
+    QTimer *m_timer = nullptr;
+    Scheduler::TimerId m_id = 0;
+    int m_intervalMs = 0;
+    bool m_singleShot = false;
+};
+
+// QElapsedTimer on top of Scheduler. It measures on the scheduler it was
+// started on, which has to outlive it.
+class ElapsedTimer {
+public:
+    void start() {
+        m_scheduler = Scheduler::instance();
+        m_startNs = m_scheduler->nsecsNow();
+    }
+    qint64 restart() {
+        if (!m_scheduler) {
+            m_scheduler = Scheduler::instance();
+        }
+        const qint64 now = m_scheduler->nsecsNow();
+        const qint64 elapsedMs = (now - m_startNs) / 1000000;
+        m_startNs = now;
+        return elapsedMs;
+    }
+    void invalidate() {
+        m_startNs = invalidNs;
+    }
+    bool isValid() const {
+        return m_startNs != invalidNs;
+    }
+    qint64 nsecsElapsed() const {
+        return (m_scheduler ? m_scheduler : Scheduler::instance())->nsecsNow() - m_startNs;
+    }
+    qint64 elapsed() const {
+        return nsecsElapsed() / 1000000;
+    }
+    // A negative timeout never expires.
+    bool hasExpired(qint64 timeoutMs) const {
+        return timeoutMs >= 0 && elapsed() > timeoutMs;
+    }
+
+private:
+    static constexpr qint64 invalidNs = std::numeric_limits<qint64>::min();
+    Scheduler *m_scheduler = nullptr;
+    qint64 m_startNs = invalidNs;
+};
+
+} // namespace dji
+
+#endif // DJI_SCHEDULER_H
@@ -0,0 +1,112 @@
+/**
+ * @file sharded_device_manager.h
+ * @brief Spreads devices over several protocol threads behind one facade.
+ *
+ * Each shard is a ProtocolWorker, i.e. a DeviceManager with its own event loop
+ * and its own DeviceState table. Devices are pinned to one shard for their
+ * lifetime unless a rebalance moves an idle, disconnected device from the most
+ * to the least loaded shard. The facade forwards the aggregated signals of all
+ * shards and routes every command to the shard currently owning the device;
+ * commands for a device that is being moved wait until the move is done.
+ */
+
+#ifndef DJI_SHARDED_DEVICE_MANAGER_H
+#define DJI_SHARDED_DEVICE_MANAGER_H
+
+#include "dji/device_manager.h"
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <functional>
+
+namespace dji {
+
+class Device;
+class DeviceFlow;
+class ProtocolWorker;
+
+class ShardedDeviceManager : public QObject {
+    Q_OBJECT
+public:
+    // A shardCount of 0 picks one shard per available core.
+    explicit ShardedDeviceManager(int shardCount = 0, QObject *parent = nullptr);
+    ~ShardedDeviceManager() override;
+
+    int shardCount() const {
+        return m_shards.size();
+    }
+    int shardLoad(int shard) const;
+    int shardOf(Device *dev) const {
+        return m_owner.value(dev, -1);
+    }
+
+    // Takes ownership of a parentless device living on the caller's thread and
+    // pins it to the given shard, or to the least loaded one when shard < 0.
+    void addDevice(Device *dev, int shard = -1);
+
+    void startDiscovery(const DiscoveryOptions &options = DiscoveryOptions());
+    void stopDiscovery();
+    void connectToWiFiAndStartStreaming(Device *dev, const StreamingOptions &options);
+    void runFlow(Device *dev, DeviceFlow *flow);
+    void stop();
+
+    void setAutoRebalance(bool enabled) {
+        m_autoRebalance = enabled;
+    }
+    bool autoRebalance() const {
+        return m_autoRebalance;
+    }
+    void rebalance();
+
+    // See DeviceManager::setLowPowerDelay(); applies to every shard.
+    void setLowPowerDelay(int ms);
+
+    bool isPaired(Device *dev) const;
+    bool isWiFiConnected(Device *dev) const;
+    bool isStreaming(Device *dev) const;
+    QList<Device *> devices() const;
+
+signals:
+    void isPairedChanged(Device *device);
+    void isWiFiConnectedChanged(Device *device);
+    void isStreamingChanged(Device *device);
+    void devicesChanged();
+    void deviceMigrated(Device *device, int fromShard, int toShard);
+    void log(const QString &message);
+    void error(const QString &message);
+    void finished(Device *device, bool success);
+
+private:
+    using ManagerCall = std::function<void(DeviceManager *)>;
+    struct DeferredCall {
+        QObject *carried;
+        ManagerCall call;
+    };
+
+    void invokeOnOwner(Device *dev, QObject *carried, ManagerCall call);
+    void onShardDevicesChanged(int shard);
+    void onMigrationDone(Device *dev, int from, int to, bool moved);
+    void migrate(Device *dev, int from, int to);
+    void scheduleRebalance();
+    int leastLoadedShard() const;
+    ProtocolWorker *shardFor(Device *dev) const;
+
+    QList<ProtocolWorker *> m_shards;
+    QHash<Device *, int> m_owner;
+    // Handed to a shard but not yet confirmed by its device list.
+    QSet<Device *> m_inTransit;
+    // Between migrate() and onMigrationDone(), with the calls waiting for it.
+    QHash<Device *, QList<DeferredCall>> m_migrating;
+    // Running a flow through this facade; never moved.
+    QSet<Device *> m_busy;
+    // Refused to move (e.g. still connected) until their next flow finishes.
+    QSet<Device *> m_pinned;
+    int m_pendingMigrations = 0;
+    bool m_autoRebalance = true;
+    bool m_rebalanceScheduled = false;
+};
+
+} // namespace dji
+
+#endif // DJI_SHARDED_DEVICE_MANAGER_H
@@ -0,0 +1,169 @@
+/**
+ * @file slot_map.h
+ * @brief Generational slot map: stable handles over densely packed values.
+ */
+
+#ifndef DJI_SLOT_MAP_H
+#define DJI_SLOT_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace dji {
+
+/**
+ * @brief Handle into a SlotMap.
+ *
+ * A handle stays valid until its value is erased; afterwards the slot's
+ * generation is bumped, so the stale handle no longer resolves even once the
+ * slot has been reused.
+ */
+struct SlotHandle {
+    static constexpr uint32_t invalidIndex = UINT32_MAX;
+
+    uint32_t index = invalidIndex;
+    uint32_t generation = 0;
+
+    bool isNull() const {
+        return index == invalidIndex;
+    }
+    bool operator==(const SlotHandle &other) const {
+        return index == other.index && generation == other.generation;
+    }
+    bool operator!=(const SlotHandle &other) const {
+        return !(*this == other);
+    }
+};
+
+/**
+ * @brief Values stored contiguously, addressed through generational handles.
+ *
+ * insert() and get() are O(1). erase() shifts the values behind the erased
+ * one, which keeps iteration in insertion order (DeviceManager::device() is
+ * the oldest device) at O(n) for the rare removal. Freed slots are recycled,
+ * so memory stays bounded by the peak population.
+ */
+template <typename T> class SlotMap {
+public:
+    using iterator = typename std::vector<T>::iterator;
+    using const_iterator = typename std::vector<T>::const_iterator;
+
+    SlotHandle insert(T value) {
+        uint32_t slotIndex;
+        if (m_freeHead != SlotHandle::invalidIndex) {
+            slotIndex = m_freeHead;
+            m_freeHead = m_slots[slotIndex].target;
+        } else {
+            slotIndex = static_cast<uint32_t>(m_slots.size());
+            m_slots.push_back(Slot());
+        }
+
+        Slot &slot = m_slots[slotIndex];
+        slot.target = static_cast<uint32_t>(m_values.size());
+        m_values.push_back(std::move(value));
+        m_valueSlots.push_back(slotIndex);
+        return SlotHandle{slotIndex, slot.generation};
+    }
+
+    bool erase(SlotHandle handle) {
+        if (!contains(handle))
+            return false;
+
+        Slot &slot = m_slots[handle.index];
+        const uint32_t hole = slot.target;
+        m_values.erase(m_values.begin() + hole);
+        m_valueSlots.erase(m_valueSlots.begin() + hole);
+        for (size_t i = hole; i < m_valueSlots.size(); ++i) {
+            m_slots[m_valueSlots[i]].target = static_cast<uint32_t>(i);
+        }
+
+        ++slot.generation;
+        slot.target = m_freeHead;
+        m_freeHead = handle.index;
+        return true;
+    }
+
+    bool contains(SlotHandle handle) const {
+        return handle.index < m_slots.size() &&
+               m_slots[handle.index].generation == handle.generation &&
+               isLive(handle.index);
+    }
+
+    T *get(SlotHandle handle) {
+        return contains(handle) ? &m_values[m_slots[handle.index].target] : nullptr;
+    }
+    const T *get(SlotHandle handle) const {
+        return contains(handle) ? &m_values[m_slots[handle.index].target] : nullptr;
+    }
+
+    // Handle of the value at a dense position, e.g. while iterating.
+    SlotHandle handleAt(size_t position) const {
+        const uint32_t slotIndex = m_valueSlots[position];
+        return SlotHandle{slotIndex, m_slots[slotIndex].generation};
+    }
+
+    void clear() {
+        for (size_t i = 0; i < m_values.size(); ++i) {
+            const uint32_t slotIndex = m_valueSlots[i];
+            ++m_slots[slotIndex].generation;
+            m_slots[slotIndex].target = m_freeHead;
+            m_freeHead = slotIndex;
+        }
+        m_values.clear();
+        m_valueSlots.clear();
+    }
+
+    size_t size() const {
+        return m_values.size();
+    }
+    bool isEmpty() const {
+        return m_values.empty();
+    }
+    // Slots ever allocated; stays at the peak population under churn.
+    size_t slotCapacity() const {
+        return m_slots.size();
+    }
+
+    T &at(size_t position) {
+        return m_values[position];
+    }
+    const T &at(size_t position) const {
+        return m_values[position];
+    }
+
+    iterator begin() {
+        return m_values.begin();
+    }
+    iterator end() {
+        return m_values.end();
+    }
+    const_iterator begin() const {
+        return m_values.begin();
+    }
+    const_iterator end() const {
+        return m_values.end();
+    }
+
+private:
+    struct Slot {
+        // Dense position while live, next free slot while free.
+        uint32_t target = SlotHandle::invalidIndex;
+        uint32_t generation = 0;
+    };
+
+    bool isLive(uint32_t slotIndex) const {
+        const uint32_t target = m_slots[slotIndex].target;
+        return target < m_valueSlots.size() && m_valueSlots[target] == slotIndex;
+    }
+
+    std::vector<Slot> m_slots;
+    std::vector<T> m_values;
+    std::vector<uint32_t> m_valueSlots;
+    uint32_t m_freeHead = SlotHandle::invalidIndex;
+};
+
+} // namespace dji
+
+#endif // DJI_SLOT_MAP_H
@@ -0,0 +1,75 @@
+/**
+ * @file spsc_queue.h
+ * @brief Bounded lock-free single-producer/single-consumer ring buffer.
+ */
+
+#ifndef DJI_SPSC_QUEUE_H
+#define DJI_SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace dji {
+
+/**
+ * @brief Wait-free ring buffer for handing values from exactly one producer
+ * thread to exactly one consumer thread.
+ *
+ * The capacity is rounded up to a power of two. push() fails instead of
+ * blocking when the ring is full, so the producer decides what to do with the
+ * overflow.
+ */
+template <typename T> class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity = 1024) {
+        size_t cap = 2;
+        while (cap < capacity)
+            cap <<= 1;
+        m_buffer.resize(cap);
+        m_mask = cap - 1;
+    }
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    size_t capacity() const {
+        return m_buffer.size();
+    }
+
+    bool isEmpty() const {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    // Producer side only. The value is left untouched when the ring is full.
+    template <typename U> bool push(U &&value) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == m_buffer.size())
+            return false;
+        m_buffer[head & m_mask] = std::forward<U>(value);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side only.
+    bool pop(T &out) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire))
+            return false;
+        out = std::move(m_buffer[tail & m_mask]);
+        m_buffer[tail & m_mask] = T();
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+    std::vector<T> m_buffer;
+    size_t m_mask = 0;
+};
+
+} // namespace dji
+
+#endif // DJI_SPSC_QUEUE_H
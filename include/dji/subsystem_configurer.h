@@ -3,33 +3,97 @@
 
 #include "dji/message.h"
 #include <QByteArray>
+#include <QList>
+#include <QMap>
 #include <QObject>
 
 namespace dji {
 
 class Device;
+class Timer;
 
+/**
+ * @brief Camera settings store on top of the Configure message.
+ *
+ * Keeps a mirror of the values the camera acknowledged. Writes are staged
+ * and applied by commit(): values equal to the mirror are skipped, the rest
+ * are sent one at a time, each waiting for its Configure result before the
+ * next, so re-applying an unchanged preset costs no round trips.
+ */
 class SubsystemConfigurer : public QObject {
     Q_OBJECT
 public:
+    enum class Setting { ImageStabilization };
+
+    static constexpr int defaultAckTimeoutMs = 3000;
+
     explicit SubsystemConfigurer(Device *device);
 
     SubsystemID subsystemID() const {
         return SubsystemID::Configurer;
     }
 
+    // Stages and commits at once.
     void setImageStabilization(ImageStabilization v);
+    void stageImageStabilization(ImageStabilization v) {
+        stage(Setting::ImageStabilization, QByteArray(1, static_cast<char>(v)));
+    }
+
+    void stage(Setting setting, const QByteArray &value);
+    void discard();
+    // Writes the staged values that differ from the mirror. A commit issued
+    // while another is in flight runs right after it.
+    void commit();
+    bool isCommitting() const {
+        return !m_inFlight.isEmpty();
+    }
+
+    // Last acknowledged value, or an empty array when unknown.
+    QByteArray value(Setting setting) const {
+        return m_mirror.value(setting);
+    }
+    // Forgets the mirror, e.g. when the settings may have changed on the camera.
+    void invalidateCache() {
+        m_mirror.clear();
+    }
+
+    void setAckTimeout(int ms) {
+        m_ackTimeoutMs = ms;
+    }
+
     void handleMessage(const Message &msg);
+    // Fails the batch in flight and forgets the mirror, e.g. after the BLE
+    // link went down.
+    void reset();
 
 signals:
     void log(const QString &message);
     void error(const QString &message);
     void imageStabilizationSet();
+    void settingChanged(dji::SubsystemConfigurer::Setting setting);
+    void committed(bool success, int written, int skipped);
 
 private:
-    Device *m_device;
+    struct Write {
+        Setting setting;
+        QByteArray value;
+    };
+
+    void startCommit();
+    void sendNext();
+    void finishCommit(bool success);
+    void onAckTimeout();
+    QByteArray encode(Setting setting, const QByteArray &value) const;
 
-    void sendMessageSetImageStabilization(ImageStabilization v);
+    Device *m_device;
+    QMap<Setting, QByteArray> m_mirror;
+    QMap<Setting, QByteArray> m_staged;
+    QList<Write> m_inFlight;
+    Timer *m_ackTimer;
+    int m_ackTimeoutMs = defaultAckTimeoutMs;
+    int m_written = 0;
+    int m_skipped = 0;
+    bool m_commitQueued = false;
 };
 
 } // namespace dji
@@ -2,6 +2,7 @@
 #define DJI_SUBSYSTEM_PAIRER_H
 
 #include "dji/message.h"
+#include "dji/wifi_scan.h"
 #include <QByteArray>
 #include <QObject>
 
@@ -22,23 +23,38 @@ public:
 
     void pair();
     void connectToWiFi(const QString &ssid, const QString &psk);
+    // Clears the AP table; it is refilled as scan reports arrive.
     void startScanningWiFi();
     void handleMessage(const Message &msg);
+    // Drops any handshake in progress, e.g. after the BLE link went down.
+    void reset();
 
     State state() const {
         return m_state;
     }
 
+    // Deduplicated APs heard since the last startScanningWiFi(), strongest first.
+    QList<WiFiNetwork> wifiNetworks() const {
+        return m_wifiNetworks.networks();
+    }
+    const WiFiScanTable &wifiScanTable() const {
+        return m_wifiNetworks;
+    }
+
 signals:
     void pairingComplete();
     void wifiConnected();
     void wifiScanReport(const QByteArray &report);
+    void wifiNetworksChanged();
+    // A rejected join is not fatal: callers may try another network.
+    void wifiConnectFailed(const QString &reason);
     void error(const QString &message);
     void log(const QString &message);
 
 private:
     Device *m_device;
     State m_state = State::Idle;
+    WiFiScanTable m_wifiNetworks;
 
     void sendRequestStartPairing();
     void sendMessageSetPairingPIN(const QString &pinCode);
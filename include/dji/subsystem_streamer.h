@@ -2,6 +2,7 @@
 #define DJI_SUBSYSTEM_STREAMER_H
 
 #include "dji/message.h"
+#include "dji/scheduler.h"
 #include <QByteArray>
 #include <QObject>
 
@@ -12,6 +13,8 @@ class Device;
 class SubsystemStreamer : public QObject {
     Q_OBJECT
 public:
+    static constexpr int defaultOperationTimeoutMs = 5000;
+
     explicit SubsystemStreamer(Device *device);
 
     SubsystemID subsystemID() const {
@@ -22,30 +25,135 @@ public:
     void startLiveStream(Resolution resolution, uint16_t bitrateKbps, FPS fps,
                          const QString &rtmpURL);
     void stopLiveStream();
+    // startLiveStream() in two halves, so the start frames of several cameras
+    // can be sent together: stage sends the configuration and emits
+    // liveStreamStaged() once it is acknowledged; fire sends only the start.
+    // That acknowledgement is inferred: cameras have been seen answering
+    // ConfigureStreaming with a StartStopStreamingResult, but nothing
+    // documents it. fire therefore also sends the start behind a
+    // configuration that was not acknowledged; the camera handles requests
+    // in order, and the start acknowledgement is what counts.
+    bool stageLiveStream(Resolution resolution, uint16_t bitrateKbps, FPS fps,
+                         const QString &rtmpURL);
+    bool isStaging() const {
+        return m_state == State::Staging;
+    }
+    bool isStaged() const {
+        return m_state == State::Staged;
+    }
+    bool fireLiveStream();
+    /**
+     * @brief Moves a running stream to another RTMP URL.
+     *
+     * Stop, configure and start are written back to back instead of waiting
+     * for each acknowledgement, keeping the outage to about one round trip.
+     * The stream settings of the last startLiveStream() are kept. Emits
+     * endpointSwitched() with the time from stop to the start acknowledgement;
+     * the RTMP handshake with the new server comes on top of that. Returns
+     * false if no stream was started yet, another operation is in progress or
+     * the URL does not fit a frame. Without a start acknowledgement within the
+     * operation timeout, error() is emitted and the streamer is idle again.
+     */
+    bool switchStreamEndpoint(const QString &rtmpURL);
+    // Re-sends the stream configuration with new encoder settings, keeping
+    // the URL. Returns false if no stream was started or another operation
+    // is in progress. Without an acknowledgement within the operation
+    // timeout, liveStreamReconfigureFailed() and error() are emitted and the
+    // streamer is idle again.
+    bool reconfigureLiveStream(Resolution resolution, uint16_t bitrateKbps, FPS fps);
+    bool isSwitchingEndpoint() const {
+        return m_state == State::Switching;
+    }
+    bool isReconfiguring() const {
+        return m_state == State::Reconfiguring;
+    }
+    // How long an endpoint switch or reconfiguration may wait for its
+    // acknowledgement.
+    void setOperationTimeout(int ms) {
+        m_operationTimeoutMs = ms;
+    }
+    // Whether a stream was started or staged, i.e. the accessors below mean
+    // something.
+    bool hasStreamSettings() const {
+        return m_hasStreamSettings;
+    }
+    // URL of the stream started last.
+    QString rtmpUrl() const {
+        return m_rtmpUrl;
+    }
+    // Encoder settings last sent to the camera.
+    Resolution resolution() const {
+        return m_pendingResolution;
+    }
+    uint16_t bitrateKbps() const {
+        return m_pendingBitrate;
+    }
+    FPS fps() const {
+        return m_pendingFps;
+    }
 
     void handleMessage(const Message &msg);
+    // Drops any request in progress, e.g. after the BLE link went down.
+    void reset();
+
+    // The camera pushes StreamingStatus periodically while it is live, so a
+    // recent one means a stream is running.
+    bool hasRecentStreamingStatus(int withinMs) const {
+        return m_lastStreamingStatus.isValid() && !m_lastStreamingStatus.hasExpired(withinMs);
+    }
+    // A stream started at least forMs ago that has not reported for as long.
+    bool isStreamStalled(int forMs) const {
+        return m_streamStarted.isValid() && m_streamStarted.hasExpired(forMs) &&
+               !hasRecentStreamingStatus(forMs);
+    }
 
 signals:
     void prepareToLiveStreamComplete();
     void startLiveStreamComplete();
     void stopLiveStreamComplete();
+    void endpointSwitched(const QString &rtmpURL, qint64 downtimeMs);
+    void liveStreamReconfigured();
+    void liveStreamReconfigureFailed(const QString &message);
+    void liveStreamStaged();
     void batteryPercentageChanged(int percentage);
+    void streamingStatusReceived(const QByteArray &payload);
     void error(const QString &message);
     void log(const QString &message);
 
 private:
-    enum class State { Idle, PreparingStage1, PreparingStage2, Starting, Stopping };
+    enum class State {
+        Idle,
+        PreparingStage1,
+        PreparingStage2,
+        Starting,
+        Stopping,
+        Switching,
+        Reconfiguring,
+        Staging,
+        Staged
+    };
+    void onOperationTimeout();
+
     Device *m_device;
     State m_state = State::Idle;
+    Timer *m_operationTimer;
+    int m_operationTimeoutMs = defaultOperationTimeoutMs;
+    ElapsedTimer m_lastStreamingStatus;
+    ElapsedTimer m_streamStarted;
+    ElapsedTimer m_switchStarted;
+    QString m_rtmpUrl;
+    bool m_hasStreamSettings = false;
 
-    Resolution m_pendingResolution;
-    uint16_t m_pendingBitrate;
-    FPS m_pendingFps;
+    Resolution m_pendingResolution = Resolution::Undefined;
+    uint16_t m_pendingBitrate = 0;
+    FPS m_pendingFps = FPS::Undefined;
     QString m_pendingRtmpUrl;
 
     void sendMessagePrepareToLiveStreamStage1();
     void sendMessagePrepareToLiveStreamStage2();
-    void sendMessageConfigureLiveStream(Resolution resolution, uint16_t bitrateKbps, FPS fps,
+    bool buildMessageConfigureLiveStream(Resolution resolution, uint16_t bitrateKbps, FPS fps,
+                                         const QString &rtmpURL, Message *msg);
+    bool sendMessageConfigureLiveStream(Resolution resolution, uint16_t bitrateKbps, FPS fps,
                                         const QString &rtmpURL);
     void sendMessageStartLiveStream();
     void sendMessageStopLiveStream();
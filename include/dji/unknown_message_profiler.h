@@ -0,0 +1,125 @@
+/**
+ * @file unknown_message_profiler.h
+ * @brief Statistics on received frames of unknown types.
+ *
+ * The subsystems drop frames whose type they do not know, which includes
+ * the Unknown0..5 placeholders. With profiling enabled on a Device, those
+ * frames are tallied per (subsystem, msgId, msgType): how many arrived and
+ * how often, how long their payloads are, and per payload offset which
+ * values it took. Offsets that never change, that count up, or that only
+ * take a few values are where decoding a new message usually starts.
+ *
+ * Profiles can be read or exported as JSON from any thread while frames
+ * keep arriving.
+ */
+
+#ifndef DJI_UNKNOWN_MESSAGE_PROFILER_H
+#define DJI_UNKNOWN_MESSAGE_PROFILER_H
+
+#include "dji/message.h"
+#include "dji/scheduler.h"
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+
+namespace dji {
+
+// Values seen at one payload offset.
+struct ByteProfile {
+    // Frames long enough to have this offset.
+    quint64 frames = 0;
+    quint8 first = 0;
+    quint8 last = 0;
+    quint8 min = 0xFF;
+    quint8 max = 0;
+    // Frames whose value differs from the previous frame's...
+    quint64 changes = 0;
+    // ...of which by exactly +1, modulo 256.
+    quint64 increments = 0;
+    // Bit v is set once value v was seen.
+    quint64 values[4] = {};
+
+    int distinct() const;
+    bool isConstant() const {
+        return changes == 0;
+    }
+    // Nearly every change is +1, as in a sequence number.
+    bool isCounter() const {
+        return changes > 0 && increments * 10 >= changes * 9;
+    }
+};
+
+struct UnknownMessageProfile {
+    SubsystemID subsystem = static_cast<SubsystemID>(0);
+    MessageID msgId = static_cast<MessageID>(0);
+    MessageType msgType = static_cast<MessageType>(0);
+
+    quint64 frames = 0;
+    quint64 payloadBytes = 0;
+    // On the library clock, in ms since profiling started.
+    qint64 firstSeenMs = 0;
+    qint64 lastSeenMs = 0;
+    // Between consecutive frames; -1 until there are two.
+    qint64 minIntervalMs = -1;
+    qint64 maxIntervalMs = -1;
+    // Payload length -> frames.
+    QMap<int, quint64> payloadLengths;
+    // One entry per offset up to the longest payload, capped at
+    // UnknownMessageProfiler::maxTrackedBytes().
+    QList<ByteProfile> bytes;
+    QByteArray lastPayload;
+
+    // Frames per second between the first and the last one; 0 until there
+    // are two.
+    double ratePerSecond() const;
+    // One character per tracked offset: '.' constant, '+' counter, 'e' a
+    // few values (up to 4, such as flags and enums), 'x' anything else.
+    QString variabilityMap() const;
+};
+
+class UnknownMessageProfiler {
+public:
+    static constexpr int defaultMaxKeys = 64;
+    static constexpr int defaultMaxTrackedBytes = 128;
+
+    // Frames of keys beyond maxKeys are only counted in droppedFrames().
+    explicit UnknownMessageProfiler(int maxKeys = defaultMaxKeys,
+                                    int maxTrackedBytes = defaultMaxTrackedBytes);
+
+    // Tallies msg if its type is unknown; other frames are ignored.
+    void record(const Message &msg);
+    void reset();
+
+    int maxKeys() const {
+        return m_maxKeys;
+    }
+    int maxTrackedBytes() const {
+        return m_maxTrackedBytes;
+    }
+
+    // Sorted by subsystem, msgId, then msgType.
+    QList<UnknownMessageProfile> profiles() const;
+    quint64 droppedFrames() const;
+    // profiles() with hex payloads and variability maps, for saving or
+    // sending to a backend.
+    QJsonObject toJson() const;
+
+private:
+    static quint64 key(const Message &msg) {
+        return (quint64(msg.subsystem) << 40) | (quint64(msg.msgId) << 24) |
+               quint64(msg.msgType);
+    }
+
+    int m_maxKeys;
+    int m_maxTrackedBytes;
+    ElapsedTimer m_clock;
+    mutable QMutex m_mutex;
+    QHash<quint64, UnknownMessageProfile> m_profiles;
+    quint64 m_droppedFrames = 0;
+};
+
+} // namespace dji
+
+#endif // DJI_UNKNOWN_MESSAGE_PROFILER_H
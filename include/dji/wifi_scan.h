@@ -0,0 +1,83 @@
+/**
+ * @file wifi_scan.h
+ * @brief Decoding of WiFi scan reports into a deduplicated access point table.
+ *
+ * While scanning, the camera pushes WiFiScanReport messages, each listing some
+ * of the access points it heard. The payload layout is inferred from captures:
+ *
+ *     count:u8, then count times { ssidLen:u8, ssid, rssi:i8, channel:u8, security:u8 }
+ *
+ * Truncated entries end the decoding; whatever was complete is kept.
+ */
+
+#ifndef DJI_WIFI_SCAN_H
+#define DJI_WIFI_SCAN_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+namespace dji {
+
+enum class WiFiSecurity { Open, WEP, WPA, WPA2, WPA3, Unknown };
+
+struct WiFiNetwork {
+    QString ssid;
+    // dBm; the strongest sighting since the table was cleared.
+    int rssi = 0;
+    int channel = 0;
+    WiFiSecurity security = WiFiSecurity::Unknown;
+};
+
+// One entry of a ranked StreamingOptions::wifiNetworks list.
+struct WiFiCredentials {
+    QString ssid;
+    QString psk;
+
+    bool operator==(const WiFiCredentials &other) const {
+        return ssid == other.ssid && psk == other.psk;
+    }
+    bool operator!=(const WiFiCredentials &other) const {
+        return !(*this == other);
+    }
+};
+
+class WiFiScanTable {
+public:
+    // Decodes one report; *ok is false if it was truncated or malformed.
+    static QList<WiFiNetwork> parseReport(const QByteArray &payload, bool *ok = nullptr);
+
+    // Merges a report into the table. Returns whether anything changed.
+    bool update(const QByteArray &payload);
+    bool update(const QList<WiFiNetwork> &networks);
+    void clear();
+
+    // Strongest first.
+    QList<WiFiNetwork> networks() const;
+    const WiFiNetwork *find(const QString &ssid) const;
+    bool contains(const QString &ssid) const {
+        return find(ssid) != nullptr;
+    }
+    int size() const {
+        return static_cast<int>(m_networks.size());
+    }
+    bool isEmpty() const {
+        return m_networks.isEmpty();
+    }
+
+    /**
+     * @brief Orders candidates for joining.
+     *
+     * Candidates heard in the scan come first, strongest first; candidates
+     * that were not heard (hidden or out of range) follow. Equal signals and
+     * unheard candidates keep the caller's ranking.
+     */
+    QList<WiFiCredentials> rank(const QList<WiFiCredentials> &candidates) const;
+
+private:
+    QList<WiFiNetwork> m_networks;
+};
+
+} // namespace dji
+
+#endif // DJI_WIFI_SCAN_H
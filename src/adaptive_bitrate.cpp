@@ -0,0 +1,165 @@
+/**
+ * @file adaptive_bitrate.cpp
+ * @brief Implementation of the adaptive bitrate controller and ladder policy.
+ */
+
+#include "dji/adaptive_bitrate.h"
+#include "dji/device.h"
+#include "dji/link_health_monitor.h"
+#include "dji/subsystem_streamer.h"
+#include <QtEndian>
+#include <algorithm>
+
+namespace dji {
+
+LadderBitratePolicy::LadderBitratePolicy(const QList<StreamSettings> &ladder)
+    : LadderBitratePolicy(ladder, Options()) {
+}
+
+LadderBitratePolicy::LadderBitratePolicy(const QList<StreamSettings> &ladder,
+                                         const Options &options)
+    : m_ladder(ladder), m_options(options) {
+}
+
+QList<StreamSettings> LadderBitratePolicy::defaultLadder() {
+    return {
+        {Resolution::Res1080p, 6000, FPS::FPS30}, {Resolution::Res1080p, 4000, FPS::FPS30},
+        {Resolution::Res720p, 2500, FPS::FPS30},  {Resolution::Res720p, 1500, FPS::FPS30},
+        {Resolution::Res480p, 1000, FPS::FPS30},  {Resolution::Res480p, 600, FPS::FPS30},
+    };
+}
+
+void LadderBitratePolicy::reset(const StreamSettings &ceiling) {
+    m_rungs = {ceiling};
+    for (StreamSettings rung : std::as_const(m_ladder)) {
+        if (rung.bitrateKbps < ceiling.bitrateKbps) {
+            rung.fps = ceiling.fps;
+            m_rungs.append(rung);
+        }
+    }
+    m_badSamples = 0;
+    m_goodSamples = 0;
+    m_upgradeAfter = m_options.upgradeAfter;
+    m_probing = false;
+    m_probeSamples = 0;
+}
+
+StreamSettings LadderBitratePolicy::decide(const StreamSettings &current,
+                                           const StreamTelemetry &telemetry) {
+    if (telemetry.deliveredKbps < 0 || m_rungs.isEmpty())
+        return current;
+
+    int index = static_cast<int>(m_rungs.indexOf(current));
+    if (index < 0)
+        index = 0;
+
+    if (telemetry.deliveredKbps < current.bitrateKbps * m_options.downgradeRatio) {
+        m_goodSamples = 0;
+        if (++m_badSamples < m_options.downgradeAfter)
+            return current;
+        m_badSamples = 0;
+        if (m_probing) {
+            m_probing = false;
+            m_upgradeAfter = std::min(m_upgradeAfter * 2,
+                                      m_options.upgradeAfter * m_options.maxUpgradeBackoff);
+        }
+        // At least one rung down, further if the throughput demands it.
+        int target = index + 1;
+        while (target < m_rungs.size() - 1 &&
+               m_rungs[target].bitrateKbps > telemetry.deliveredKbps * m_options.downgradeRatio) {
+            ++target;
+        }
+        return target < m_rungs.size() ? m_rungs[target] : current;
+    }
+
+    m_badSamples = 0;
+    if (m_probing && ++m_probeSamples >= m_options.upgradeAfter) {
+        m_probing = false;
+        m_upgradeAfter = m_options.upgradeAfter;
+    }
+    if (index == 0 || telemetry.linkScore < m_options.minLinkScoreToUpgrade) {
+        m_goodSamples = 0;
+        return current;
+    }
+    if (++m_goodSamples < m_upgradeAfter)
+        return current;
+    m_goodSamples = 0;
+    m_probing = true;
+    m_probeSamples = 0;
+    return m_rungs[index - 1];
+}
+
+AdaptiveBitrateController::AdaptiveBitrateController(Device *device, QObject *parent)
+    : QObject(parent), m_device(device), m_policy(std::make_unique<LadderBitratePolicy>()),
+      m_decoder(&AdaptiveBitrateController::decodeStreamingStatus) {
+    connect(device->streamer(), &SubsystemStreamer::streamingStatusReceived, this,
+            &AdaptiveBitrateController::onStreamingStatus);
+}
+
+AdaptiveBitrateController::~AdaptiveBitrateController() = default;
+
+void AdaptiveBitrateController::setPolicy(std::unique_ptr<BitratePolicy> policy) {
+    m_policy = std::move(policy);
+    if (m_running) {
+        m_policy->reset(m_settings);
+    }
+}
+
+void AdaptiveBitrateController::setTelemetryDecoder(TelemetryDecoder decoder) {
+    m_decoder = std::move(decoder);
+}
+
+StreamTelemetry AdaptiveBitrateController::decodeStreamingStatus(const QByteArray &payload) {
+    StreamTelemetry telemetry;
+    if (payload.size() >= 4) {
+        telemetry.deliveredKbps = qFromLittleEndian<quint16>(payload.constData() + 2);
+    }
+    return telemetry;
+}
+
+void AdaptiveBitrateController::start(const StreamSettings &ceiling) {
+    m_settings = ceiling;
+    m_policy->reset(ceiling);
+    m_lastReconfigure.invalidate();
+    m_running = true;
+}
+
+void AdaptiveBitrateController::stop() {
+    m_running = false;
+}
+
+void AdaptiveBitrateController::onStreamingStatus(const QByteArray &payload) {
+    if (!m_running || !m_decoder)
+        return;
+    StreamTelemetry telemetry = m_decoder(payload);
+    telemetry.linkScore = m_device->linkHealth()->score();
+    onTelemetry(telemetry);
+}
+
+void AdaptiveBitrateController::onTelemetry(const StreamTelemetry &telemetry) {
+    if (!m_running)
+        return;
+    if (m_lastReconfigure.isValid() && !m_lastReconfigure.hasExpired(m_minReconfigureIntervalMs))
+        return;
+    // Another operation owns the stream right now.
+    SubsystemStreamer *streamer = m_device->streamer();
+    if (streamer->isSwitchingEndpoint() || streamer->isReconfiguring())
+        return;
+
+    const StreamSettings next = m_policy->decide(m_settings, telemetry);
+    if (next == m_settings)
+        return;
+
+    emit log(QString("[DJI-BLE] Bitrate: %1 kbps delivered, reconfiguring from %2 to %3 kbps")
+                 .arg(telemetry.deliveredKbps)
+                 .arg(m_settings.bitrateKbps)
+                 .arg(next.bitrateKbps));
+    if (!streamer->reconfigureLiveStream(next.resolution, next.bitrateKbps, next.fps))
+        return;
+    m_settings = next;
+    m_lastReconfigure.start();
+    ++m_reconfigureCount;
+    emit settingsChanged(next, telemetry.deliveredKbps);
+}
+
+} // namespace dji
@@ -0,0 +1,51 @@
+/**
+ * @file battery_policy.cpp
+ * @brief Implementation of the battery history and discharge estimate.
+ */
+
+#include "dji/battery_policy.h"
+
+namespace dji {
+
+// A rate from fewer samples, or a shorter span, is mostly noise.
+static const int minSamplesForRate = 3;
+static const qint64 minSpanForRateMs = 60 * 1000;
+
+void BatteryHistory::addSample(qint64 timeMs, int percentage) {
+    if (!m_samples.isEmpty() && m_samples.last().percentage == percentage)
+        return;
+    m_samples.append(Sample{timeMs, percentage});
+    while (m_samples.size() > 2 && timeMs - m_samples.first().timeMs > m_windowMs) {
+        m_samples.removeFirst();
+    }
+}
+
+double BatteryHistory::dischargeRatePerMinute() const {
+    const qsizetype n = m_samples.size();
+    if (n < minSamplesForRate || m_samples.last().timeMs - m_samples.first().timeMs < minSpanForRateMs)
+        return 0.0;
+
+    // Least-squares slope, with time relative to the first sample in minutes.
+    const qint64 origin = m_samples.first().timeMs;
+    double sumT = 0, sumP = 0, sumTT = 0, sumTP = 0;
+    for (const Sample &s : m_samples) {
+        const double t = (s.timeMs - origin) / 60000.0;
+        sumT += t;
+        sumP += s.percentage;
+        sumTT += t * t;
+        sumTP += t * s.percentage;
+    }
+    const double denominator = n * sumTT - sumT * sumT;
+    if (denominator <= 0)
+        return 0.0;
+    return -(n * sumTP - sumT * sumP) / denominator;
+}
+
+qint64 BatteryHistory::timeToEmptyMs() const {
+    const double rate = dischargeRatePerMinute();
+    if (rate <= 0 || m_samples.isEmpty())
+        return -1;
+    return static_cast<qint64>(m_samples.last().percentage / rate * 60000.0);
+}
+
+} // namespace dji
@@ -0,0 +1,57 @@
+/**
+ * @file capture.cpp
+ * @brief Implementation of the capture record format.
+ */
+
+#include "dji/capture.h"
+#include <cstring>
+
+namespace dji::capture {
+
+bool hasMagic(const uint8_t *data, size_t size) {
+    return size >= magicSize && std::memcmp(data, magic, magicSize) == 0;
+}
+
+void writeRecordHeader(uint64_t timestampUs, uint16_t device, Direction direction, uint8_t *out) {
+    for (int i = 0; i < 8; ++i) {
+        out[i] = static_cast<uint8_t>(timestampUs >> (8 * i));
+    }
+    out[8] = static_cast<uint8_t>(device);
+    out[9] = static_cast<uint8_t>(device >> 8);
+    out[10] = static_cast<uint8_t>(direction);
+}
+
+size_t readRecord(const uint8_t *data, size_t size, Record *record) {
+    if (size < recordHeaderSize + protocol::overhead)
+        return 0;
+    if (data[10] > static_cast<uint8_t>(Direction::Sent))
+        return 0;
+
+    const uint8_t *frame = data + recordHeaderSize;
+    if (protocol::parseFrame(frame, size - recordHeaderSize, &record->frame) !=
+        protocol::ParseResult::Ok)
+        return 0;
+
+    record->timestampUs = 0;
+    for (int i = 0; i < 8; ++i) {
+        record->timestampUs |= static_cast<uint64_t>(data[i]) << (8 * i);
+    }
+    record->device = static_cast<uint16_t>(data[8] | (data[9] << 8));
+    record->direction = static_cast<Direction>(data[10]);
+    record->size = recordHeaderSize + protocol::frameLength(frame, size - recordHeaderSize);
+    return record->size;
+}
+
+size_t findRecord(const uint8_t *data, size_t size) {
+    Record record;
+    // Every frame starts with 0x55, so only offsets followed by one are tried.
+    for (size_t offset = 0; offset + recordHeaderSize < size; ++offset) {
+        if (data[offset + recordHeaderSize] != 0x55)
+            continue;
+        if (readRecord(data + offset, size - offset, &record) > 0)
+            return offset;
+    }
+    return size;
+}
+
+} // namespace dji::capture
@@ -0,0 +1,87 @@
+/**
+ * @file capture_recorder.cpp
+ * @brief Implementation of the capture recorder.
+ */
+
+#include "dji/capture_recorder.h"
+#include "dji/device.h"
+#include <QIODevice>
+#include <QMutexLocker>
+
+namespace dji {
+
+CaptureRecorder::CaptureRecorder(QIODevice *output) : m_output(output) {
+    m_clock.start();
+    m_output->write(capture::magic, capture::magicSize);
+}
+
+CaptureRecorder::~CaptureRecorder() {
+    for (const QPointer<Device> &device : std::as_const(m_devices)) {
+        if (device) {
+            device->removeListener(this);
+        }
+    }
+}
+
+int CaptureRecorder::attach(Device *device) {
+    QMutexLocker locker(&m_mutex);
+    const qsizetype index = m_devices.indexOf(device);
+    if (index >= 0)
+        return static_cast<int>(index);
+    m_devices.append(device);
+    device->addListener(this);
+    return static_cast<int>(m_devices.size() - 1);
+}
+
+void CaptureRecorder::detach(Device *device) {
+    QMutexLocker locker(&m_mutex);
+    const qsizetype index = m_devices.indexOf(device);
+    if (index < 0)
+        return;
+    m_devices[index] = nullptr;
+    device->removeListener(this);
+}
+
+quint64 CaptureRecorder::recordCount() const {
+    QMutexLocker locker(&m_mutex);
+    return m_records;
+}
+
+quint64 CaptureRecorder::writeErrors() const {
+    QMutexLocker locker(&m_mutex);
+    return m_writeErrors;
+}
+
+void CaptureRecorder::messageReceived(Device *device, const Message &msg) {
+    record(device, capture::Direction::Received, msg);
+}
+
+void CaptureRecorder::messageSent(Device *device, const Message &msg) {
+    record(device, capture::Direction::Sent, msg);
+}
+
+void CaptureRecorder::record(Device *device, capture::Direction direction, const Message &msg) {
+    uint8_t buffer[capture::maxRecordSize];
+    const size_t frameSize = protocol::serializeFrame(
+        msg.subsystem, msg.msgId, msg.msgType,
+        reinterpret_cast<const uint8_t *>(msg.payload.constData()),
+        static_cast<size_t>(msg.payload.size()), buffer + capture::recordHeaderSize,
+        sizeof(buffer) - capture::recordHeaderSize);
+    if (frameSize == 0)
+        return;
+
+    QMutexLocker locker(&m_mutex);
+    const qsizetype index = m_devices.indexOf(device);
+    if (index < 0)
+        return;
+    const auto timestampUs = static_cast<uint64_t>(m_clock.nsecsElapsed() / 1000);
+    capture::writeRecordHeader(timestampUs, static_cast<uint16_t>(index), direction, buffer);
+    const qint64 size = static_cast<qint64>(capture::recordHeaderSize + frameSize);
+    if (m_output->write(reinterpret_cast<const char *>(buffer), size) == size) {
+        ++m_records;
+    } else {
+        ++m_writeErrors;
+    }
+}
+
+} // namespace dji
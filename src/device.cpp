@@ -4,11 +4,14 @@
  */
 
 #include "dji/device.h"
+#include "dji/link_health_monitor.h"
 #include "dji/subsystem_configurer.h"
 #include "dji/subsystem_pairer.h"
 #include "dji/subsystem_streamer.h"
 #include <QDebug>
+#include <QMetaMethod>
 #include <QTimer>
+#include <algorithm>
 
 namespace dji {
 
@@ -31,6 +34,17 @@ Device::Device(QObject *parent) : QObject(parent) {
     connect(this, &Device::messageReceived, m_pairer, &SubsystemPairer::handleMessage);
     connect(this, &Device::messageReceived, m_streamer, &SubsystemStreamer::handleMessage);
     connect(this, &Device::messageReceived, m_configurer, &SubsystemConfigurer::handleMessage);
+
+    connect(this, &Device::disconnected, m_pairer, &SubsystemPairer::reset);
+    connect(this, &Device::disconnected, m_streamer, &SubsystemStreamer::reset);
+    connect(this, &Device::disconnected, m_configurer, &SubsystemConfigurer::reset);
+    connect(this, &Device::connected, m_configurer, &SubsystemConfigurer::invalidateCache);
+
+    m_linkHealth = new LinkHealthMonitor(this);
+    connect(this, &Device::messageReceived, m_linkHealth, &LinkHealthMonitor::onMessageReceived);
+    connect(this, &Device::rssiRead, m_linkHealth, &LinkHealthMonitor::onRssiRead);
+    connect(this, &Device::initialized, m_linkHealth, &LinkHealthMonitor::start);
+    connect(this, &Device::disconnected, m_linkHealth, &LinkHealthMonitor::stop);
 }
 
 Device::Device(const QBluetoothDeviceInfo &info, DeviceType type, QObject *parent)
@@ -49,6 +63,17 @@ Device::Device(const QBluetoothDeviceInfo &info, DeviceType type, QObject *paren
     connect(this, &Device::messageReceived, m_pairer, &SubsystemPairer::handleMessage);
     connect(this, &Device::messageReceived, m_streamer, &SubsystemStreamer::handleMessage);
     connect(this, &Device::messageReceived, m_configurer, &SubsystemConfigurer::handleMessage);
+
+    connect(this, &Device::disconnected, m_pairer, &SubsystemPairer::reset);
+    connect(this, &Device::disconnected, m_streamer, &SubsystemStreamer::reset);
+    connect(this, &Device::disconnected, m_configurer, &SubsystemConfigurer::reset);
+    connect(this, &Device::connected, m_configurer, &SubsystemConfigurer::invalidateCache);
+
+    m_linkHealth = new LinkHealthMonitor(this);
+    connect(this, &Device::messageReceived, m_linkHealth, &LinkHealthMonitor::onMessageReceived);
+    connect(this, &Device::rssiRead, m_linkHealth, &LinkHealthMonitor::onRssiRead);
+    connect(this, &Device::initialized, m_linkHealth, &LinkHealthMonitor::start);
+    connect(this, &Device::disconnected, m_linkHealth, &LinkHealthMonitor::stop);
 }
 
 Device::~Device() {
@@ -60,15 +85,33 @@ Device::~Device() {
 
 void Device::connectToDevice() {
     if (m_controller) {
+        // Tearing down the old link must not look like a dropout.
+        m_controller->disconnect(this);
         m_controller->disconnectFromDevice();
         delete m_controller;
     }
 
-    m_controller = QLowEnergyController::createCentral(m_deviceInfo, this);
+    // Services and characteristics belong to the old link; rediscover them.
+    m_service = nullptr;
+    m_charReceiver = QLowEnergyCharacteristic();
+    m_charSender = QLowEnergyCharacteristic();
+    m_charPairingRequestor = QLowEnergyCharacteristic();
+    m_initialized = false;
+    m_rxBuffer.clear();
+    m_mtu = defaultMtu;
+
+    m_controller = m_localAdapter.isNull()
+                       ? QLowEnergyController::createCentral(m_deviceInfo, this)
+                       : QLowEnergyController::createCentral(m_deviceInfo, m_localAdapter, this);
     connect(m_controller, &QLowEnergyController::connected, this, &Device::onControllerConnected);
     connect(m_controller, &QLowEnergyController::disconnected, this,
             &Device::onControllerDisconnected);
     connect(m_controller, &QLowEnergyController::errorOccurred, this, &Device::onControllerError);
+    connect(m_controller, &QLowEnergyController::mtuChanged, this, &Device::onMtuChanged);
+    connect(m_controller, &QLowEnergyController::connectionUpdated, this,
+            &Device::onConnectionUpdated);
+    connect(m_controller, &QLowEnergyController::rssiRead, this,
+            [this](qint16 rssi) { emit rssiRead(rssi); });
     connect(m_controller, &QLowEnergyController::serviceDiscovered, this,
             &Device::onServiceDiscovered);
     connect(m_controller, &QLowEnergyController::discoveryFinished, this,
@@ -88,14 +131,77 @@ void Device::disconnectFromDevice() {
 void Device::onControllerConnected() {
     emit log("[DJI-BLE] "
              "Controller connected. Discovering services...");
+    onMtuChanged(m_controller->mtu());
+    if (m_connectionProfileRequested) {
+        // Service discovery is the first burst of round trips; speed it up too.
+        m_controller->requestConnectionUpdate(parametersFor(m_connectionProfile));
+    }
     m_controller->discoverServices();
 }
 
+void Device::onConnectionUpdated(const QLowEnergyConnectionParameters &parameters) {
+    m_connectionParameters = parameters;
+    emit log("[DJI-BLE] " + QString("Connection updated: interval %1-%2 ms, latency %3, "
+                                    "supervision timeout %4 ms")
+                                .arg(parameters.minimumInterval())
+                                .arg(parameters.maximumInterval())
+                                .arg(parameters.latency())
+                                .arg(parameters.supervisionTimeout()));
+    emit connectionParametersUpdated(parameters);
+}
+
+void Device::requestConnectionProfile(ConnectionProfile profile) {
+    if (profile == m_connectionProfile && m_connectionProfileRequested)
+        return;
+    m_connectionProfile = profile;
+    m_connectionProfileRequested = true;
+    emit connectionProfileChanged(profile);
+
+    if (m_controller && (m_controller->state() == QLowEnergyController::ConnectedState ||
+                         m_controller->state() == QLowEnergyController::DiscoveringState ||
+                         m_controller->state() == QLowEnergyController::DiscoveredState)) {
+        m_controller->requestConnectionUpdate(parametersFor(profile));
+    }
+}
+
+QLowEnergyConnectionParameters Device::parametersFor(ConnectionProfile profile) {
+    QLowEnergyConnectionParameters parameters;
+    switch (profile) {
+    case ConnectionProfile::Balanced:
+        parameters.setIntervalRange(30, 50);
+        parameters.setLatency(0);
+        parameters.setSupervisionTimeout(4000);
+        break;
+    case ConnectionProfile::LowLatency:
+        parameters.setIntervalRange(7.5, 15);
+        parameters.setLatency(0);
+        parameters.setSupervisionTimeout(2000);
+        break;
+    case ConnectionProfile::LowPower:
+        // Up to 4 skipped events: ~625 ms worst case before the camera answers.
+        parameters.setIntervalRange(100, 125);
+        parameters.setLatency(4);
+        parameters.setSupervisionTimeout(6000);
+        break;
+    }
+    return parameters;
+}
+
+void Device::onMtuChanged(int mtu) {
+    // The controller reports -1 until an MTU is known.
+    const int effective = mtu > 3 ? mtu : defaultMtu;
+    if (effective != m_mtu) {
+        m_mtu = effective;
+        emit log("[DJI-BLE] " + QString("MTU is now %1").arg(m_mtu));
+    }
+}
+
 void Device::onControllerDisconnected() {
     emit log("[DJI-BLE] "
              "Controller disconnected");
     emit disconnected();
     m_initialized = false;
+    m_rxBuffer.clear();
 }
 
 void Device::onControllerError(QLowEnergyController::Error error) {
@@ -116,7 +222,8 @@ void Device::onServiceDiscoveryFinished() {
 void Device::discoverCharacteristics() {
     auto services = m_controller->services();
     for (auto serviceUuid : services) {
-        QLowEnergyService *service = m_controller->createServiceObject(serviceUuid, this);
+        // Parented to the controller so they go away with the link.
+        QLowEnergyService *service = m_controller->createServiceObject(serviceUuid, m_controller);
         if (!service)
             continue;
 
@@ -226,33 +333,162 @@ void Device::onCharacteristicReadFinished(const QLowEnergyCharacteristic &c,
 }
 
 void Device::receiveNotification(const QByteArray &data) {
-    emit log("[DJI-BLE] " + QString("Received notification: %1").arg(QString(data.toHex())));
-
-    bool ok = false;
-    Message msg = Message::parse(data, &ok);
-    if (!ok) {
-        emit log("[DJI-BLE] " +
-                 QString("Failed to parse incoming message: %1").arg(QString(data.toHex())));
+    // Formatting the hex dumps costs more than parsing; skip it unless
+    // someone listens.
+    static const QMetaMethod logSignal = QMetaMethod::fromSignal(&Device::log);
+    const bool logging = isSignalConnected(logSignal);
+    if (logging) {
+        emit log("[DJI-BLE] " + QString("Received notification: %1").arg(QString(data.toHex())));
+    }
+    notifyListeners([this, &data](DeviceListener *listener) {
+        listener->notificationReceived(this, data);
+    });
+
+    Message *parsed = nullptr;
+    if (!m_rxBuffer.isEmpty()) {
+        m_rxBuffer.append(data);
+        while (!m_rxBuffer.isEmpty()) {
+            const qsizetype used = takeFrame(m_rxBuffer, logging, &parsed);
+            if (used == 0)
+                return;
+            m_rxBuffer.remove(0, used);
+            if (parsed) {
+                deliverMessage(*parsed);
+            }
+        }
         return;
     }
 
-    emit log("[DJI-BLE] " + QString("Parsed message: subsystem=0x%1 id=0x%2 type=0x%3")
-                                .arg(static_cast<uint16_t>(msg.subsystem), 0, 16)
-                                .arg(static_cast<uint16_t>(msg.msgId), 0, 16)
-                                .arg(static_cast<uint32_t>(msg.msgType), 0, 16));
+    // Usually a notification holds whole frames, which are parsed in place;
+    // only the start of a split frame is kept for the next one.
+    QByteArrayView rest(data);
+    while (!rest.isEmpty()) {
+        const qsizetype used = takeFrame(rest, logging, &parsed);
+        if (used == 0) {
+            m_rxBuffer.append(rest);
+            return;
+        }
+        rest = rest.sliced(used);
+        if (parsed) {
+            deliverMessage(*parsed);
+        }
+    }
+}
+
+qsizetype Device::takeFrame(QByteArrayView data, bool logging, Message **parsed) {
+    *parsed = nullptr;
+    // Resynchronize on the next start byte.
+    const qsizetype start =
+        std::find(data.begin(), data.end(), static_cast<char>(0x55)) - data.begin();
+    if (start > 0)
+        return start;
+    if (data.size() < 4)
+        return 0;
+
+    const int length = Message::frameLength(data);
+    if (length < 0)
+        return 1;
+    if (data.size() < length)
+        return 0;
+
+    const QByteArrayView frame = data.first(length);
+    Message *msg = m_framePool.acquire();
+    if (!Message::parseInto(frame, msg)) {
+        if (logging) {
+            emit log("[DJI-BLE] " + QString("Failed to parse incoming message: %1")
+                                        .arg(QString(frame.toByteArray().toHex())));
+        }
+        // A bad CRC may mean a false start byte; only skip that byte.
+        return 1;
+    }
+
+    if (logging) {
+        emit log("[DJI-BLE] " + QString("Parsed message: subsystem=0x%1 id=0x%2 type=0x%3")
+                                    .arg(static_cast<uint16_t>(msg->subsystem), 0, 16)
+                                    .arg(static_cast<uint16_t>(msg->msgId), 0, 16)
+                                    .arg(static_cast<uint32_t>(msg->msgType), 0, 16));
+    }
+    *parsed = msg;
+    return length;
+}
+
+void Device::deliverMessage(const Message &msg) {
+    if (m_unknownMessageProfiler) {
+        m_unknownMessageProfiler->record(msg);
+    }
+    notifyListeners(
+        [this, &msg](DeviceListener *listener) { listener->messageReceived(this, msg); });
     emit messageReceived(msg);
 }
 
+void Device::notifyMessageSent(const Message &msg) {
+    m_linkHealth->onMessageSent(msg);
+    notifyListeners([this, &msg](DeviceListener *listener) { listener->messageSent(this, msg); });
+}
+
+void Device::setUnknownMessageProfiling(bool enabled) {
+    if (enabled && !m_unknownMessageProfiler) {
+        std::atomic_store(&m_unknownMessageProfiler, std::make_shared<UnknownMessageProfiler>());
+    } else if (!enabled) {
+        std::atomic_store(&m_unknownMessageProfiler, std::shared_ptr<UnknownMessageProfiler>());
+    }
+}
+
+std::shared_ptr<UnknownMessageProfiler> Device::unknownMessageProfiler() const {
+    return std::atomic_load(&m_unknownMessageProfiler);
+}
+
+void Device::addListener(DeviceListener *listener) {
+    if (listener && !m_listeners.contains(listener)) {
+        m_listeners.append(listener);
+    }
+}
+
+void Device::removeListener(DeviceListener *listener) {
+    const qsizetype index = m_listeners.indexOf(listener);
+    if (index < 0)
+        return;
+    if (m_notifying > 0) {
+        m_listeners[index] = nullptr;
+        m_listenersRemoved = true;
+    } else {
+        m_listeners.removeAt(index);
+    }
+}
+
+QList<QByteArray> Device::splitForMtu(const QByteArray &frame, int mtu) {
+    // 3 bytes of every ATT packet go to the opcode and the attribute handle.
+    const qsizetype chunkSize = qMax(mtu, defaultMtu) - 3;
+    QList<QByteArray> chunks;
+    for (qsizetype pos = 0; pos < frame.size(); pos += chunkSize) {
+        chunks.append(frame.mid(pos, chunkSize));
+    }
+    return chunks;
+}
+
 void Device::sendMessage(const Message &msg, bool noResponse) {
     if (!m_initialized || !m_service || !m_charSender.isValid()) {
         emit errorOccurred("Cannot send message: Device not initialized");
         return;
     }
 
-    QByteArray data = msg.serialize();
+    bool ok = false;
+    QByteArray data = msg.serialize(&ok);
+    if (!ok) {
+        emit errorOccurred(QString("Cannot send message: payload of %1 bytes exceeds %2 bytes")
+                               .arg(msg.payload.size())
+                               .arg(Message::maxPayloadSize));
+        return;
+    }
+
     QLowEnergyService::WriteMode mode =
         noResponse ? QLowEnergyService::WriteWithoutResponse : QLowEnergyService::WriteWithResponse;
-    m_service->writeCharacteristic(m_charSender, data, mode);
+    // The camera reassembles the frame from its length field; writes are queued in order.
+    const QList<QByteArray> chunks = splitForMtu(data, m_mtu);
+    for (const QByteArray &chunk : chunks) {
+        m_service->writeCharacteristic(m_charSender, chunk, mode);
+    }
+    notifyMessageSent(msg);
 }
 
 void Device::sendRawPairing(const QByteArray &data) {
@@ -273,6 +509,12 @@ void Device::sendRawPairing(const QByteArray &data) {
     }
 }
 
+void Device::readRssi() {
+    if (m_controller && m_controller->state() != QLowEnergyController::UnconnectedState) {
+        m_controller->readRssi();
+    }
+}
+
 bool Device::isConnected() const {
     return m_controller && m_controller->state() == QLowEnergyController::ConnectedState;
 }
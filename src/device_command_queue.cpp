@@ -0,0 +1,175 @@
+/**
+ * @file device_command_queue.cpp
+ * @brief Implementation of the thread-safe DeviceManager command facade.
+ */
+
+#include "dji/device_command_queue.h"
+#include "dji/device.h"
+#include "dji/device_flow.h"
+#include <utility>
+
+namespace dji {
+
+DeviceCommandQueue::DeviceCommandQueue(DeviceManager *manager, QObject *parent)
+    : QObject(parent), m_manager(manager) {
+    connect(manager, &DeviceManager::devicesChanged, this,
+            &DeviceCommandQueue::publishSnapshot);
+    connect(manager, &DeviceManager::isPairedChanged, this,
+            &DeviceCommandQueue::publishSnapshot);
+    connect(manager, &DeviceManager::isWiFiConnectedChanged, this,
+            &DeviceCommandQueue::publishSnapshot);
+    connect(manager, &DeviceManager::isStreamingChanged, this,
+            &DeviceCommandQueue::publishSnapshot);
+    connect(manager, &DeviceManager::finished, this, [this](Device *dev, bool success) {
+        complete(dev, success);
+        publishSnapshot();
+    });
+
+    publishSnapshot();
+}
+
+DeviceCommandQueue::~DeviceCommandQueue() {
+    Command command;
+    while (m_commands.pop(command)) {
+        resolve(command.promise, false);
+    }
+    for (const Promise &promise : std::as_const(m_pending)) {
+        resolve(promise, false);
+    }
+}
+
+QFuture<bool> DeviceCommandQueue::connectToWiFiAndStartStreaming(Device *dev,
+                                                                 const StreamingOptions &options) {
+    Command command;
+    command.type = Command::Type::StartStreaming;
+    command.device = dev;
+    command.options = options;
+    return submit(std::move(command));
+}
+
+QFuture<bool> DeviceCommandQueue::runFlow(Device *dev, FlowFactory makeFlow) {
+    Command command;
+    command.type = Command::Type::RunFlow;
+    command.device = dev;
+    command.makeFlow = std::move(makeFlow);
+    return submit(std::move(command));
+}
+
+QFuture<bool> DeviceCommandQueue::stop() {
+    Command command;
+    command.type = Command::Type::Stop;
+    return submit(std::move(command));
+}
+
+std::shared_ptr<const DeviceManagerSnapshot> DeviceCommandQueue::snapshot() const {
+    return std::atomic_load(&m_snapshot);
+}
+
+QFuture<bool> DeviceCommandQueue::submit(Command command) {
+    command.promise = std::make_shared<QPromise<bool>>();
+    command.promise->start();
+    QFuture<bool> future = command.promise->future();
+
+    m_commands.push(std::move(command));
+    if (!m_drainScheduled.exchange(true, std::memory_order_acq_rel)) {
+        QMetaObject::invokeMethod(this, [this]() { drain(); }, Qt::QueuedConnection);
+    }
+    return future;
+}
+
+void DeviceCommandQueue::drain() {
+    m_drainScheduled.store(false, std::memory_order_release);
+
+    Command command;
+    while (m_commands.pop(command)) {
+        execute(command);
+    }
+}
+
+void DeviceCommandQueue::execute(Command &command) {
+    switch (command.type) {
+    case Command::Type::StartStreaming:
+        // The manager would adopt an unknown device, which may live on any thread.
+        if (m_manager->handleOf(command.device).isNull()) {
+            resolve(command.promise, false);
+            return;
+        }
+        track(command.device, command.promise);
+        m_manager->connectToWiFiAndStartStreaming(command.device, command.options);
+        // hasActiveFlow changed without a manager signal.
+        publishSnapshot();
+        break;
+    case Command::Type::RunFlow: {
+        DeviceFlow *flow = nullptr;
+        if (!m_manager->handleOf(command.device).isNull() && command.makeFlow) {
+            flow = command.makeFlow();
+        }
+        if (!flow) {
+            resolve(command.promise, false);
+            return;
+        }
+        track(command.device, command.promise);
+        m_manager->runFlow(command.device, flow);
+        publishSnapshot();
+        break;
+    }
+    case Command::Type::Stop:
+        m_manager->stop();
+        for (const Promise &promise : std::as_const(m_pending)) {
+            resolve(promise, false);
+        }
+        m_pending.clear();
+        resolve(command.promise, true);
+        publishSnapshot();
+        break;
+    case Command::Type::None:
+        resolve(command.promise, false);
+        break;
+    }
+}
+
+void DeviceCommandQueue::track(Device *dev, const Promise &promise) {
+    // A new flow replaces the active one without it ever finishing.
+    failPending(dev);
+    m_pending.insert(dev, promise);
+}
+
+void DeviceCommandQueue::complete(Device *dev, bool success) {
+    Promise promise = m_pending.take(dev);
+    if (promise) {
+        resolve(promise, success);
+    }
+}
+
+void DeviceCommandQueue::failPending(Device *dev) {
+    complete(dev, false);
+}
+
+void DeviceCommandQueue::publishSnapshot() {
+    auto snapshot = std::make_shared<DeviceManagerSnapshot>();
+    snapshot->generation = ++m_generation;
+
+    const QList<Device *> devices = m_manager->devices();
+    snapshot->devices.reserve(devices.size());
+    for (Device *dev : devices) {
+        DeviceStateSnapshot state;
+        state.device = dev;
+        state.address = dev->address();
+        state.isPaired = m_manager->isPaired(dev);
+        state.isWiFiConnected = m_manager->isWiFiConnected(dev);
+        state.isStreaming = m_manager->isStreaming(dev);
+        state.hasActiveFlow = m_manager->hasActiveFlow(dev);
+        snapshot->devices.append(state);
+    }
+
+    std::atomic_store(&m_snapshot, std::shared_ptr<const DeviceManagerSnapshot>(snapshot));
+}
+
+void DeviceCommandQueue::resolve(const Promise &promise, bool success) {
+    if (!promise)
+        return;
+    promise->addResult(success);
+    promise->finish();
+}
+
+} // namespace dji
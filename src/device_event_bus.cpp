@@ -0,0 +1,137 @@
+/**
+ * @file device_event_bus.cpp
+ * @brief Implementation of the per-tick device event aggregation.
+ */
+
+#include "dji/device_event_bus.h"
+#include "dji/device.h"
+#include "dji/device_manager.h"
+#include "dji/scheduler.h"
+#include "dji/subsystem_streamer.h"
+
+namespace dji {
+
+DeviceEventBus::DeviceEventBus(DeviceManager *manager, QObject *parent)
+    : QObject(parent), m_manager(manager), m_timer(new Timer(this)) {
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    setTickRate(defaultTickRateHz);
+    connect(m_timer, &Timer::timeout, this, &DeviceEventBus::flush);
+
+    if (!manager)
+        return;
+
+    connect(manager, &DeviceManager::devicesChanged, this, &DeviceEventBus::attachDevices);
+    connect(manager, &DeviceManager::log, this, &DeviceEventBus::appendLog);
+    connect(manager, &DeviceManager::error, this, [this](const QString &message) {
+        m_pending.errors.append(message);
+        schedule();
+    });
+    connect(manager, &DeviceManager::finished, this, [this](Device *dev, bool success) {
+        m_pending.finished.append(qMakePair(dev, success));
+        schedule();
+    });
+    connect(manager, &DeviceManager::isPairedChanged, this, [this](Device *dev) {
+        pendingUpdate(dev).stateChanged = true;
+        schedule();
+    });
+    connect(manager, &DeviceManager::isWiFiConnectedChanged, this, [this](Device *dev) {
+        pendingUpdate(dev).stateChanged = true;
+        schedule();
+    });
+    connect(manager, &DeviceManager::isStreamingChanged, this, [this](Device *dev) {
+        pendingUpdate(dev).stateChanged = true;
+        schedule();
+    });
+
+    attachDevices();
+}
+
+void DeviceEventBus::setTickRate(int hz) {
+    m_tickRateHz = qMax(1, hz);
+    m_timer->setInterval(1000 / m_tickRateHz);
+}
+
+void DeviceEventBus::attachDevices() {
+    if (!m_manager)
+        return;
+    for (Device *dev : m_manager->devices()) {
+        attachDevice(dev);
+    }
+}
+
+void DeviceEventBus::attachDevice(Device *dev) {
+    if (!dev || m_attached.contains(dev))
+        return;
+    m_attached.insert(dev);
+
+    connect(dev, &QObject::destroyed, this, [this, dev]() {
+        m_attached.remove(dev);
+        m_pendingDevices.remove(dev);
+    });
+    connect(dev, &Device::messageReceived, this, [this, dev](const Message &msg) {
+        DeviceEventBatch::DeviceUpdate &update = pendingUpdate(dev);
+        update.messagesReceived++;
+        update.lastMessage = msg;
+        schedule();
+    });
+    connect(dev->streamer(), &SubsystemStreamer::batteryPercentageChanged, this,
+            [this, dev](int percentage) {
+                pendingUpdate(dev).batteryPercentage = percentage;
+                schedule();
+            });
+}
+
+DeviceEventBatch::DeviceUpdate &DeviceEventBus::pendingUpdate(Device *dev) {
+    auto it = m_pendingDevices.find(dev);
+    if (it == m_pendingDevices.end()) {
+        DeviceEventBatch::DeviceUpdate update;
+        update.device = dev;
+        it = m_pendingDevices.insert(dev, update);
+    }
+    return it.value();
+}
+
+void DeviceEventBus::appendLog(const QString &message) {
+    if (m_pending.logs.size() >= m_maxLogsPerBatch) {
+        m_pending.droppedLogs++;
+    } else {
+        m_pending.logs.append(message);
+    }
+    schedule();
+}
+
+void DeviceEventBus::schedule() {
+    if (!m_timer->isActive()) {
+        m_timer->start();
+    }
+}
+
+void DeviceEventBus::flush() {
+    m_timer->stop();
+
+    DeviceEventBatch batch;
+    batch.logs.swap(m_pending.logs);
+    batch.errors.swap(m_pending.errors);
+    batch.finished.swap(m_pending.finished);
+    batch.droppedLogs = m_pending.droppedLogs;
+    m_pending.droppedLogs = 0;
+
+    batch.devices.reserve(m_pendingDevices.size());
+    for (auto it = m_pendingDevices.begin(); it != m_pendingDevices.end(); ++it) {
+        DeviceEventBatch::DeviceUpdate update = it.value();
+        if (m_manager) {
+            update.isPaired = m_manager->isPaired(update.device);
+            update.isWiFiConnected = m_manager->isWiFiConnected(update.device);
+            update.isStreaming = m_manager->isStreaming(update.device);
+        }
+        batch.devices.append(update);
+    }
+    m_pendingDevices.clear();
+
+    if (!batch.isEmpty()) {
+        emit batchReady(batch);
+    }
+}
+
+} // namespace dji
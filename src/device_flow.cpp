@@ -1,29 +1,45 @@
 #include "dji/device_flow.h"
 #include "dji/device.h"
+#include "dji/scheduler.h"
 #include "dji/subsystem_pairer.h"
 #include "dji/subsystem_streamer.h"
+#include <QStringList>
 
 namespace dji {
 
 StreamingStarter::StreamingStarter(const StreamingOptions &options, QObject *parent)
-    : DeviceFlow(parent), m_options(options) {}
+    : DeviceFlow(parent), m_options(options), m_probeTimer(new Timer(this)),
+      m_scanTimer(new Timer(this)) {
+    m_probeTimer->setSingleShot(true);
+    connect(m_probeTimer, &Timer::timeout, this, &StreamingStarter::onProbeTimeout);
+    m_scanTimer->setSingleShot(true);
+    connect(m_scanTimer, &Timer::timeout, this, &StreamingStarter::onScanTimeout);
+}
 
 void StreamingStarter::start(Device *dev) {
     m_device = dev;
 
     connect(dev, &Device::initialized, this, &StreamingStarter::onInitialized);
+    connect(dev, &Device::disconnected, this, &StreamingStarter::onDisconnected);
     connect(dev->pairer(), &SubsystemPairer::pairingComplete, this,
             &StreamingStarter::onPairingComplete);
     connect(dev->pairer(), &SubsystemPairer::wifiConnected, this,
             &StreamingStarter::onWifiConnected);
+    connect(dev->pairer(), &SubsystemPairer::wifiConnectFailed, this,
+            &StreamingStarter::onWifiConnectFailed);
+    connect(dev->pairer(), &SubsystemPairer::wifiNetworksChanged, this,
+            &StreamingStarter::onWifiNetworksChanged);
     connect(dev->pairer(), &SubsystemPairer::error, this, &StreamingStarter::onError);
 
     connect(dev->streamer(), &SubsystemStreamer::prepareToLiveStreamComplete, this,
             &StreamingStarter::onPrepareComplete);
     connect(dev->streamer(), &SubsystemStreamer::startLiveStreamComplete, this,
             &StreamingStarter::onStartComplete);
+    connect(dev->streamer(), &SubsystemStreamer::streamingStatusReceived, this,
+            &StreamingStarter::onStreamingStatus);
     connect(dev->streamer(), &SubsystemStreamer::error, this, &StreamingStarter::onError);
 
+    m_step = Step::Connecting;
     if (dev->isInitialized()) {
         onInitialized();
     } else if (!dev->isConnected()) {
@@ -37,43 +53,251 @@ void StreamingStarter::start(Device *dev) {
 }
 
 void StreamingStarter::stop() {
+    m_step = Step::Done;
+    m_probeTimer->stop();
+    m_scanTimer->stop();
     if (m_device) {
         m_device->streamer()->stopLiveStream();
     }
 }
 
 void StreamingStarter::onInitialized() {
+    if (m_step != Step::Connecting)
+        return;
     emit log(QString("[DJI-BLE] Flow: Device %1 initialized. Starting pairing...")
                  .arg(m_device->deviceInfo().address().toString()));
+    m_step = Step::Pairing;
     m_device->pairer()->pair();
 }
 
+void StreamingStarter::onDisconnected() {
+    if (m_step == Step::Idle || m_step == Step::Done)
+        return;
+    // Whatever was in flight is lost; probe and plan again once the link is back.
+    emit log(QString("[DJI-BLE] Flow: Device %1 disconnected. Waiting for reconnection...")
+                 .arg(m_device->deviceInfo().address().toString()));
+    m_probeTimer->stop();
+    m_scanTimer->stop();
+    m_plan.clear();
+    m_wifiQueue.clear();
+    m_step = Step::Connecting;
+}
+
 void StreamingStarter::onPairingComplete() {
-    emit log(QString("[DJI-BLE] Flow: Pairing complete for %1. Preparing to live stream...")
+    if (m_step != Step::Pairing)
+        return;
+    emit log(QString("[DJI-BLE] Flow: Pairing complete for %1.")
+                 .arg(m_device->deviceInfo().address().toString()));
+    probe();
+}
+
+void StreamingStarter::probe() {
+    const QString address = m_device->deviceInfo().address().toString();
+    if (m_device->streamer()->hasRecentStreamingStatus(m_options.probeTimeoutMs)) {
+        m_progress.isPrepared = true;
+        if (isStreamingWithOptions()) {
+            emit log(QString("[DJI-BLE] Flow: %1 is already streaming.").arg(address));
+            m_progress.isWiFiConnected = true;
+            m_progress.isStreaming = true;
+        } else {
+            emit log(QString("[DJI-BLE] Flow: %1 streams with other or unknown settings; "
+                             "reconfiguring.")
+                         .arg(address));
+            m_progress.isStreaming = false;
+        }
+        plan();
+    } else if (m_progress.isStreaming) {
+        emit log(QString("[DJI-BLE] Flow: Waiting for %1 to confirm its stream...").arg(address));
+        m_step = Step::Probing;
+        m_probeTimer->start(m_options.probeTimeoutMs);
+    } else {
+        plan();
+    }
+}
+
+bool StreamingStarter::isStreamingWithOptions() const {
+    const SubsystemStreamer *streamer = m_device->streamer();
+    if (!streamer->hasStreamSettings() || streamer->rtmpUrl() != m_options.rtmpUrl ||
+        streamer->resolution() != m_options.resolution || streamer->fps() != m_options.fps)
+        return false;
+    // The bitrate controller may hold the stream below the requested ceiling.
+    return m_options.adaptiveBitrate ? streamer->bitrateKbps() <= m_options.bitrateKbps
+                                     : streamer->bitrateKbps() == m_options.bitrateKbps;
+}
+
+void StreamingStarter::onStreamingStatus() {
+    if (m_step != Step::Probing)
+        return;
+    m_probeTimer->stop();
+    emit log(QString("[DJI-BLE] Flow: %1 confirmed its stream.")
+                 .arg(m_device->deviceInfo().address().toString()));
+    m_progress.isPrepared = true;
+    m_progress.isWiFiConnected = true;
+    plan();
+}
+
+void StreamingStarter::onProbeTimeout() {
+    if (m_step != Step::Probing)
+        return;
+    emit log(QString("[DJI-BLE] Flow: No streaming status from %1; the stream has to be started.")
                  .arg(m_device->deviceInfo().address().toString()));
-    m_device->streamer()->prepareToLiveStream();
+    m_progress.isStreaming = false;
+    plan();
+}
+
+void StreamingStarter::plan() {
+    m_plan.clear();
+    QStringList names;
+    if (!m_progress.isPrepared && !m_progress.isWiFiConnected) {
+        m_plan.append(Step::Preparing);
+        names.append("prepare");
+    }
+    if (!m_progress.isWiFiConnected) {
+        if (wifiCandidates().size() > 1) {
+            m_plan.append(Step::ScanningWiFi);
+            names.append("scan");
+        }
+        m_plan.append(Step::ConnectingWiFi);
+        names.append("wifi");
+    }
+    if (!m_progress.isStreaming && !m_options.standby) {
+        m_plan.append(Step::Starting);
+        names.append("start");
+    }
+    emit log(QString("[DJI-BLE] Flow: Plan for %1: %2")
+                 .arg(m_device->deviceInfo().address().toString(),
+                      names.isEmpty() ? QString("nothing to do") : names.join(", ")));
+    advance();
 }
 
 void StreamingStarter::onPrepareComplete() {
-    emit log(QString("[DJI-BLE] Flow: Prepare complete for %1. Connecting to WiFi %2...")
-                 .arg(m_device->deviceInfo().address().toString(), m_options.ssid));
-    m_device->pairer()->connectToWiFi(m_options.ssid, m_options.psk);
+    // Record the ack even if the link dropped since; it need not be redone.
+    m_progress.isPrepared = true;
+    if (m_step != Step::Preparing)
+        return;
+    emit log(QString("[DJI-BLE] Flow: Prepare complete for %1.")
+                 .arg(m_device->deviceInfo().address().toString()));
+    advance();
+}
+
+QList<WiFiCredentials> StreamingStarter::wifiCandidates() const {
+    if (!m_options.wifiNetworks.isEmpty())
+        return m_options.wifiNetworks;
+    return {WiFiCredentials{m_options.ssid, m_options.psk}};
+}
+
+bool StreamingStarter::scanCoversCandidates() const {
+    const WiFiScanTable &table = m_device->pairer()->wifiScanTable();
+    for (const WiFiCredentials &candidate : wifiCandidates()) {
+        if (!table.contains(candidate.ssid))
+            return false;
+    }
+    return true;
+}
+
+void StreamingStarter::onWifiNetworksChanged() {
+    // No need to wait out the scan once every candidate was heard.
+    if (m_step == Step::ScanningWiFi && scanCoversCandidates()) {
+        finishScan();
+    }
+}
+
+void StreamingStarter::onScanTimeout() {
+    if (m_step == Step::ScanningWiFi) {
+        finishScan();
+    }
+}
+
+void StreamingStarter::finishScan() {
+    m_scanTimer->stop();
+    const WiFiScanTable &table = m_device->pairer()->wifiScanTable();
+    m_wifiQueue = table.rank(wifiCandidates());
+
+    QStringList names;
+    for (const WiFiCredentials &candidate : std::as_const(m_wifiQueue)) {
+        const WiFiNetwork *heard = table.find(candidate.ssid);
+        names.append(heard ? QString("%1 (%2 dBm)").arg(candidate.ssid).arg(heard->rssi)
+                           : QString("%1 (not heard)").arg(candidate.ssid));
+    }
+    emit log(QString("[DJI-BLE] Flow: WiFi candidates for %1: %2")
+                 .arg(m_device->deviceInfo().address().toString(), names.join(", ")));
+    advance();
+}
+
+void StreamingStarter::joinNextWiFi() {
+    const WiFiCredentials wifi = m_wifiQueue.takeFirst();
+    emit log(QString("[DJI-BLE] Flow: Joining WiFi %1 for %2...")
+                 .arg(wifi.ssid, m_device->deviceInfo().address().toString()));
+    m_device->pairer()->connectToWiFi(wifi.ssid, wifi.psk);
 }
 
 void StreamingStarter::onWifiConnected() {
-    emit log(QString("[DJI-BLE] Flow: WiFi connected for %1. Starting live stream...")
+    m_progress.isWiFiConnected = true;
+    if (m_step != Step::ConnectingWiFi)
+        return;
+    emit log(QString("[DJI-BLE] Flow: WiFi connected for %1.")
                  .arg(m_device->deviceInfo().address().toString()));
-    m_device->streamer()->startLiveStream(m_options.resolution, m_options.bitrateKbps, m_options.fps,
-                                     m_options.rtmpUrl);
+    m_wifiQueue.clear();
+    advance();
+}
+
+void StreamingStarter::onWifiConnectFailed(const QString &reason) {
+    if (m_step != Step::ConnectingWiFi)
+        return;
+    if (m_wifiQueue.isEmpty()) {
+        onError(QString("No WiFi network could be joined. Last error: %1").arg(reason));
+        return;
+    }
+    emit log(QString("[DJI-BLE] Flow: %1 Trying the next network.").arg(reason));
+    joinNextWiFi();
 }
 
 void StreamingStarter::onStartComplete() {
+    m_progress.isStreaming = true;
+    if (m_step != Step::Starting)
+        return;
     emit log(QString("[DJI-BLE] Flow: Live stream started for %1.")
                  .arg(m_device->deviceInfo().address().toString()));
-    emit finished(m_device, true);
+    advance();
+}
+
+void StreamingStarter::advance() {
+    if (m_plan.isEmpty()) {
+        m_step = Step::Done;
+        emit finished(m_device, true);
+        return;
+    }
+
+    m_step = m_plan.takeFirst();
+    switch (m_step) {
+    case Step::Preparing:
+        m_device->streamer()->prepareToLiveStream();
+        break;
+    case Step::ScanningWiFi:
+        m_device->pairer()->startScanningWiFi();
+        m_scanTimer->start(m_options.wifiScanTimeoutMs);
+        break;
+    case Step::ConnectingWiFi:
+        if (m_wifiQueue.isEmpty()) {
+            m_wifiQueue = wifiCandidates();
+        }
+        joinNextWiFi();
+        break;
+    case Step::Starting:
+        m_device->streamer()->startLiveStream(m_options.resolution, m_options.bitrateKbps,
+                                              m_options.fps, m_options.rtmpUrl);
+        break;
+    default:
+        break;
+    }
 }
 
 void StreamingStarter::onError(const QString &msg) {
+    if (m_step == Step::Done)
+        return;
+    m_step = Step::Done;
+    m_probeTimer->stop();
+    m_scanTimer->stop();
     emit log(QString("[DJI-BLE] Flow error: %1").arg(msg));
     emit finished(m_device, false);
 }
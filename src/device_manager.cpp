@@ -4,16 +4,43 @@
  */
 
 #include "dji/device_manager.h"
+#include "dji/adaptive_bitrate.h"
 #include "dji/device.h"
 #include "dji/device_flow.h"
+#include "dji/fleet_operation.h"
+#include "dji/link_health_monitor.h"
+#include "dji/scheduler.h"
+#include "dji/subsystem_configurer.h"
 #include "dji/subsystem_pairer.h"
 #include "dji/subsystem_streamer.h"
 #include <QBluetoothDeviceDiscoveryAgent>
 #include <QDebug>
+#include <algorithm>
+#include <memory>
 
 namespace dji {
 
-DeviceManager::DeviceManager(Device *device, QObject *parent) : QObject(parent) {
+static bool sameWiFi(const StreamingOptions &a, const StreamingOptions &b) {
+    return a.ssid == b.ssid && a.psk == b.psk && a.wifiNetworks == b.wifiNetworks;
+}
+
+static bool sameStream(const StreamingOptions &a, const StreamingOptions &b) {
+    return sameWiFi(a, b) && a.rtmpUrl == b.rtmpUrl && a.resolution == b.resolution &&
+           a.bitrateKbps == b.bitrateKbps && a.fps == b.fps;
+}
+
+// How often streams with a backup URL are checked for stalls.
+static const int failoverCheckIntervalMs = 500;
+// A fired battery threshold re-arms once the battery is this much above it.
+static const int batteryRearmMargin = 5;
+// LowerBitrate never goes below this.
+static const uint16_t minBatteryBitrateKbps = 600;
+
+DeviceManager::DeviceManager(Device *device, QObject *parent)
+    : QObject(parent), m_failoverTimer(new Timer(this)) {
+    m_clock.start();
+    m_failoverTimer->setInterval(failoverCheckIntervalMs);
+    connect(m_failoverTimer, &Timer::timeout, this, &DeviceManager::checkStreamFailover);
     if (device) {
         addDevice(device);
     }
@@ -24,60 +51,231 @@ DeviceManager::~DeviceManager() {
 }
 
 Device *DeviceManager::device() const {
-    return m_devices.isEmpty() ? nullptr : m_devices.first();
+    return m_registry.isEmpty() ? nullptr : m_registry.at(0).device;
+}
+
+QList<Device *> DeviceManager::devices() const {
+    QList<Device *> result;
+    result.reserve(static_cast<qsizetype>(m_registry.size()));
+    for (const DeviceState &state : m_registry) {
+        result.append(state.device);
+    }
+    return result;
+}
+
+Device *DeviceManager::deviceFor(DeviceHandle handle) const {
+    const DeviceState *state = m_registry.get(handle);
+    return state ? state->device : nullptr;
 }
 
 bool DeviceManager::isPaired(Device *dev) const {
     if (!dev)
         dev = device();
-    return dev ? m_deviceStates.value(dev).isPaired : false;
+    const DeviceState *state = stateOf(dev);
+    return state && state->isPaired;
 }
 
 bool DeviceManager::isWiFiConnected(Device *dev) const {
     if (!dev)
         dev = device();
-    return dev ? m_deviceStates.value(dev).isWiFiConnected : false;
+    const DeviceState *state = stateOf(dev);
+    return state && state->isWiFiConnected;
 }
 
 bool DeviceManager::isStreaming(Device *dev) const {
     if (!dev)
         dev = device();
-    return dev ? m_deviceStates.value(dev).isStreaming : false;
+    const DeviceState *state = stateOf(dev);
+    return state && state->isStreaming;
+}
+
+bool DeviceManager::isPaired(DeviceHandle handle) const {
+    const DeviceState *state = m_registry.get(handle);
+    return state && state->isPaired;
+}
+
+bool DeviceManager::isWiFiConnected(DeviceHandle handle) const {
+    const DeviceState *state = m_registry.get(handle);
+    return state && state->isWiFiConnected;
+}
+
+bool DeviceManager::isStreaming(DeviceHandle handle) const {
+    const DeviceState *state = m_registry.get(handle);
+    return state && state->isStreaming;
+}
+
+bool DeviceManager::hasActiveFlow(Device *dev) const {
+    const DeviceState *state = stateOf(dev);
+    return state && state->activeFlow;
 }
 
 void DeviceManager::addDevice(Device *device) {
-    if (!device || m_devices.contains(device))
+    if (!device || m_handles.contains(device))
         return;
 
-    m_devices.append(device);
-    m_deviceStates[device] = DeviceState();
+    DeviceState state;
+    state.device = device;
+    const DeviceHandle handle = m_registry.insert(state);
+    m_handles.insert(device, handle);
 
-    connect(device, &Device::disconnected, this, [this, device]() {
-        if (m_deviceStates.contains(device) && m_deviceStates[device].activeFlow) {
-            onError(device, "Device disconnected during flow");
-        }
-    });
+    // The lambdas below capture the handle, never the pointer: once the device
+    // is taken or destroyed they resolve to nothing instead of dangling.
+    connect(device, &QObject::destroyed, this, [this, handle]() { forgetDevice(handle); });
+    connect(device, &Device::disconnected, this,
+            [this, handle]() { onDeviceDisconnected(handle); });
+    connect(device, &Device::initialized, this,
+            [this, handle]() { onDeviceInitialized(handle); });
     connect(device, &Device::errorOccurred, this,
-            [this, device](const QString &msg) { onError(device, msg); });
+            [this, handle](const QString &msg) { onError(deviceFor(handle), msg); });
 
     connect(device->pairer(), &SubsystemPairer::pairingComplete, this,
-            [this, device]() { onPairingComplete(device); });
+            [this, handle]() { onPairingComplete(handle); });
     connect(device->pairer(), &SubsystemPairer::wifiConnected, this,
-            [this, device]() { onWifiConnected(device); });
+            [this, handle]() { onWifiConnected(handle); });
     connect(device->pairer(), &SubsystemPairer::error, this,
-            [this, device](const QString &msg) { onError(device, msg); });
+            [this, handle](const QString &msg) { onError(deviceFor(handle), msg); });
+    // Not a pairer error so a flow can fall back to the next network, but still reported.
+    connect(device->pairer(), &SubsystemPairer::wifiConnectFailed, this,
+            [this, handle](const QString &reason) { onError(deviceFor(handle), reason); });
     connect(device->pairer(), &SubsystemPairer::log, this, &DeviceManager::log);
 
     connect(device->streamer(), &SubsystemStreamer::prepareToLiveStreamComplete, this,
-            [this, device]() { onPrepareComplete(device); });
+            [this, handle]() { onPrepareComplete(handle); });
     connect(device->streamer(), &SubsystemStreamer::startLiveStreamComplete, this,
-            [this, device]() { onStartComplete(device); });
+            [this, handle]() { onStartComplete(handle); });
     connect(device->streamer(), &SubsystemStreamer::stopLiveStreamComplete, this,
-            [this, device]() { onStopComplete(device); });
+            [this, handle]() { onStopComplete(handle); });
+    connect(device->streamer(), &SubsystemStreamer::batteryPercentageChanged, this,
+            [this, handle](int percentage) { onBatteryPercentage(handle, percentage); });
+    connect(device->streamer(), &SubsystemStreamer::endpointSwitched, this,
+            [this, handle](const QString &rtmpUrl, qint64 downtimeMs) {
+                onEndpointSwitched(handle, rtmpUrl, downtimeMs);
+            });
     connect(device->streamer(), &SubsystemStreamer::error, this,
-            [this, device](const QString &msg) { onError(device, msg); });
+            [this, handle](const QString &msg) { onError(deviceFor(handle), msg); });
     connect(device->streamer(), &SubsystemStreamer::log, this, &DeviceManager::log);
 
+    connect(device->linkHealth(), &LinkHealthMonitor::degraded, this,
+            [this, handle](int score, const QString &reason) {
+                onLinkDegraded(handle, score, reason);
+            });
+    connect(device->linkHealth(), &LinkHealthMonitor::recovered, this,
+            [this, handle](int score) { onLinkRecovered(handle, score); });
+
+    emit deviceChanged();
+    emit devicesChanged();
+}
+
+void DeviceManager::addDevice(Device *device, const DeviceTransfer &transfer) {
+    if (!device || m_handles.contains(device))
+        return;
+
+    // Known before devicesChanged() announces the device.
+    if (transfer.hasStreamingOptions) {
+        m_streamingOptions.insert(device, transfer.streamingOptions);
+    }
+    if (!transfer.batteryHistory.samples().isEmpty() || !transfer.batteryFiredAt.isEmpty()) {
+        BatteryState &battery = m_battery[device];
+        const qint64 shiftMs = m_clock.elapsed() - transfer.takenAtMs;
+        battery.history.setWindow(m_batteryPolicy.historyWindowMs);
+        for (const BatteryHistory::Sample &sample : transfer.batteryHistory.samples()) {
+            battery.history.addSample(sample.timeMs + shiftMs, sample.percentage);
+        }
+        battery.firedAt = transfer.batteryFiredAt;
+    }
+    if (AdaptiveBitrateController *controller = transfer.bitrateController) {
+        connect(controller, &AdaptiveBitrateController::log, this, &DeviceManager::log);
+        m_bitrateControllers.insert(device, controller);
+    }
+
+    addDevice(device);
+    DeviceState *state = stateOf(device);
+    state->isPaired = transfer.isPaired;
+    state->isWiFiConnected = transfer.isWiFiConnected;
+    state->isPrepared = transfer.isPrepared;
+}
+
+bool DeviceManager::takeDevice(Device *device, DeviceTransfer *transfer) {
+    const DeviceHandle handle = m_handles.value(device);
+    DeviceState *state = m_registry.get(handle);
+    if (!state)
+        return false;
+
+    if (transfer) {
+        *transfer = DeviceTransfer();
+        transfer->isPaired = state->isPaired;
+        transfer->isWiFiConnected = state->isWiFiConnected;
+        transfer->isPrepared = state->isPrepared;
+        auto options = m_streamingOptions.constFind(device);
+        if (options != m_streamingOptions.constEnd()) {
+            transfer->hasStreamingOptions = true;
+            transfer->streamingOptions = options.value();
+        }
+        auto battery = m_battery.constFind(device);
+        if (battery != m_battery.constEnd()) {
+            transfer->batteryHistory = battery->history;
+            transfer->batteryFiredAt = battery->firedAt;
+        }
+        transfer->takenAtMs = m_clock.elapsed();
+    }
+
+    if (DeviceFlow *flow = state->activeFlow) {
+        disconnect(flow, nullptr, this, nullptr);
+        flow->stop();
+        flow->deleteLater();
+    }
+
+    disconnect(device, nullptr, this, nullptr);
+    disconnect(device->pairer(), nullptr, this, nullptr);
+    disconnect(device->streamer(), nullptr, this, nullptr);
+    disconnect(device->linkHealth(), nullptr, this, nullptr);
+    m_handles.remove(device);
+    m_streamingOptions.remove(device);
+    m_battery.remove(device);
+    if (AdaptiveBitrateController *controller = m_bitrateControllers.take(device)) {
+        controller->stop();
+        disconnect(controller, nullptr, this, nullptr);
+        // Otherwise the next manager would create a second one next to it.
+        if (transfer) {
+            transfer->bitrateController = controller;
+        } else {
+            delete controller;
+        }
+    }
+    m_registry.erase(handle);
+    if (device->parent() == this) {
+        device->setParent(nullptr);
+    }
+
+    emit deviceChanged();
+    emit devicesChanged();
+    return true;
+}
+
+void DeviceManager::forgetDevice(DeviceHandle handle) {
+    // Called from QObject::destroyed: the pointer is only used as a key here.
+    DeviceState *state = m_registry.get(handle);
+    if (!state)
+        return;
+
+    Device *dev = state->device;
+    DeviceFlow *flow = state->activeFlow;
+    const bool reportFlow = flow && !state->isResuming;
+    m_handles.remove(dev);
+    m_streamingOptions.remove(dev);
+    m_battery.remove(dev);
+    // Destroyed along with the device.
+    m_bitrateControllers.remove(dev);
+    m_registry.erase(handle);
+
+    if (flow) {
+        disconnect(flow, nullptr, this, nullptr);
+        flow->deleteLater();
+    }
+    if (reportFlow) {
+        emit finished(dev, false);
+    }
+
     emit deviceChanged();
     emit devicesChanged();
 }
@@ -85,7 +283,9 @@ void DeviceManager::addDevice(Device *device) {
 void DeviceManager::startDiscovery(const DiscoveryOptions &options) {
     m_discoveryOptions = options;
     if (!m_discoveryAgent) {
-        m_discoveryAgent = new QBluetoothDeviceDiscoveryAgent(this);
+        m_discoveryAgent = m_adapterAddress.isNull()
+                               ? new QBluetoothDeviceDiscoveryAgent(this)
+                               : new QBluetoothDeviceDiscoveryAgent(m_adapterAddress, this);
         connect(m_discoveryAgent, &QBluetoothDeviceDiscoveryAgent::deviceDiscovered, this,
                 &DeviceManager::onDeviceDiscovered);
         connect(m_discoveryAgent, &QBluetoothDeviceDiscoveryAgent::deviceUpdated, this,
@@ -109,8 +309,8 @@ void DeviceManager::stopDiscovery() {
 }
 
 void DeviceManager::onDeviceDiscovered(const QBluetoothDeviceInfo &info) {
-    for (auto dev : m_devices) {
-        if (dev->deviceInfo().address() == info.address()) {
+    for (const DeviceState &state : std::as_const(m_registry)) {
+        if (state.device->deviceInfo().address() == info.address()) {
             return;
         }
     }
@@ -149,7 +349,9 @@ void DeviceManager::onDeviceDiscovered(const QBluetoothDeviceInfo &info) {
 }
 
 Device *DeviceManager::createDevice(const QBluetoothDeviceInfo &info, DeviceType type) {
-    return new Device(info, type, this);
+    Device *dev = new Device(info, type, this);
+    dev->setLocalAdapter(m_adapterAddress);
+    return dev;
 }
 
 void DeviceManager::onScanFinished() {
@@ -161,67 +363,669 @@ void DeviceManager::onScanError() {
 }
 
 void DeviceManager::connectToWiFiAndStartStreaming(Device *dev, const StreamingOptions &options) {
-    runFlow(dev, new StreamingStarter(options, this));
+    if (!dev)
+        return;
+    auto *flow = new StreamingStarter(options, this);
+    const DeviceState *state = stateOf(dev);
+    auto previous = m_streamingOptions.constFind(dev);
+    if (state && previous != m_streamingOptions.constEnd()) {
+        // Seed the plan with what is already known for the same settings;
+        // the flow probes the rest.
+        StreamingProgress progress;
+        progress.isPrepared = state->isPrepared;
+        progress.isWiFiConnected = state->isWiFiConnected && sameWiFi(*previous, options);
+        progress.isStreaming = state->isStreaming && sameStream(*previous, options);
+        flow->setProgress(progress);
+    }
+    m_streamingOptions.insert(dev, options);
+    runFlow(dev, flow);
 }
 
 void DeviceManager::runFlow(Device *dev, DeviceFlow *flow) {
     if (!dev || !flow)
         return;
-    if (!m_devices.contains(dev)) {
+    if (!m_handles.contains(dev)) {
         addDevice(dev);
     }
+    startFlow(m_handles.value(dev), flow, false);
+}
 
-    DeviceState &state = m_deviceStates[dev];
-    if (state.activeFlow) {
-        state.activeFlow->deleteLater();
+void DeviceManager::startFlow(DeviceHandle handle, DeviceFlow *flow, bool resume) {
+    DeviceState *state = m_registry.get(handle);
+    Device *dev = state->device;
+    if (state->activeFlow) {
+        state->activeFlow->deleteLater();
+    }
+    state->activeFlow = flow;
+    state->isResuming = resume;
+    state->keepLink = true;
+    if (m_lowPowerDelayMs >= 0) {
+        dev->requestConnectionProfile(ConnectionProfile::LowLatency);
     }
-    state.activeFlow = flow;
 
     connect(flow, &DeviceFlow::log, this, &DeviceManager::log);
-    connect(flow, &DeviceFlow::finished, this, [this, dev](Device *d, bool success) {
-        if (d == dev) {
-            m_deviceStates[dev].activeFlow = nullptr;
-            sender()->deleteLater();
-            emit finished(dev, success);
-        }
-    });
+    connect(flow, &DeviceFlow::finished, this,
+            [this, handle, flow, resume](Device *d, bool success) {
+                DeviceState *state = m_registry.get(handle);
+                if (!state || state->device != d)
+                    return;
+                if (state->activeFlow == flow) {
+                    state->activeFlow = nullptr;
+                }
+                flow->deleteLater();
+                if (!resume) {
+                    state->keepLink = success;
+                }
+                if (m_lowPowerDelayMs >= 0) {
+                    if (success && state->isStreaming) {
+                        scheduleLowPower(handle);
+                    } else {
+                        d->requestConnectionProfile(ConnectionProfile::Balanced);
+                    }
+                }
+                if (!resume) {
+                    emit finished(d, success);
+                } else if (!success) {
+                    onError(d, "Failed to resume after reconnecting");
+                }
+            });
 
     flow->start(dev);
 }
 
+void DeviceManager::scheduleLowPower(DeviceHandle handle) {
+    Timer::singleShot(m_lowPowerDelayMs, this, [this, handle]() {
+        // Only once nothing is being set up and the stream is still up.
+        const DeviceState *state = m_registry.get(handle);
+        if (state && !state->activeFlow && state->isStreaming) {
+            state->device->requestConnectionProfile(ConnectionProfile::LowPower);
+        }
+    });
+}
+
 void DeviceManager::stop() {
     stopDiscovery();
-    for (auto dev : m_devices) {
-        DeviceState &state = m_deviceStates[dev];
+    QList<DeviceFlow *> flows;
+    for (DeviceState &state : m_registry) {
+        state.keepLink = false;
+        state.isReconnecting = false;
+        state.reconnectAttempt = 0;
+        ++state.reconnectToken;
         if (state.activeFlow) {
-            state.activeFlow->stop();
-            state.activeFlow->deleteLater();
+            flows.append(state.activeFlow);
             state.activeFlow = nullptr;
         }
     }
+    // Stopping a flow emits, so the registry must not be walked meanwhile.
+    for (DeviceFlow *flow : std::as_const(flows)) {
+        flow->stop();
+        flow->deleteLater();
+    }
+}
+
+void DeviceManager::stopStreaming(Device *dev) {
+    if (!stateOf(dev))
+        return;
+    // Stopped on purpose: a resume after a reconnect must not start it again.
+    auto options = m_streamingOptions.find(dev);
+    if (options != m_streamingOptions.end()) {
+        options->standby = true;
+    }
+    dev->streamer()->stopLiveStream();
+}
+
+void DeviceManager::disconnectDevice(Device *dev) {
+    if (DeviceState *state = stateOf(dev)) {
+        state->keepLink = false;
+        state->isReconnecting = false;
+        state->reconnectAttempt = 0;
+        ++state->reconnectToken;
+    }
+    if (dev) {
+        dev->disconnectFromDevice();
+    }
+}
+
+bool DeviceManager::switchStreamEndpoint(Device *dev, const QString &rtmpUrl) {
+    const DeviceState *state = stateOf(dev);
+    if (!state || !state->isStreaming) {
+        onError(dev, "Cannot switch the endpoint of a device that is not streaming");
+        return false;
+    }
+    return dev->streamer()->switchStreamEndpoint(rtmpUrl);
+}
+
+AdaptiveBitrateController *DeviceManager::bitrateController(Device *dev) {
+    if (!dev)
+        return nullptr;
+    AdaptiveBitrateController *controller = m_bitrateControllers.value(dev);
+    if (!controller) {
+        controller = new AdaptiveBitrateController(dev, dev);
+        connect(controller, &AdaptiveBitrateController::log, this, &DeviceManager::log);
+        m_bitrateControllers.insert(dev, controller);
+    }
+    return controller;
+}
+
+void DeviceManager::goLive(Device *dev) {
+    auto options = m_streamingOptions.constFind(dev);
+    if (options == m_streamingOptions.constEnd()) {
+        onError(dev, "Cannot go live before the device was set up for streaming");
+        return;
+    }
+    StreamingOptions live = options.value();
+    live.standby = false;
+    // Seeded with the standby progress, the plan is just the start step.
+    connectToWiFiAndStartStreaming(dev, live);
+}
+
+FleetOperation *DeviceManager::startFleet(const QList<Device *> &devices,
+                                          const StreamingOptions &options) {
+    return startFleet(devices, options, FleetOptions());
+}
+
+FleetOperation *DeviceManager::startFleet(const QList<Device *> &devices,
+                                          const StreamingOptions &options,
+                                          const FleetOptions &fleetOptions) {
+    auto *operation = new FleetStarter(this, devices, options, fleetOptions, this);
+    connect(operation, &FleetOperation::finished, this, [this](const FleetResult &result) {
+        emit log(QString("[DJI-BLE] Fleet start: %1 of %2 live, start skew %3 us, ack skew %4 ms")
+                     .arg(result.succeeded())
+                     .arg(result.devices.size())
+                     .arg(result.startSkewUs)
+                     .arg(result.ackSkewMs));
+        for (const FleetDeviceResult &r : result.devices) {
+            const DeviceHandle handle = m_handles.value(r.device);
+            const DeviceState *state = m_registry.get(handle);
+            if (!state || !state->isStreaming)
+                continue;
+            // Resume live, not in standby, after a reconnect.
+            auto options = m_streamingOptions.find(r.device);
+            if (options != m_streamingOptions.end()) {
+                options->standby = false;
+            }
+            if (m_lowPowerDelayMs >= 0 && !state->activeFlow) {
+                scheduleLowPower(handle);
+            }
+        }
+    });
+    operation->start();
+    return operation;
+}
+
+FleetOperation *DeviceManager::stopFleet(const QList<Device *> &devices, int timeoutMs) {
+    auto *operation = new FleetOperation(devices, timeoutMs, this);
+    for (Device *dev : operation->devices()) {
+        if (!isStreaming(dev)) {
+            operation->complete(dev, true);
+            continue;
+        }
+        // A stop has no failure answer; errors of other streamer requests are
+        // not this operation's, so only the timeout fails a device.
+        connect(dev->streamer(), &SubsystemStreamer::stopLiveStreamComplete, operation,
+                [operation, dev]() { operation->complete(dev, true); });
+        stopStreaming(dev);
+    }
+    return operation;
+}
+
+FleetOperation *DeviceManager::reconfigureFleet(const QList<Device *> &devices,
+                                                const StreamSettings &settings, int timeoutMs) {
+    auto *operation = new FleetOperation(devices, timeoutMs, this);
+    for (Device *dev : operation->devices()) {
+        if (!isStreaming(dev)) {
+            operation->complete(dev, false, "Not streaming");
+            continue;
+        }
+        connect(dev->streamer(), &SubsystemStreamer::liveStreamReconfigured, operation,
+                [operation, dev]() { operation->complete(dev, true); });
+        connect(dev->streamer(), &SubsystemStreamer::liveStreamReconfigureFailed, operation,
+                [operation, dev](const QString &msg) { operation->complete(dev, false, msg); });
+        if (!dev->streamer()->reconfigureLiveStream(settings.resolution, settings.bitrateKbps,
+                                                    settings.fps)) {
+            operation->complete(dev, false, "Stream is busy");
+            continue;
+        }
+        // The new settings are the ceiling from now on, also after a reconnect.
+        auto options = m_streamingOptions.find(dev);
+        if (options != m_streamingOptions.end()) {
+            options->resolution = settings.resolution;
+            options->bitrateKbps = settings.bitrateKbps;
+            options->fps = settings.fps;
+        }
+        AdaptiveBitrateController *controller = m_bitrateControllers.value(dev);
+        if (controller && controller->isRunning()) {
+            controller->start(settings);
+        }
+    }
+    return operation;
+}
+
+FleetOperation *DeviceManager::setFleetImageStabilization(const QList<Device *> &devices,
+                                                          ImageStabilization value,
+                                                          int timeoutMs) {
+    auto *operation = new FleetOperation(devices, timeoutMs, this);
+    for (Device *dev : operation->devices()) {
+        // A commit already in flight finishes first; ours is the queued one after it.
+        auto skip = std::make_shared<int>(dev->configurer()->isCommitting() ? 1 : 0);
+        connect(dev->configurer(), &SubsystemConfigurer::committed, operation,
+                [operation, dev, skip](bool success, int, int) {
+                    if (*skip > 0) {
+                        --*skip;
+                        return;
+                    }
+                    operation->complete(dev, success,
+                                        success ? QString()
+                                                : QString("Image stabilization not applied"));
+                });
+        dev->configurer()->setImageStabilization(value);
+    }
+    return operation;
+}
+
+int DeviceManager::batteryPercentage(Device *dev) const {
+    auto battery = m_battery.constFind(dev);
+    return battery == m_battery.constEnd() ? -1 : battery->history.percentage();
+}
+
+qint64 DeviceManager::timeToEmpty(Device *dev) const {
+    auto battery = m_battery.constFind(dev);
+    return battery == m_battery.constEnd() ? -1 : battery->history.timeToEmptyMs();
+}
+
+void DeviceManager::onBatteryPercentage(DeviceHandle handle, int percentage) {
+    const DeviceState *state = m_registry.get(handle);
+    if (!state)
+        return;
+
+    Device *dev = state->device;
+    // Actions and slots may change the policy or the battery map, so work on a copy and
+    // look the device's entry up again after each of them.
+    const QList<BatteryThreshold> thresholds = m_batteryPolicy.thresholds;
+    QList<qsizetype> due;
+    qint64 timeToEmptyMs = -1;
+    {
+        BatteryState &battery = m_battery[dev];
+        battery.history.setWindow(m_batteryPolicy.historyWindowMs);
+        battery.history.addSample(m_clock.elapsed(), percentage);
+        timeToEmptyMs = battery.history.timeToEmptyMs();
+
+        battery.firedAt.resize(std::min(battery.firedAt.size(), thresholds.size()));
+        while (battery.firedAt.size() < thresholds.size()) {
+            battery.firedAt.append(-1);
+        }
+        for (qsizetype i = 0; i < thresholds.size(); ++i) {
+            const BatteryThreshold &threshold = thresholds[i];
+            if (battery.firedAt[i] >= 0) {
+                // Charging re-arms it.
+                if (percentage >= battery.firedAt[i] + batteryRearmMargin &&
+                    (threshold.percentage < 0 || percentage > threshold.percentage)) {
+                    battery.firedAt[i] = -1;
+                }
+                continue;
+            }
+
+            const bool lowCharge =
+                threshold.percentage >= 0 && percentage <= threshold.percentage;
+            const bool lowTime = threshold.minutesToEmpty >= 0 && timeToEmptyMs >= 0 &&
+                                 timeToEmptyMs <= threshold.minutesToEmpty * 60000LL;
+            if (lowCharge || lowTime) {
+                due.append(i);
+            }
+        }
+    }
+
+    for (qsizetype i : std::as_const(due)) {
+        const BatteryThreshold &threshold = thresholds[i];
+        // Stays armed while the stream is busy, so the next reading retries.
+        if (!applyBatteryAction(dev, threshold.action))
+            continue;
+        auto battery = m_battery.find(dev);
+        if (battery == m_battery.end())
+            return;
+        if (i < battery->firedAt.size()) {
+            battery->firedAt[i] = percentage;
+        }
+        emit log(QString("[DJI-BLE] Manager: Battery of %1 at %2%, %3 to empty")
+                     .arg(dev->deviceInfo().address().toString())
+                     .arg(percentage)
+                     .arg(timeToEmptyMs < 0 ? QString("unknown time")
+                                            : QString("%1 min").arg(timeToEmptyMs / 60000)));
+        emit batteryThresholdReached(dev, percentage, timeToEmptyMs, threshold.action);
+    }
+}
+
+bool DeviceManager::applyBatteryAction(Device *dev, BatteryAction action) {
+    const DeviceState *state = stateOf(dev);
+    if (!state || !state->isStreaming || action == BatteryAction::Alert)
+        return true;
+
+    if (action == BatteryAction::StopStreaming) {
+        stopStreaming(dev);
+        return true;
+    }
+
+    SubsystemStreamer *streamer = dev->streamer();
+    StreamSettings lowered{streamer->resolution(), streamer->bitrateKbps(), streamer->fps()};
+    if (action == BatteryAction::LowerBitrate) {
+        lowered.bitrateKbps = std::max<uint16_t>(lowered.bitrateKbps / 2, minBatteryBitrateKbps);
+    } else if (action == BatteryAction::LowerFrameRate) {
+        lowered.fps = std::min(lowered.fps, FPS::FPS25);
+    }
+    if (lowered.bitrateKbps == streamer->bitrateKbps() && lowered.fps == streamer->fps())
+        return true;
+
+    if (!streamer->reconfigureLiveStream(lowered.resolution, lowered.bitrateKbps, lowered.fps))
+        return false;
+    // A running controller must not climb back above the battery-imposed ceiling.
+    AdaptiveBitrateController *controller = m_bitrateControllers.value(dev);
+    if (controller && controller->isRunning()) {
+        controller->start(lowered);
+    }
+    return true;
+}
+
+void DeviceManager::onEndpointSwitched(DeviceHandle handle, const QString &rtmpUrl,
+                                       qint64 downtimeMs) {
+    const DeviceState *state = m_registry.get(handle);
+    if (!state)
+        return;
+
+    Device *dev = state->device;
+    auto options = m_streamingOptions.find(dev);
+    if (options != m_streamingOptions.end() && options->rtmpUrl != rtmpUrl) {
+        // Resume to the live endpoint after a reconnect; keep the old one as the backup.
+        if (options->backupRtmpUrl == rtmpUrl) {
+            options->backupRtmpUrl = options->rtmpUrl;
+        }
+        options->rtmpUrl = rtmpUrl;
+    }
+    emit log(QString("[DJI-BLE] Manager: %1 now streams to %2 (%3 ms downtime)")
+                 .arg(dev->deviceInfo().address().toString(), rtmpUrl)
+                 .arg(downtimeMs));
+    emit streamEndpointSwitched(dev, rtmpUrl, downtimeMs);
+}
+
+void DeviceManager::watchForFailover(DeviceHandle handle) {
+    const DeviceState *state = m_registry.get(handle);
+    if (!state || m_failoverTimer->isActive())
+        return;
+    auto options = m_streamingOptions.constFind(state->device);
+    if (options != m_streamingOptions.constEnd() && !options->backupRtmpUrl.isEmpty()) {
+        m_failoverTimer->start();
+    }
+}
+
+void DeviceManager::checkStreamFailover() {
+    struct Failover {
+        Device *device;
+        QString rtmpUrl;
+        QString backupRtmpUrl;
+    };
+    // Switching emits, so pick the stalled streams before touching any of them.
+    QList<Failover> stalled;
+    bool watching = false;
+    for (const DeviceState &state : std::as_const(m_registry)) {
+        auto options = m_streamingOptions.constFind(state.device);
+        if (!state.isStreaming || options == m_streamingOptions.constEnd() ||
+            options->backupRtmpUrl.isEmpty())
+            continue;
+        watching = true;
+
+        // A silent camera only means a dead stream while the BLE link is fine.
+        Device *dev = state.device;
+        SubsystemStreamer *streamer = dev->streamer();
+        if (state.activeFlow || state.isReconnecting || !dev->isInitialized() ||
+            dev->linkHealth()->isDegraded() || streamer->isSwitchingEndpoint() ||
+            !streamer->isStreamStalled(options->failoverAfterMs))
+            continue;
+        stalled.append({dev, options->rtmpUrl, options->backupRtmpUrl});
+    }
+    if (!watching) {
+        m_failoverTimer->stop();
+    }
+
+    for (const Failover &failover : std::as_const(stalled)) {
+        if (!m_handles.contains(failover.device))
+            continue;
+        emit log(QString("[DJI-BLE] Manager: Stream of %1 to %2 stalled, failing over to %3")
+                     .arg(failover.device->deviceInfo().address().toString(), failover.rtmpUrl,
+                          failover.backupRtmpUrl));
+        failover.device->streamer()->switchStreamEndpoint(failover.backupRtmpUrl);
+    }
+}
+
+void DeviceManager::onDeviceDisconnected(DeviceHandle handle) {
+    DeviceState *state = m_registry.get(handle);
+    if (!state)
+        return;
+
+    // Slots may add or remove devices, so nothing is read from the state after an emit.
+    Device *dev = state->device;
+    const bool keepLink = state->keepLink;
+    DeviceFlow *flow = state->activeFlow;
+    // Pairing lives in the BLE session; WiFi and the stream live on the camera.
+    if (state->isPaired) {
+        state->isPaired = false;
+        emit isPairedChanged(dev);
+    }
+
+    if (m_reconnectPolicy.enabled && keepLink) {
+        scheduleReconnect(handle);
+        return;
+    }
+    if (!flow)
+        return;
+
+    // Nothing brings the link back, so the flow would wait for it forever.
+    onError(dev, "Device disconnected during flow");
+    state = m_registry.get(handle);
+    if (!state || state->activeFlow != flow)
+        return;
+    const bool reportFlow = !state->isResuming;
+    state->activeFlow = nullptr;
+    state->keepLink = false;
+    disconnect(flow, nullptr, this, nullptr);
+    flow->deleteLater();
+    if (reportFlow) {
+        emit finished(dev, false);
+    }
+}
+
+void DeviceManager::onDeviceInitialized(DeviceHandle handle) {
+    DeviceState *state = m_registry.get(handle);
+    if (!state || !state->isReconnecting)
+        return;
+
+    Device *dev = state->device;
+    state->isReconnecting = false;
+    state->reconnectAttempt = 0;
+    ++state->reconnectToken;
+    emit log(QString("[DJI-BLE] Manager: Reconnected to %1")
+                 .arg(dev->deviceInfo().address().toString()));
+    emit reconnected(dev);
+}
+
+void DeviceManager::onLinkDegraded(DeviceHandle handle, int score, const QString &reason) {
+    const DeviceState *state = m_registry.get(handle);
+    if (!state)
+        return;
+
+    Device *dev = state->device;
+    emit log(QString("[DJI-BLE] Manager: Link to %1 degraded (score %2): %3")
+                 .arg(dev->deviceInfo().address().toString())
+                 .arg(score)
+                 .arg(reason));
+    // Skipped connection events make a failing link even slower to notice.
+    if (dev->connectionProfile() == ConnectionProfile::LowPower) {
+        dev->requestConnectionProfile(ConnectionProfile::Balanced);
+    }
+    emit linkDegraded(dev, score, reason);
+}
+
+void DeviceManager::onLinkRecovered(DeviceHandle handle, int score) {
+    const DeviceState *state = m_registry.get(handle);
+    if (!state)
+        return;
+
+    Device *dev = state->device;
+    const bool settled = state->isStreaming && !state->activeFlow;
+    emit log(QString("[DJI-BLE] Manager: Link to %1 recovered (score %2)")
+                 .arg(dev->deviceInfo().address().toString())
+                 .arg(score));
+    if (m_lowPowerDelayMs >= 0 && settled) {
+        scheduleLowPower(handle);
+    }
+    emit linkRecovered(dev, score);
+}
+
+int DeviceManager::reconnectDelay(int attempt) const {
+    qint64 delay = qMax(m_reconnectPolicy.initialDelayMs, 0);
+    for (int i = 1; i < attempt && delay < m_reconnectPolicy.maxDelayMs; ++i) {
+        delay *= 2;
+    }
+    return static_cast<int>(std::min<qint64>(delay, m_reconnectPolicy.maxDelayMs));
+}
+
+void DeviceManager::scheduleReconnect(DeviceHandle handle) {
+    DeviceState *state = m_registry.get(handle);
+    if (!state)
+        return;
+
+    if (state->reconnectAttempt >= m_reconnectPolicy.maxAttempts) {
+        giveUpReconnect(handle);
+        return;
+    }
+
+    Device *dev = state->device;
+    state->isReconnecting = true;
+    const quint32 token = ++state->reconnectToken;
+    const int attempt = ++state->reconnectAttempt;
+    const int delay = reconnectDelay(attempt);
+
+    emit log(QString("[DJI-BLE] Manager: Reconnecting to %1 in %2 ms (attempt %3/%4)")
+                 .arg(dev->deviceInfo().address().toString())
+                 .arg(delay)
+                 .arg(attempt)
+                 .arg(m_reconnectPolicy.maxAttempts));
+    emit reconnecting(dev, attempt, delay);
+
+    Timer::singleShot(delay, this,
+                       [this, handle, token]() { attemptReconnect(handle, token); });
+}
+
+void DeviceManager::attemptReconnect(DeviceHandle handle, quint32 token) {
+    DeviceState *state = m_registry.get(handle);
+    if (!state || state->reconnectToken != token)
+        return;
+
+    Timer::singleShot(m_reconnectPolicy.connectTimeoutMs, this, [this, handle, token]() {
+        const DeviceState *state = m_registry.get(handle);
+        if (state && state->isReconnecting && state->reconnectToken == token) {
+            scheduleReconnect(handle);
+        }
+    });
+
+    Device *dev = state->device;
+    if (state->activeFlow) {
+        // The running flow picks up again once the device is initialized.
+        dev->connectToDevice();
+        return;
+    }
+
+    auto options = m_streamingOptions.constFind(dev);
+    if (options == m_streamingOptions.constEnd() ||
+        !(state->isWiFiConnected || state->isStreaming)) {
+        dev->connectToDevice();
+        return;
+    }
+
+    // Reconcile against what the camera already did: only re-pair and run
+    // the steps that were not completed before the link dropped.
+    StreamingProgress progress;
+    progress.isPrepared = state->isPrepared;
+    progress.isWiFiConnected = state->isWiFiConnected;
+    progress.isStreaming = state->isStreaming;
+
+    auto *flow = new StreamingStarter(options.value(), this);
+    flow->setProgress(progress);
+    startFlow(handle, flow, true);
 }
 
-void DeviceManager::onPairingComplete(Device *dev) {
-    m_deviceStates[dev].isPaired = true;
-    emit isPairedChanged(dev);
+void DeviceManager::giveUpReconnect(DeviceHandle handle) {
+    DeviceState *state = m_registry.get(handle);
+    if (!state)
+        return;
+
+    Device *dev = state->device;
+    const int attempts = state->reconnectAttempt;
+    DeviceFlow *flow = state->activeFlow;
+    const bool reportFlow = flow && !state->isResuming;
+    state->keepLink = false;
+    state->isReconnecting = false;
+    state->reconnectAttempt = 0;
+    state->activeFlow = nullptr;
+    ++state->reconnectToken;
+
+    onError(dev, QString("Giving up reconnecting after %1 attempts").arg(attempts));
+    if (flow) {
+        disconnect(flow, nullptr, this, nullptr);
+        flow->deleteLater();
+    }
+    if (reportFlow) {
+        emit finished(dev, false);
+    }
 }
 
-void DeviceManager::onWifiConnected(Device *dev) {
-    m_deviceStates[dev].isWiFiConnected = true;
-    emit isWiFiConnectedChanged(dev);
+void DeviceManager::onPairingComplete(DeviceHandle handle) {
+    DeviceState *state = m_registry.get(handle);
+    if (!state)
+        return;
+    state->isPaired = true;
+    emit isPairedChanged(state->device);
 }
 
-void DeviceManager::onPrepareComplete(Device *dev) {
-    m_deviceStates[dev].isPrepared = true;
+void DeviceManager::onWifiConnected(DeviceHandle handle) {
+    DeviceState *state = m_registry.get(handle);
+    if (!state)
+        return;
+    state->isWiFiConnected = true;
+    emit isWiFiConnectedChanged(state->device);
 }
 
-void DeviceManager::onStartComplete(Device *dev) {
-    m_deviceStates[dev].isStreaming = true;
+void DeviceManager::onPrepareComplete(DeviceHandle handle) {
+    if (DeviceState *state = m_registry.get(handle)) {
+        state->isPrepared = true;
+    }
+}
+
+void DeviceManager::onStartComplete(DeviceHandle handle) {
+    DeviceState *state = m_registry.get(handle);
+    if (!state)
+        return;
+    Device *dev = state->device;
+    state->isStreaming = true;
+    watchForFailover(handle);
+    auto options = m_streamingOptions.constFind(dev);
+    if (options != m_streamingOptions.constEnd() && options->adaptiveBitrate) {
+        bitrateController(dev)->start({options->resolution, options->bitrateKbps, options->fps});
+    }
     emit isStreamingChanged(dev);
 }
 
-void DeviceManager::onStopComplete(Device *dev) {
-    m_deviceStates[dev].isStreaming = false;
+void DeviceManager::onStopComplete(DeviceHandle handle) {
+    DeviceState *state = m_registry.get(handle);
+    if (!state)
+        return;
+    Device *dev = state->device;
+    const bool hasFlow = state->activeFlow;
+    state->isStreaming = false;
+    if (AdaptiveBitrateController *controller = m_bitrateControllers.value(dev)) {
+        controller->stop();
+    }
+    if (m_lowPowerDelayMs >= 0 && !hasFlow) {
+        dev->requestConnectionProfile(ConnectionProfile::Balanced);
+    }
     emit isStreamingChanged(dev);
 }
 
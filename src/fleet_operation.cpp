@@ -0,0 +1,255 @@
+/**
+ * @file fleet_operation.cpp
+ * @brief Implementation of fleet commands and the synchronized start.
+ */
+
+#include "dji/fleet_operation.h"
+#include "dji/device.h"
+#include "dji/scheduler.h"
+#include "dji/subsystem_streamer.h"
+#include <algorithm>
+
+namespace dji {
+
+FleetOperation::FleetOperation(const QList<Device *> &devices, int timeoutMs, QObject *parent)
+    : QObject(parent), m_timeout(new Timer(this)) {
+    for (Device *dev : devices) {
+        if (!dev || m_devices.contains(dev))
+            continue;
+        m_devices.append(dev);
+        FleetDeviceResult result;
+        result.device = dev;
+        m_result.devices.append(result);
+        m_reported.append(false);
+    }
+    m_timeout->setSingleShot(true);
+    connect(m_timeout, &Timer::timeout, this, [this]() { onTimeout(); });
+    restartTimeout(timeoutMs);
+    if (m_devices.isEmpty()) {
+        finish();
+    }
+}
+
+FleetDeviceResult *FleetOperation::resultFor(Device *dev) {
+    const qsizetype index = m_devices.indexOf(dev);
+    return index < 0 ? nullptr : &m_result.devices[index];
+}
+
+bool FleetOperation::isPending(Device *dev) const {
+    const qsizetype index = m_devices.indexOf(dev);
+    return index >= 0 && !m_reported[index];
+}
+
+QList<Device *> FleetOperation::pendingDevices() const {
+    QList<Device *> pending;
+    for (qsizetype i = 0; i < m_devices.size(); ++i) {
+        if (!m_reported[i]) {
+            pending.append(m_devices[i]);
+        }
+    }
+    return pending;
+}
+
+void FleetOperation::complete(Device *dev, bool success, const QString &error) {
+    const qsizetype index = m_devices.indexOf(dev);
+    if (m_finished || index < 0 || m_reported[index])
+        return;
+    m_reported[index] = true;
+    m_result.devices[index].success = success;
+    m_result.devices[index].error = error;
+    if (!m_reported.contains(false)) {
+        onAllCompleted();
+    }
+}
+
+void FleetOperation::failPending(const QString &error) {
+    for (Device *dev : pendingDevices()) {
+        complete(dev, false, error);
+    }
+}
+
+void FleetOperation::restartTimeout(int timeoutMs) {
+    if (timeoutMs > 0) {
+        m_timeout->start(timeoutMs);
+    } else {
+        m_timeout->stop();
+    }
+}
+
+void FleetOperation::onTimeout() {
+    failPending("Timed out");
+}
+
+void FleetOperation::onAllCompleted() {
+    finish();
+}
+
+void FleetOperation::finish() {
+    if (m_finished)
+        return;
+    m_finished = true;
+    m_timeout->stop();
+    // Deferred, so that a command completing synchronously still reaches
+    // the caller's connections.
+    Timer::singleShot(0, this, [this]() {
+        emit finished(m_result);
+        deleteLater();
+    });
+}
+
+FleetStarter::FleetStarter(DeviceManager *manager, const QList<Device *> &devices,
+                           const StreamingOptions &options, const FleetOptions &fleetOptions,
+                           QObject *parent)
+    : FleetOperation(devices, 0, parent), m_manager(manager), m_options(options),
+      m_fleetOptions(fleetOptions) {
+}
+
+void FleetStarter::start() {
+    if (m_finished || m_phase != Phase::Idle)
+        return;
+
+    // Phase 1: pair, prepare and join WiFi, leaving the encoder off.
+    m_phase = Phase::Staging;
+    restartTimeout(m_fleetOptions.stageTimeoutMs);
+    m_waiting = m_devices;
+    connect(m_manager, &DeviceManager::finished, this, &FleetStarter::onFlowFinished);
+    StreamingOptions standby = m_options;
+    standby.standby = true;
+    for (Device *dev : std::as_const(m_devices)) {
+        m_manager->connectToWiFiAndStartStreaming(dev, standby);
+    }
+}
+
+void FleetStarter::onFlowFinished(Device *dev, bool success) {
+    if (m_phase != Phase::Staging || !m_waiting.removeOne(dev))
+        return;
+    if (!success) {
+        complete(dev, false, "Failed to set up for streaming");
+    }
+    advanceWhenReady();
+}
+
+void FleetStarter::configure() {
+    // Phase 2: send the stream configuration and wait for every ack, so the
+    // start frame is the only round trip left.
+    m_phase = Phase::Configuring;
+    restartTimeout(m_fleetOptions.ackTimeoutMs);
+    for (Device *dev : pendingDevices()) {
+        if (m_manager->isStreaming(dev)) {
+            complete(dev, true);
+            continue;
+        }
+        SubsystemStreamer *streamer = dev->streamer();
+        connect(streamer, &SubsystemStreamer::liveStreamStaged, this, [this, dev]() {
+            if (m_phase == Phase::Configuring && m_waiting.removeOne(dev)) {
+                advanceWhenReady();
+            }
+        });
+        m_waiting.append(dev);
+        if (!streamer->stageLiveStream(m_options.resolution, m_options.bitrateKbps, m_options.fps,
+                                       m_options.rtmpUrl)) {
+            m_waiting.removeOne(dev);
+            complete(dev, false, "Failed to send the stream configuration");
+        }
+    }
+    advanceWhenReady();
+}
+
+void FleetStarter::fire() {
+    // Phase 3: every remaining camera waits for nothing but its start frame;
+    // send them back to back.
+    m_phase = Phase::Starting;
+    restartTimeout(m_fleetOptions.ackTimeoutMs);
+    QList<Device *> staged;
+    for (Device *dev : pendingDevices()) {
+        if (dev->streamer()->isStaged() || dev->streamer()->isStaging()) {
+            staged.append(dev);
+        } else {
+            complete(dev, false, "Stream configuration was not sent");
+        }
+    }
+    if (staged.isEmpty())
+        return;
+
+    for (Device *dev : std::as_const(staged)) {
+        connect(dev->streamer(), &SubsystemStreamer::startLiveStreamComplete, this,
+                [this, dev]() { onStarted(dev); });
+    }
+    m_waiting = staged;
+    m_clock.start();
+    qint64 firstNs = -1;
+    qint64 lastNs = -1;
+    for (Device *dev : std::as_const(staged)) {
+        const qint64 sentNs = m_clock.nsecsElapsed();
+        dev->streamer()->fireLiveStream();
+        if (firstNs < 0) {
+            firstNs = sentNs;
+        }
+        lastNs = sentNs;
+        resultFor(dev)->startOffsetUs = (sentNs - firstNs) / 1000;
+    }
+    m_result.startSkewUs = (lastNs - firstNs) / 1000;
+}
+
+void FleetStarter::onStarted(Device *dev) {
+    if (m_phase != Phase::Starting || !m_waiting.removeOne(dev))
+        return;
+    FleetDeviceResult *result = resultFor(dev);
+    result->ackLatencyMs = m_clock.elapsed() - result->startOffsetUs / 1000;
+
+    // Spread of the acknowledgements across the cameras started so far.
+    qint64 first = -1;
+    qint64 last = -1;
+    for (const FleetDeviceResult &r : std::as_const(m_result.devices)) {
+        if (r.ackLatencyMs < 0)
+            continue;
+        const qint64 ackedAt = r.startOffsetUs / 1000 + r.ackLatencyMs;
+        first = first < 0 ? ackedAt : std::min(first, ackedAt);
+        last = std::max(last, ackedAt);
+    }
+    m_result.ackSkewMs = last - first;
+    complete(dev, true);
+}
+
+void FleetStarter::advanceWhenReady() {
+    if (m_finished || !m_waiting.isEmpty())
+        return;
+    if (m_phase == Phase::Staging) {
+        configure();
+    } else if (m_phase == Phase::Configuring) {
+        fire();
+    }
+}
+
+void FleetStarter::onTimeout() {
+    if (m_phase == Phase::Configuring) {
+        // The configuration acknowledgement is only inferred; start the
+        // cameras that did not send one all the same and let the start
+        // acknowledgement decide.
+        m_waiting.clear();
+        advanceWhenReady();
+        return;
+    }
+    QString error;
+    switch (m_phase) {
+    case Phase::Staging:
+        error = "Timed out setting up for streaming";
+        break;
+    default:
+        error = "Timed out waiting for the stream to start";
+        break;
+    }
+    const QList<Device *> waiting = m_waiting;
+    m_waiting.clear();
+    for (Device *dev : waiting) {
+        complete(dev, false, error);
+    }
+    advanceWhenReady();
+}
+
+void FleetStarter::onAllCompleted() {
+    m_phase = Phase::Done;
+    finish();
+}
+
+} // namespace dji
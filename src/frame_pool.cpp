@@ -0,0 +1,35 @@
+/**
+ * @file frame_pool.cpp
+ * @brief Implementation of the ring of recycled received messages.
+ */
+
+#include "dji/frame_pool.h"
+
+namespace dji {
+
+FramePool::FramePool(int size) : m_slots(qMax(1, size)) {
+}
+
+Message *FramePool::acquire() {
+    // First fit: without readers that keep frames, one buffer does it all.
+    for (Message &slot : m_slots) {
+        if (isFree(slot))
+            return &slot;
+    }
+    ++m_misses;
+    Message &slot = m_slots[m_next];
+    m_next = (m_next + 1) % size();
+    return &slot;
+}
+
+int FramePool::available() const {
+    int free = 0;
+    for (const Message &slot : m_slots) {
+        if (isFree(slot)) {
+            ++free;
+        }
+    }
+    return free;
+}
+
+} // namespace dji
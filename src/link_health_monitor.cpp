@@ -0,0 +1,171 @@
+/**
+ * @file link_health_monitor.cpp
+ * @brief Implementation of the per-device link health score.
+ */
+
+#include "dji/link_health_monitor.h"
+#include "dji/device.h"
+#include "dji/scheduler.h"
+#include <QStringList>
+#include <algorithm>
+
+namespace dji {
+
+// Requests that never get an answer are forgotten after this long.
+static const qint64 pendingRequestTimeoutMs = 10000;
+
+// Linear score: 100 at or better than good, 0 at or worse than bad.
+static int scoreBetween(double value, double good, double bad) {
+    const double t = (value - good) / (bad - good);
+    return static_cast<int>(100.0 * (1.0 - std::clamp(t, 0.0, 1.0)) + 0.5);
+}
+
+LinkHealthMonitor::LinkHealthMonitor(Device *device)
+    : QObject(device), m_device(device), m_evaluationTimer(new Timer(this)),
+      m_rssiTimer(new Timer(this)) {
+    m_clock.start();
+    m_evaluationTimer->setInterval(m_options.evaluationIntervalMs);
+    m_rssiTimer->setInterval(m_options.rssiIntervalMs);
+    connect(m_evaluationTimer, &Timer::timeout, this, &LinkHealthMonitor::evaluate);
+    connect(m_rssiTimer, &Timer::timeout, m_device, &Device::readRssi);
+}
+
+void LinkHealthMonitor::setOptions(const LinkHealthOptions &options) {
+    m_options = options;
+    m_evaluationTimer->setInterval(options.evaluationIntervalMs);
+    m_rssiTimer->setInterval(options.rssiIntervalMs);
+    if (m_running) {
+        if (options.rssiIntervalMs > 0) {
+            m_rssiTimer->start();
+        } else {
+            m_rssiTimer->stop();
+        }
+    }
+}
+
+void LinkHealthMonitor::start() {
+    if (m_running)
+        return;
+    m_running = true;
+    m_lastInboundMs = m_clock.elapsed();
+    m_evaluationTimer->start();
+    if (m_options.rssiIntervalMs > 0) {
+        m_rssiTimer->start();
+        m_device->readRssi();
+    }
+}
+
+void LinkHealthMonitor::stop() {
+    m_running = false;
+    m_evaluationTimer->stop();
+    m_rssiTimer->stop();
+
+    // The next link starts from a clean slate.
+    m_pendingRequests.clear();
+    m_lastHeartbeatMs = -1;
+    m_lastInboundMs = -1;
+    m_heartbeats = 0;
+    m_cadenceMs = -1;
+    m_rttMs = -1;
+    m_rssi = 0;
+    m_score = 100;
+    m_degraded = false;
+}
+
+qint64 LinkHealthMonitor::silenceMs() const {
+    return m_lastInboundMs < 0 ? 0 : m_clock.elapsed() - m_lastInboundMs;
+}
+
+void LinkHealthMonitor::onMessageSent(const Message &msg) {
+    if (!m_running)
+        return;
+    m_pendingRequests.insert(requestKey(msg), m_clock.elapsed());
+}
+
+void LinkHealthMonitor::onMessageReceived(const Message &msg) {
+    if (!m_running)
+        return;
+    const qint64 now = m_clock.elapsed();
+    m_lastInboundMs = now;
+
+    auto pending = m_pendingRequests.find(requestKey(msg));
+    if (pending != m_pendingRequests.end()) {
+        const int sample = static_cast<int>(now - pending.value());
+        m_pendingRequests.erase(pending);
+        // EWMA with 1/4 weight, like TCP's SRTT but a little more responsive.
+        m_rttMs = m_rttMs < 0 ? sample : (3 * m_rttMs + sample) / 4;
+    }
+
+    if (isHeartbeat(msg.msgType)) {
+        if (m_lastHeartbeatMs >= 0) {
+            const int interval = static_cast<int>(now - m_lastHeartbeatMs);
+            m_cadenceMs = m_cadenceMs < 0 ? interval : (7 * m_cadenceMs + interval) / 8;
+        }
+        m_lastHeartbeatMs = now;
+        ++m_heartbeats;
+    }
+}
+
+void LinkHealthMonitor::onRssiRead(int rssi) {
+    m_rssi = rssi;
+}
+
+int LinkHealthMonitor::cadenceScore() const {
+    // Needs at least one interval before silence means anything.
+    if (m_heartbeats < 2)
+        return 100;
+    const double expected = std::max(m_cadenceMs, m_options.minCadenceMs);
+    return scoreBetween(static_cast<double>(silenceMs()) / expected, 2.0, 6.0);
+}
+
+int LinkHealthMonitor::rttScore() const {
+    if (m_rttMs < 0)
+        return 100;
+    return scoreBetween(m_rttMs, 300, 2000);
+}
+
+int LinkHealthMonitor::rssiScore() const {
+    if (m_rssi == 0)
+        return 100;
+    return scoreBetween(-m_rssi, 70, 95);
+}
+
+void LinkHealthMonitor::evaluate() {
+    if (!m_running)
+        return;
+
+    const qint64 now = m_clock.elapsed();
+    for (auto it = m_pendingRequests.begin(); it != m_pendingRequests.end();) {
+        if (now - it.value() > pendingRequestTimeoutMs)
+            it = m_pendingRequests.erase(it);
+        else
+            ++it;
+    }
+
+    const int cadence = cadenceScore();
+    const int rtt = rttScore();
+    const int rssi = rssiScore();
+    const int score = std::min({cadence, rtt, rssi});
+
+    if (score != m_score) {
+        m_score = score;
+        emit scoreChanged(score);
+    }
+
+    if (!m_degraded && score < m_options.degradedScore) {
+        m_degraded = true;
+        QStringList reasons;
+        if (cadence < m_options.degradedScore)
+            reasons.append(QString("silent for %1 ms").arg(silenceMs()));
+        if (rtt < m_options.degradedScore)
+            reasons.append(QString("RTT %1 ms").arg(m_rttMs));
+        if (rssi < m_options.degradedScore)
+            reasons.append(QString("RSSI %1 dBm").arg(m_rssi));
+        emit degraded(score, reasons.join(", "));
+    } else if (m_degraded && score >= m_options.recoveredScore) {
+        m_degraded = false;
+        emit recovered(score);
+    }
+}
+
+} // namespace dji
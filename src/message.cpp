@@ -1,128 +1,101 @@
 #include "dji/message.h"
-#include "dji/crc.h"
+#include "dji/protocol.h"
 #include <QDebug>
 #include <QtEndian>
+#include <cstring>
 
 namespace dji {
 
-QByteArray packString(const QString &s) {
+QByteArray packString(const QString &s, bool *ok) {
     QByteArray b = s.toUtf8();
     if (b.size() > 255) {
-        qWarning() << "String too long for packString:" << s;
+        qWarning() << "String too long for packString:" << b.size() << "bytes";
+        if (ok)
+            *ok = false;
+        return {};
     }
     uint8_t len = static_cast<uint8_t>(b.size());
     QByteArray res;
     res.append(static_cast<char>(len));
     res.append(b);
+    if (ok)
+        *ok = true;
     return res;
 }
 
-QByteArray packURL(const QString &s) {
+QByteArray packURL(const QString &s, bool *ok) {
     QByteArray b = s.toUtf8();
     if (b.size() > 65535) {
-        qWarning() << "String too long for packURL:" << s;
+        qWarning() << "String too long for packURL:" << b.size() << "bytes";
+        if (ok)
+            *ok = false;
+        return {};
     }
     uint16_t len = qToLittleEndian(static_cast<uint16_t>(b.size()));
     QByteArray res;
     res.append(reinterpret_cast<const char *>(&len), 2);
     res.append(b);
+    if (ok)
+        *ok = true;
     return res;
 }
 
-QByteArray Message::serialize() const {
-    if (payload.size() > (255 - 13)) {
-        qCritical() << "Payload too long:" << payload.size();
-    }
-
-    QByteArray buf;
-    buf.append(static_cast<char>(0x55));
-    buf.append(static_cast<char>(13 + payload.size()));
-    buf.append(static_cast<char>(0x04));
-
-    buf.append(static_cast<char>(crc8(buf)));
-
-    uint16_t subBE = qToBigEndian(static_cast<uint16_t>(subsystem));
-    buf.append(reinterpret_cast<const char *>(&subBE), 2);
-
-    uint16_t idBE = qToBigEndian(static_cast<uint16_t>(msgId));
-    buf.append(reinterpret_cast<const char *>(&idBE), 2);
-
-    uint32_t typeBE = qToBigEndian(static_cast<uint32_t>(msgType));
-
-    const char *typePtr = reinterpret_cast<const char *>(&typeBE);
-    buf.append(typePtr + 1, 3);
-
-    buf.append(payload);
-
-    uint16_t fullCrc = crc16(buf);
-
-    uint16_t fullCrcLE = qToLittleEndian(fullCrc);
-    buf.append(reinterpret_cast<const char *>(&fullCrcLE), 2);
-
-    return buf;
+DeviceType identifyDeviceType(const QByteArray &manufacturerData) {
+    return identifyDeviceType(reinterpret_cast<const uint8_t *>(manufacturerData.constData()),
+                              static_cast<size_t>(manufacturerData.size()));
 }
 
-Message Message::parse(const QByteArray &data, bool *ok) {
+QByteArray Message::serialize(bool *ok) const {
     if (ok)
         *ok = false;
-    if (data.size() < 13) {
-        qWarning() << "Message too short:" << data.size();
-        return {};
-    }
-
-    if (static_cast<uint8_t>(data[0]) != 0x55) {
-        qWarning() << "Invalid magic:" << static_cast<uint8_t>(data[0]);
+    if (payload.size() > maxPayloadSize) {
+        qWarning() << "Payload too long:" << payload.size() << "bytes, maximum is"
+                   << maxPayloadSize;
         return {};
     }
 
-    uint8_t length = static_cast<uint8_t>(data[1]);
-    if (length != data.size()) {
+    QByteArray buf(overhead + payload.size(), Qt::Uninitialized);
+    protocol::serializeFrame(subsystem, msgId, msgType,
+                             reinterpret_cast<const uint8_t *>(payload.constData()),
+                             payload.size(), reinterpret_cast<uint8_t *>(buf.data()), buf.size());
+    if (ok)
+        *ok = true;
+    return buf;
+}
 
-        if (static_cast<uint64_t>(length) > static_cast<uint64_t>(data.size())) {
-            qWarning() << "Not enough data for length:" << length;
-            return {};
-        }
-    }
+int Message::frameLength(QByteArrayView data) {
+    return protocol::frameLength(reinterpret_cast<const uint8_t *>(data.data()), data.size());
+}
 
-    uint8_t version = static_cast<uint8_t>(data[2]);
-    if (version != 0x04) {
-        qWarning() << "Invalid version:" << version;
-        return {};
-    }
+Message Message::parse(const QByteArray &data, bool *ok) {
+    Message msg;
+    const bool parsed = parseInto(data, &msg);
+    if (ok)
+        *ok = parsed;
+    return parsed ? msg : Message{};
+}
 
-    uint8_t headerCRC = static_cast<uint8_t>(data[3]);
-    QByteArray header = data.left(3);
-    if (crc8(header) != headerCRC) {
-        qWarning() << "Header CRC mismatch";
-        return {};
+bool Message::parseInto(QByteArrayView data, Message *msg) {
+    protocol::FrameView frame;
+    const protocol::ParseResult result =
+        protocol::parseFrame(reinterpret_cast<const uint8_t *>(data.data()), data.size(), &frame);
+    if (result != protocol::ParseResult::Ok) {
+        qWarning() << "Cannot parse message of" << data.size()
+                   << "bytes:" << protocol::toString(result);
+        return false;
     }
 
-    QByteArray msgWithoutCRC = data.left(length - 2);
-    QByteArray providedCRCBytes = data.mid(length - 2, 2);
-    uint16_t providedCRC =
-        qFromLittleEndian<uint16_t>(reinterpret_cast<const uchar *>(providedCRCBytes.data()));
-
-    if (crc16(msgWithoutCRC) != providedCRC) {
-        qWarning() << "Full CRC mismatch";
-        return {};
+    msg->subsystem = frame.subsystem;
+    msg->msgId = frame.msgId;
+    msg->msgType = frame.msgType;
+    // resize() keeps the capacity of an unshared array, so this only
+    // allocates for a larger payload or when a copy of the last one is alive.
+    const qsizetype payloadSize = static_cast<qsizetype>(frame.payloadSize);
+    msg->payload.resize(payloadSize);
+    if (payloadSize > 0) {
+        memcpy(msg->payload.data(), frame.payload, payloadSize);
     }
-
-    uint16_t subsystem =
-        qFromBigEndian<uint16_t>(reinterpret_cast<const uchar *>(data.mid(4, 2).data()));
-    uint16_t msgId =
-        qFromBigEndian<uint16_t>(reinterpret_cast<const uchar *>(data.mid(6, 2).data()));
-
-    uint32_t msgType = 0;
-
-    msgType = (static_cast<uint8_t>(data[8]) << 16) | (static_cast<uint8_t>(data[9]) << 8) |
-              static_cast<uint8_t>(data[10]);
-
-    QByteArray payload = data.mid(11, length - 13);
-
-    if (ok)
-        *ok = true;
-    return {static_cast<SubsystemID>(subsystem), static_cast<MessageID>(msgId),
-            static_cast<MessageType>(msgType), payload};
+    return true;
 }
 
 } // namespace dji
@@ -0,0 +1,213 @@
+/**
+ * @file protocol.cpp
+ * @brief Implementation of the Qt-free frame codec.
+ */
+
+#include "dji/protocol.h"
+#include <cstring>
+
+namespace dji::protocol {
+
+static const uint8_t CRC8_POLY_REV = 0x8C;
+static const uint8_t CRC8_INIT = 0x77;
+static const uint16_t CRC16_POLY_REV = 0x8408;
+static const uint16_t CRC16_INIT = 0x3692;
+
+uint8_t crc8(const uint8_t *data, size_t size) {
+    uint8_t crc = CRC8_INIT;
+    for (size_t n = 0; n < size; ++n) {
+        crc ^= data[n];
+        for (int i = 0; i < 8; ++i) {
+            if (crc & 1) {
+                crc = (crc >> 1) ^ CRC8_POLY_REV;
+            } else {
+                crc >>= 1;
+            }
+        }
+    }
+    return crc;
+}
+
+uint16_t crc16(const uint8_t *data, size_t size) {
+    uint16_t crc = CRC16_INIT;
+    for (size_t n = 0; n < size; ++n) {
+        crc ^= data[n];
+        for (int i = 0; i < 8; ++i) {
+            if (crc & 1) {
+                crc = (crc >> 1) ^ CRC16_POLY_REV;
+            } else {
+                crc >>= 1;
+            }
+        }
+    }
+    return crc;
+}
+
+const char *toString(ParseResult result) {
+    switch (result) {
+    case ParseResult::Ok:
+        return "ok";
+    case ParseResult::TooShort:
+        return "too short";
+    case ParseResult::BadMagic:
+        return "invalid magic";
+    case ParseResult::Incomplete:
+        return "not enough data for length";
+    case ParseResult::BadLength:
+        return "invalid length";
+    case ParseResult::BadVersion:
+        return "invalid version";
+    case ParseResult::BadHeaderCrc:
+        return "header CRC mismatch";
+    case ParseResult::BadCrc:
+        return "full CRC mismatch";
+    }
+    return "unknown";
+}
+
+const char *messageTypeName(MessageType type) {
+    switch (type) {
+    case MessageType::Configure:
+        return "Configure/StartStopStreaming";
+    case MessageType::MaybeStatus:
+        return "MaybeStatus";
+    case MessageType::MaybeKeepAlive:
+        return "MaybeKeepAlive";
+    case MessageType::PairingStage2:
+        return "PairingStage2";
+    case MessageType::PairingStarted:
+        return "PairingStarted";
+    case MessageType::SetPairingPIN:
+        return "SetPairingPIN";
+    case MessageType::PairingStatus:
+        return "PairingStatus";
+    case MessageType::PairingPINApproved:
+        return "PairingPINApproved";
+    case MessageType::PairingStage1:
+        return "PairingStage1";
+    case MessageType::ConnectToWiFi:
+        return "ConnectToWiFi";
+    case MessageType::ConnectToWiFiResult:
+        return "ConnectToWiFiResult";
+    case MessageType::StartScanningWiFi:
+        return "StartScanningWiFi";
+    case MessageType::StartScanningWiFiResult:
+        return "StartScanningWiFiResult";
+    case MessageType::WiFiScanReport:
+        return "WiFiScanReport";
+    case MessageType::StartStopStreamingResult:
+        return "StartStopStreamingResult";
+    case MessageType::PrepareToLiveStream:
+        return "PrepareToLiveStream";
+    case MessageType::PrepareToLiveStreamResult:
+        return "PrepareToLiveStreamResult";
+    case MessageType::ConfigureStreaming:
+        return "ConfigureStreaming";
+    case MessageType::StreamingStatus:
+        return "StreamingStatus";
+    case MessageType::Unknown0:
+        return "Unknown0";
+    case MessageType::Unknown1:
+        return "Unknown1";
+    case MessageType::Unknown2:
+        return "Unknown2";
+    case MessageType::Unknown3:
+        return "Unknown3";
+    case MessageType::Unknown4:
+        return "Unknown4";
+    case MessageType::Unknown5:
+        return "Unknown5";
+    }
+    return nullptr;
+}
+
+bool isKnownMessageType(MessageType type) {
+    switch (type) {
+    case MessageType::Unknown0:
+    case MessageType::Unknown1:
+    case MessageType::Unknown2:
+    case MessageType::Unknown3:
+    case MessageType::Unknown4:
+    case MessageType::Unknown5:
+        return false;
+    default:
+        return messageTypeName(type) != nullptr;
+    }
+}
+
+static size_t lengthField(const uint8_t *data) {
+    return data[1] | ((data[2] & 0x03) << 8);
+}
+
+int frameLength(const uint8_t *data, size_t size) {
+    if (size < 4 || data[0] != 0x55)
+        return -1;
+    if ((data[2] & 0xFC) != 0x04)
+        return -1;
+    if (crc8(data, 3) != data[3])
+        return -1;
+    const size_t length = lengthField(data);
+    return length >= overhead ? static_cast<int>(length) : -1;
+}
+
+ParseResult parseFrame(const uint8_t *data, size_t size, FrameView *frame) {
+    if (size < overhead)
+        return ParseResult::TooShort;
+    if (data[0] != 0x55)
+        return ParseResult::BadMagic;
+
+    const size_t length = lengthField(data);
+    if (length > size)
+        return ParseResult::Incomplete;
+    if (length < overhead)
+        return ParseResult::BadLength;
+    if ((data[2] >> 2) != 0x01)
+        return ParseResult::BadVersion;
+    if (crc8(data, 3) != data[3])
+        return ParseResult::BadHeaderCrc;
+
+    const uint16_t providedCrc = data[length - 2] | (data[length - 1] << 8);
+    if (crc16(data, length - 2) != providedCrc)
+        return ParseResult::BadCrc;
+
+    frame->subsystem = static_cast<SubsystemID>((data[4] << 8) | data[5]);
+    frame->msgId = static_cast<MessageID>((data[6] << 8) | data[7]);
+    frame->msgType = static_cast<MessageType>((data[8] << 16) | (data[9] << 8) | data[10]);
+    frame->payload = data + headerSize;
+    frame->payloadSize = length - overhead;
+    return ParseResult::Ok;
+}
+
+size_t serializeFrame(SubsystemID subsystem, MessageID msgId, MessageType msgType,
+                      const uint8_t *payload, size_t payloadSize, uint8_t *out, size_t outSize) {
+    const size_t length = frameSize(payloadSize);
+    if (payloadSize > maxPayloadSize || outSize < length)
+        return 0;
+
+    out[0] = 0x55;
+    out[1] = static_cast<uint8_t>(length & 0xFF);
+    out[2] = static_cast<uint8_t>(0x04 | ((length >> 8) & 0x03));
+    out[3] = crc8(out, 3);
+
+    const auto sub = static_cast<uint16_t>(subsystem);
+    out[4] = static_cast<uint8_t>(sub >> 8);
+    out[5] = static_cast<uint8_t>(sub);
+    const auto id = static_cast<uint16_t>(msgId);
+    out[6] = static_cast<uint8_t>(id >> 8);
+    out[7] = static_cast<uint8_t>(id);
+    const auto type = static_cast<uint32_t>(msgType);
+    out[8] = static_cast<uint8_t>(type >> 16);
+    out[9] = static_cast<uint8_t>(type >> 8);
+    out[10] = static_cast<uint8_t>(type);
+
+    if (payloadSize > 0) {
+        std::memcpy(out + headerSize, payload, payloadSize);
+    }
+
+    const uint16_t crc = crc16(out, length - 2);
+    out[length - 2] = static_cast<uint8_t>(crc & 0xFF);
+    out[length - 1] = static_cast<uint8_t>(crc >> 8);
+    return length;
+}
+
+} // namespace dji::protocol
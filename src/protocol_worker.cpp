@@ -0,0 +1,250 @@
+/**
+ * @file protocol_worker.cpp
+ * @brief Implementation of the threaded DeviceManager host.
+ */
+
+#include "dji/protocol_worker.h"
+#include "dji/device.h"
+#include "dji/device_command_queue.h"
+#include "dji/device_flow.h"
+#include <QDebug>
+#include <QThread>
+
+namespace dji {
+
+ProtocolWorker::ProtocolWorker(const QBluetoothAddress &adapterAddress, QObject *parent)
+    : QObject(parent), m_thread(new QThread(this)), m_manager(new DeviceManager()),
+      m_commands(new DeviceCommandQueue(m_manager, m_manager)), m_results(defaultQueueCapacity) {
+    m_thread->setObjectName(adapterAddress.isNull()
+                                ? QString("dji-protocol")
+                                : QString("dji-protocol-%1").arg(adapterAddress.toString()));
+    m_manager->setAdapterAddress(adapterAddress);
+    m_manager->moveToThread(m_thread);
+    attachToManager();
+    m_thread->start();
+}
+
+ProtocolWorker::~ProtocolWorker() {
+    DeviceManager *manager = m_manager;
+    QMetaObject::invokeMethod(
+        manager,
+        [manager]() {
+            manager->stop();
+            delete manager;
+        },
+        Qt::BlockingQueuedConnection);
+    m_thread->quit();
+    m_thread->wait();
+}
+
+void ProtocolWorker::attachToManager() {
+    // These run on the worker thread, right where the manager emits.
+    connect(
+        m_manager, &DeviceManager::log, m_manager,
+        [this](const QString &message) {
+            Event e;
+            e.type = Event::Type::Log;
+            e.text = message;
+            post(std::move(e));
+        },
+        Qt::DirectConnection);
+    connect(
+        m_manager, &DeviceManager::error, m_manager,
+        [this](const QString &message) {
+            Event e;
+            e.type = Event::Type::Error;
+            e.text = message;
+            post(std::move(e));
+        },
+        Qt::DirectConnection);
+    connect(
+        m_manager, &DeviceManager::finished, m_manager,
+        [this](Device *dev, bool success) {
+            Event e;
+            e.type = Event::Type::Finished;
+            e.device = dev;
+            e.flag = success;
+            post(std::move(e));
+        },
+        Qt::DirectConnection);
+    connect(
+        m_manager, &DeviceManager::isPairedChanged, m_manager,
+        [this](Device *dev) {
+            Event e;
+            e.type = Event::Type::Paired;
+            e.device = dev;
+            e.flag = m_manager->isPaired(dev);
+            post(std::move(e));
+        },
+        Qt::DirectConnection);
+    connect(
+        m_manager, &DeviceManager::isWiFiConnectedChanged, m_manager,
+        [this](Device *dev) {
+            Event e;
+            e.type = Event::Type::WiFiConnected;
+            e.device = dev;
+            e.flag = m_manager->isWiFiConnected(dev);
+            post(std::move(e));
+        },
+        Qt::DirectConnection);
+    connect(
+        m_manager, &DeviceManager::isStreamingChanged, m_manager,
+        [this](Device *dev) {
+            Event e;
+            e.type = Event::Type::Streaming;
+            e.device = dev;
+            e.flag = m_manager->isStreaming(dev);
+            post(std::move(e));
+        },
+        Qt::DirectConnection);
+    connect(
+        m_manager, &DeviceManager::devicesChanged, m_manager,
+        [this]() {
+            Event e;
+            e.type = Event::Type::DevicesChanged;
+            e.devices = m_manager->devices();
+            post(std::move(e));
+        },
+        Qt::DirectConnection);
+}
+
+void ProtocolWorker::adopt(QObject *object) {
+    if (object && object->thread() != m_thread) {
+        if (!object->moveToThread(m_thread)) {
+            qWarning() << "[DJI-BLE] Worker: cannot move object to the protocol thread";
+        }
+    }
+}
+
+void ProtocolWorker::startDiscovery(const DiscoveryOptions &options) {
+    DeviceManager *manager = m_manager;
+    QMetaObject::invokeMethod(
+        manager, [manager, options]() { manager->startDiscovery(options); },
+        Qt::QueuedConnection);
+}
+
+void ProtocolWorker::stopDiscovery() {
+    DeviceManager *manager = m_manager;
+    QMetaObject::invokeMethod(
+        manager, [manager]() { manager->stopDiscovery(); }, Qt::QueuedConnection);
+}
+
+void ProtocolWorker::connectToWiFiAndStartStreaming(Device *dev, const StreamingOptions &options) {
+    adopt(dev);
+    DeviceManager *manager = m_manager;
+    QMetaObject::invokeMethod(
+        manager, [manager, dev, options]() { manager->connectToWiFiAndStartStreaming(dev, options); },
+        Qt::QueuedConnection);
+}
+
+void ProtocolWorker::runFlow(Device *dev, DeviceFlow *flow) {
+    adopt(dev);
+    adopt(flow);
+    DeviceManager *manager = m_manager;
+    QMetaObject::invokeMethod(
+        manager, [manager, dev, flow]() { manager->runFlow(dev, flow); }, Qt::QueuedConnection);
+}
+
+void ProtocolWorker::stop() {
+    DeviceManager *manager = m_manager;
+    QMetaObject::invokeMethod(
+        manager, [manager]() { manager->stop(); }, Qt::QueuedConnection);
+}
+
+bool ProtocolWorker::isPaired(Device *dev) const {
+    return m_states.value(dev).isPaired;
+}
+
+bool ProtocolWorker::isWiFiConnected(Device *dev) const {
+    return m_states.value(dev).isWiFiConnected;
+}
+
+bool ProtocolWorker::isStreaming(Device *dev) const {
+    return m_states.value(dev).isStreaming;
+}
+
+void ProtocolWorker::post(Event event) {
+    // Once anything overflowed, keep appending behind it so ordering holds.
+    if (!m_overflow.isEmpty() || !m_results.push(std::move(event))) {
+        m_overflow.append(std::move(event));
+        m_overflowCount.fetch_add(1, std::memory_order_relaxed);
+        m_hasOverflow.store(true, std::memory_order_release);
+        flushOverflow();
+    }
+    scheduleDrain();
+}
+
+void ProtocolWorker::flushOverflow() {
+    while (!m_overflow.isEmpty()) {
+        if (!m_results.push(m_overflow.first()))
+            return;
+        m_overflow.removeFirst();
+    }
+    m_hasOverflow.store(false, std::memory_order_release);
+}
+
+void ProtocolWorker::scheduleDrain() {
+    if (!m_drainScheduled.exchange(true, std::memory_order_acq_rel)) {
+        QMetaObject::invokeMethod(this, [this]() { drain(); }, Qt::QueuedConnection);
+    }
+}
+
+void ProtocolWorker::drain() {
+    m_drainScheduled.store(false, std::memory_order_release);
+
+    Event event;
+    while (m_results.pop(event)) {
+        dispatch(event);
+    }
+
+    if (m_hasOverflow.load(std::memory_order_acquire)) {
+        DeviceManager *manager = m_manager;
+        QMetaObject::invokeMethod(
+            manager,
+            [this]() {
+                flushOverflow();
+                scheduleDrain();
+            },
+            Qt::QueuedConnection);
+    }
+}
+
+void ProtocolWorker::dispatch(const Event &event) {
+    switch (event.type) {
+    case Event::Type::Log:
+        emit log(event.text);
+        break;
+    case Event::Type::Error:
+        emit error(event.text);
+        break;
+    case Event::Type::Finished:
+        emit finished(event.device, event.flag);
+        break;
+    case Event::Type::Paired:
+        m_states[event.device].isPaired = event.flag;
+        emit isPairedChanged(event.device);
+        break;
+    case Event::Type::WiFiConnected:
+        m_states[event.device].isWiFiConnected = event.flag;
+        emit isWiFiConnectedChanged(event.device);
+        break;
+    case Event::Type::Streaming:
+        m_states[event.device].isStreaming = event.flag;
+        emit isStreamingChanged(event.device);
+        break;
+    case Event::Type::DevicesChanged:
+        m_devices = event.devices;
+        for (auto it = m_states.begin(); it != m_states.end();) {
+            if (!m_devices.contains(it.key()))
+                it = m_states.erase(it);
+            else
+                ++it;
+        }
+        emit devicesChanged();
+        break;
+    case Event::Type::None:
+        break;
+    }
+}
+
+} // namespace dji
@@ -0,0 +1,212 @@
+/**
+ * @file scheduler.cpp
+ * @brief Implementation of the system and virtual schedulers and their timers.
+ */
+
+#include "dji/scheduler.h"
+#include <QCoreApplication>
+#include <QEvent>
+#include <QMutexLocker>
+#include <QTimer>
+#include <atomic>
+
+namespace dji {
+
+static std::atomic<Scheduler *> s_instance{nullptr};
+
+Scheduler *Scheduler::system() {
+    static SystemScheduler scheduler;
+    return &scheduler;
+}
+
+Scheduler *Scheduler::instance() {
+    Scheduler *scheduler = s_instance.load(std::memory_order_acquire);
+    return scheduler ? scheduler : system();
+}
+
+void Scheduler::setInstance(Scheduler *scheduler) {
+    s_instance.store(scheduler, std::memory_order_release);
+}
+
+SystemScheduler::SystemScheduler() {
+    m_epoch.start();
+}
+
+Scheduler::TimerId SystemScheduler::schedule(qint64 delayMs, QObject *context,
+                                             std::function<void()> callback) {
+    // Parented to the context, so it dies with it; the context must live on
+    // the scheduling thread, like with QTimer::singleShot().
+    auto *timer = new QTimer(context);
+    timer->setSingleShot(true);
+    TimerId id;
+    {
+        QMutexLocker locker(&m_mutex);
+        id = ++m_nextId;
+        m_timers.insert(id, timer);
+    }
+    // Also covers a timer that dies with its context before it fired.
+    QObject::connect(timer, &QObject::destroyed, [this, id]() {
+        QMutexLocker locker(&m_mutex);
+        m_timers.remove(id);
+    });
+    QObject::connect(timer, &QTimer::timeout, timer,
+                     [this, id, timer, callback = std::move(callback)]() {
+                         {
+                             QMutexLocker locker(&m_mutex);
+                             m_timers.remove(id);
+                         }
+                         timer->deleteLater();
+                         callback();
+                     });
+    timer->start(static_cast<int>(qMax<qint64>(0, delayMs)));
+    return id;
+}
+
+void SystemScheduler::cancel(TimerId id) {
+    QPointer<QTimer> timer;
+    {
+        QMutexLocker locker(&m_mutex);
+        timer = m_timers.take(id);
+    }
+    if (timer) {
+        timer->stop();
+        timer->deleteLater();
+    }
+}
+
+Scheduler::TimerId VirtualScheduler::schedule(qint64 delayMs, QObject *context,
+                                              std::function<void()> callback) {
+    const TimerId id = ++m_nextId;
+    const qint64 dueNs = m_nowNs + qMax<qint64>(0, delayMs) * 1000000;
+    Entry entry;
+    entry.context = context;
+    entry.hasContext = context != nullptr;
+    entry.callback = std::move(callback);
+    m_queue.emplace(std::make_pair(dueNs, id), std::move(entry));
+    m_dueNs.insert(id, dueNs);
+    return id;
+}
+
+void VirtualScheduler::cancel(TimerId id) {
+    auto due = m_dueNs.constFind(id);
+    if (due == m_dueNs.constEnd())
+        return;
+    m_queue.erase(std::make_pair(due.value(), id));
+    m_dueNs.remove(id);
+}
+
+bool VirtualScheduler::runNext(qint64 untilNs) {
+    if (m_queue.empty() || m_queue.begin()->first.first > untilNs)
+        return false;
+
+    auto first = m_queue.begin();
+    m_nowNs = qMax(m_nowNs, first->first.first);
+    m_dueNs.remove(first->first.second);
+    Entry entry = std::move(first->second);
+    m_queue.erase(first);
+
+    if (!entry.hasContext || entry.context) {
+        entry.callback();
+    }
+    deliverPostedEvents();
+    return true;
+}
+
+void VirtualScheduler::deliverPostedEvents() {
+    if (QCoreApplication::instance()) {
+        QCoreApplication::sendPostedEvents();
+        QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+    }
+}
+
+void VirtualScheduler::advance(qint64 ms) {
+    const qint64 untilNs = m_nowNs + qMax<qint64>(0, ms) * 1000000;
+    deliverPostedEvents();
+    while (runNext(untilNs)) {
+    }
+    m_nowNs = untilNs;
+}
+
+bool VirtualScheduler::advanceUntil(const std::function<bool()> &done, qint64 maxMs) {
+    const qint64 untilNs = m_nowNs + qMax<qint64>(0, maxMs) * 1000000;
+    deliverPostedEvents();
+    while (!done()) {
+        if (!runNext(untilNs)) {
+            m_nowNs = untilNs;
+            return done();
+        }
+    }
+    return true;
+}
+
+Timer::Timer(QObject *parent) : QObject(parent), m_scheduler(Scheduler::instance()) {
+    if (m_scheduler == Scheduler::system()) {
+        m_timer = new QTimer(this);
+        connect(m_timer, &QTimer::timeout, this, &Timer::timeout);
+    }
+}
+
+Timer::~Timer() {
+    stop();
+}
+
+void Timer::setInterval(int ms) {
+    m_intervalMs = ms;
+    if (m_timer) {
+        m_timer->setInterval(ms);
+    }
+}
+
+void Timer::setSingleShot(bool singleShot) {
+    m_singleShot = singleShot;
+    if (m_timer) {
+        m_timer->setSingleShot(singleShot);
+    }
+}
+
+void Timer::setTimerType(Qt::TimerType type) {
+    if (m_timer) {
+        m_timer->setTimerType(type);
+    }
+}
+
+bool Timer::isActive() const {
+    return m_timer ? m_timer->isActive() : m_id != 0;
+}
+
+void Timer::start(int ms) {
+    setInterval(ms);
+    start();
+}
+
+void Timer::start() {
+    if (m_timer) {
+        m_timer->start();
+        return;
+    }
+    stop();
+    m_id = m_scheduler->schedule(m_intervalMs, this, [this]() { fire(); });
+}
+
+void Timer::stop() {
+    if (m_timer) {
+        m_timer->stop();
+        return;
+    }
+    if (m_id != 0) {
+        m_scheduler->cancel(m_id);
+        m_id = 0;
+    }
+}
+
+void Timer::fire() {
+    m_id = 0;
+    if (!m_singleShot) {
+        // Like QTimer, a repeating timer with a zero interval still lets
+        // other work run between its timeouts.
+        m_id = m_scheduler->schedule(m_intervalMs, this, [this]() { fire(); });
+    }
+    emit timeout();
+}
+
+} // namespace dji
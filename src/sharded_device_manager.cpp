@@ -0,0 +1,328 @@
+/**
+ * @file sharded_device_manager.cpp
+ * @brief Implementation of the multi-threaded DeviceManager facade.
+ */
+
+#include "dji/sharded_device_manager.h"
+#include "dji/device.h"
+#include "dji/device_flow.h"
+#include "dji/protocol_worker.h"
+#include <QThread>
+#include <QTimer>
+#include <QtAlgorithms>
+
+namespace dji {
+
+ShardedDeviceManager::ShardedDeviceManager(int shardCount, QObject *parent) : QObject(parent) {
+    if (shardCount <= 0)
+        shardCount = qMax(1, QThread::idealThreadCount());
+
+    for (int i = 0; i < shardCount; ++i) {
+        auto *worker = new ProtocolWorker(QBluetoothAddress(), this);
+        worker->workerThread()->setObjectName(QString("dji-shard-%1").arg(i));
+        m_shards.append(worker);
+
+        connect(worker, &ProtocolWorker::log, this, &ShardedDeviceManager::log);
+        connect(worker, &ProtocolWorker::error, this, &ShardedDeviceManager::error);
+        connect(worker, &ProtocolWorker::isPairedChanged, this,
+                &ShardedDeviceManager::isPairedChanged);
+        connect(worker, &ProtocolWorker::isWiFiConnectedChanged, this,
+                &ShardedDeviceManager::isWiFiConnectedChanged);
+        connect(worker, &ProtocolWorker::isStreamingChanged, this,
+                &ShardedDeviceManager::isStreamingChanged);
+        connect(worker, &ProtocolWorker::devicesChanged, this,
+                [this, i]() { onShardDevicesChanged(i); });
+        connect(worker, &ProtocolWorker::finished, this, [this](Device *dev, bool success) {
+            m_busy.remove(dev);
+            m_pinned.remove(dev);
+            emit finished(dev, success);
+            scheduleRebalance();
+        });
+    }
+}
+
+ShardedDeviceManager::~ShardedDeviceManager() {
+    // Stop the shard threads before anything below could still post back to us.
+    qDeleteAll(m_shards);
+    m_shards.clear();
+}
+
+int ShardedDeviceManager::shardLoad(int shard) const {
+    int load = 0;
+    for (auto it = m_owner.begin(); it != m_owner.end(); ++it) {
+        if (it.value() == shard)
+            load++;
+    }
+    return load;
+}
+
+int ShardedDeviceManager::leastLoadedShard() const {
+    int best = 0;
+    int bestLoad = shardLoad(0);
+    for (int i = 1; i < m_shards.size(); ++i) {
+        const int load = shardLoad(i);
+        if (load < bestLoad) {
+            best = i;
+            bestLoad = load;
+        }
+    }
+    return best;
+}
+
+ProtocolWorker *ShardedDeviceManager::shardFor(Device *dev) const {
+    const int shard = shardOf(dev);
+    return shard < 0 ? nullptr : m_shards.at(shard);
+}
+
+void ShardedDeviceManager::addDevice(Device *dev, int shard) {
+    if (!dev || m_owner.contains(dev))
+        return;
+    if (shard < 0 || shard >= m_shards.size())
+        shard = leastLoadedShard();
+
+    ProtocolWorker *worker = m_shards.at(shard);
+    DeviceManager *manager = worker->manager();
+    dev->moveToThread(worker->workerThread());
+    m_owner.insert(dev, shard);
+    m_inTransit.insert(dev);
+
+    QMetaObject::invokeMethod(
+        manager,
+        [manager, dev]() {
+            dev->setParent(manager);
+            manager->addDevice(dev);
+        },
+        Qt::QueuedConnection);
+}
+
+void ShardedDeviceManager::startDiscovery(const DiscoveryOptions &options) {
+    // Discovered devices land on the first shard and are spread by rebalance().
+    m_shards.first()->startDiscovery(options);
+}
+
+void ShardedDeviceManager::stopDiscovery() {
+    m_shards.first()->stopDiscovery();
+}
+
+void ShardedDeviceManager::connectToWiFiAndStartStreaming(Device *dev,
+                                                          const StreamingOptions &options) {
+    if (!dev)
+        return;
+    m_busy.insert(dev);
+    invokeOnOwner(dev, nullptr, [dev, options](DeviceManager *manager) {
+        manager->connectToWiFiAndStartStreaming(dev, options);
+    });
+}
+
+void ShardedDeviceManager::runFlow(Device *dev, DeviceFlow *flow) {
+    if (!dev || !flow)
+        return;
+    m_busy.insert(dev);
+    invokeOnOwner(dev, flow,
+                  [dev, flow](DeviceManager *manager) { manager->runFlow(dev, flow); });
+}
+
+void ShardedDeviceManager::stop() {
+    for (ProtocolWorker *worker : m_shards) {
+        worker->stop();
+    }
+    m_busy.clear();
+}
+
+void ShardedDeviceManager::setLowPowerDelay(int ms) {
+    for (ProtocolWorker *worker : m_shards) {
+        DeviceManager *manager = worker->manager();
+        QMetaObject::invokeMethod(
+            manager, [manager, ms]() { manager->setLowPowerDelay(ms); }, Qt::QueuedConnection);
+    }
+}
+
+bool ShardedDeviceManager::isPaired(Device *dev) const {
+    ProtocolWorker *worker = shardFor(dev);
+    return worker && worker->isPaired(dev);
+}
+
+bool ShardedDeviceManager::isWiFiConnected(Device *dev) const {
+    ProtocolWorker *worker = shardFor(dev);
+    return worker && worker->isWiFiConnected(dev);
+}
+
+bool ShardedDeviceManager::isStreaming(Device *dev) const {
+    ProtocolWorker *worker = shardFor(dev);
+    return worker && worker->isStreaming(dev);
+}
+
+QList<Device *> ShardedDeviceManager::devices() const {
+    return m_owner.keys();
+}
+
+void ShardedDeviceManager::invokeOnOwner(Device *dev, QObject *carried, ManagerCall call) {
+    auto migrating = m_migrating.find(dev);
+    if (migrating != m_migrating.end()) {
+        // Routed once onMigrationDone() knows which shard owns it.
+        migrating->append({carried, std::move(call)});
+        return;
+    }
+
+    if (!m_owner.contains(dev) && dev->thread() == thread()) {
+        addDevice(dev);
+    }
+
+    ProtocolWorker *worker = shardFor(dev);
+    if (!worker) {
+        m_busy.remove(dev);
+        if (carried) {
+            carried->deleteLater();
+        }
+        emit error("[DJI-BLE] Sharded manager: device is not owned by any shard");
+        return;
+    }
+
+    // Queued after anything that hands the device to this shard (addDevice()
+    // or a migration), and the shard runs its queue in order.
+    DeviceManager *manager = worker->manager();
+    if (carried) {
+        carried->moveToThread(worker->workerThread());
+    }
+    QMetaObject::invokeMethod(
+        manager, [manager, call = std::move(call)]() { call(manager); }, Qt::QueuedConnection);
+}
+
+void ShardedDeviceManager::onShardDevicesChanged(int shard) {
+    const QList<Device *> list = m_shards.at(shard)->devices();
+
+    for (Device *dev : list) {
+        if (!m_owner.contains(dev)) {
+            m_owner.insert(dev, shard);
+        } else if (m_owner.value(dev) == shard) {
+            m_inTransit.remove(dev);
+        }
+    }
+
+    for (auto it = m_owner.begin(); it != m_owner.end();) {
+        Device *dev = it.key();
+        if (it.value() == shard && !m_inTransit.contains(dev) && !list.contains(dev)) {
+            m_busy.remove(dev);
+            m_pinned.remove(dev);
+            it = m_owner.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    emit devicesChanged();
+    scheduleRebalance();
+}
+
+void ShardedDeviceManager::scheduleRebalance() {
+    if (!m_autoRebalance || m_rebalanceScheduled)
+        return;
+    m_rebalanceScheduled = true;
+    QTimer::singleShot(0, this, [this]() {
+        m_rebalanceScheduled = false;
+        rebalance();
+    });
+}
+
+void ShardedDeviceManager::rebalance() {
+    if (m_shards.size() < 2 || m_pendingMigrations > 0)
+        return;
+
+    QList<int> load(m_shards.size(), 0);
+    for (auto it = m_owner.begin(); it != m_owner.end(); ++it) {
+        load[it.value()]++;
+    }
+
+    QSet<Device *> planned;
+    QSet<int> exhausted;
+    for (;;) {
+        int busiest = -1;
+        int idlest = 0;
+        for (int i = 0; i < load.size(); ++i) {
+            if (!exhausted.contains(i) && (busiest < 0 || load[i] > load[busiest]))
+                busiest = i;
+            if (load[i] < load[idlest])
+                idlest = i;
+        }
+        if (busiest < 0 || load[busiest] - load[idlest] <= 1)
+            break;
+
+        // Steal one idle device from the busiest shard.
+        Device *candidate = nullptr;
+        for (auto it = m_owner.begin(); it != m_owner.end(); ++it) {
+            Device *dev = it.key();
+            if (it.value() == busiest && !planned.contains(dev) && !m_inTransit.contains(dev) &&
+                !m_busy.contains(dev) && !m_pinned.contains(dev) &&
+                !m_shards.at(busiest)->isStreaming(dev)) {
+                candidate = dev;
+                break;
+            }
+        }
+        if (!candidate) {
+            exhausted.insert(busiest);
+            continue;
+        }
+
+        planned.insert(candidate);
+        load[busiest]--;
+        load[idlest]++;
+        migrate(candidate, busiest, idlest);
+    }
+}
+
+void ShardedDeviceManager::migrate(Device *dev, int from, int to) {
+    m_inTransit.insert(dev);
+    m_migrating.insert(dev, {});
+    m_pendingMigrations++;
+
+    DeviceManager *source = m_shards.at(from)->manager();
+    DeviceManager *target = m_shards.at(to)->manager();
+    QThread *targetThread = m_shards.at(to)->workerThread();
+
+    QMetaObject::invokeMethod(
+        source,
+        [this, source, target, targetThread, dev, from, to]() {
+            DeviceTransfer transfer;
+            const bool moved = dev->thread() == QThread::currentThread() &&
+                               !source->hasActiveFlow(dev) && !dev->isConnected() &&
+                               source->takeDevice(dev, &transfer);
+            if (moved) {
+                // Takes the bitrate controller along, being a child of the device.
+                dev->moveToThread(targetThread);
+                QMetaObject::invokeMethod(
+                    target,
+                    [target, dev, transfer]() {
+                        dev->setParent(target);
+                        target->addDevice(dev, transfer);
+                    },
+                    Qt::QueuedConnection);
+            }
+            QMetaObject::invokeMethod(
+                this, [this, dev, from, to, moved]() { onMigrationDone(dev, from, to, moved); },
+                Qt::QueuedConnection);
+        },
+        Qt::QueuedConnection);
+}
+
+void ShardedDeviceManager::onMigrationDone(Device *dev, int from, int to, bool moved) {
+    m_pendingMigrations--;
+    if (moved) {
+        m_owner.insert(dev, to);
+        if (m_shards.at(to)->devices().contains(dev)) {
+            m_inTransit.remove(dev);
+        }
+        emit deviceMigrated(dev, from, to);
+    } else {
+        m_inTransit.remove(dev);
+        m_pinned.insert(dev);
+    }
+
+    // Queued behind the addDevice() of the target shard, if it moved.
+    const QList<DeferredCall> deferred = m_migrating.take(dev);
+    for (const DeferredCall &call : deferred) {
+        invokeOnOwner(dev, call.carried, call.call);
+    }
+    scheduleRebalance();
+}
+
+} // namespace dji
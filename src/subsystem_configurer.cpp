@@ -1,39 +1,146 @@
 #include "dji/subsystem_configurer.h"
 #include "dji/device.h"
+#include "dji/scheduler.h"
 #include <QDebug>
 
 namespace dji {
 
-SubsystemConfigurer::SubsystemConfigurer(Device *device) : m_device(device) {
+SubsystemConfigurer::SubsystemConfigurer(Device *device)
+    : QObject(device), m_device(device), m_ackTimer(new Timer(this)) {
+    m_ackTimer->setSingleShot(true);
+    connect(m_ackTimer, &Timer::timeout, this, &SubsystemConfigurer::onAckTimeout);
 }
 
 void SubsystemConfigurer::setImageStabilization(ImageStabilization v) {
     emit log("[DJI-BLE] " + QString("Setting image stabilization to %1").arg(static_cast<int>(v)));
-    sendMessageSetImageStabilization(v);
+    stageImageStabilization(v);
+    commit();
 }
 
-void SubsystemConfigurer::handleMessage(const Message &msg) {
-    if (msg.subsystem == SubsystemID::Configurer && msg.msgType == MessageType::Configure) {
-        emit log("[DJI-BLE] " +
-                 QString("Received configurer result: %1").arg(QString(msg.payload.toHex())));
+void SubsystemConfigurer::stage(Setting setting, const QByteArray &value) {
+    m_staged.insert(setting, value);
+}
+
+void SubsystemConfigurer::discard() {
+    m_staged.clear();
+}
+
+void SubsystemConfigurer::commit() {
+    if (isCommitting()) {
+        m_commitQueued = true;
+        return;
     }
+    startCommit();
 }
 
-void SubsystemConfigurer::sendMessageSetImageStabilization(ImageStabilization v) {
+void SubsystemConfigurer::startCommit() {
+    m_written = 0;
+    m_skipped = 0;
+    for (auto it = m_staged.cbegin(); it != m_staged.cend(); ++it) {
+        auto known = m_mirror.constFind(it.key());
+        if (known != m_mirror.cend() && known.value() == it.value()) {
+            ++m_skipped;
+        } else {
+            m_inFlight.append(Write{it.key(), it.value()});
+        }
+    }
+    m_staged.clear();
 
-    QByteArray payload;
-    payload.append(QByteArray::fromHex("0101"));
-    payload.append(static_cast<char>(deviceTypeToStabilizationByte(m_device->deviceType())));
-    payload.append(QByteArray::fromHex("0001"));
-    payload.append(static_cast<char>(v));
+    if (m_inFlight.isEmpty()) {
+        emit log("[DJI-BLE] " +
+                 QString("Configuration unchanged, skipped %1 write(s)").arg(m_skipped));
+        finishCommit(true);
+        return;
+    }
+    sendNext();
+}
+
+void SubsystemConfigurer::sendNext() {
+    const Write &write = m_inFlight.first();
 
     Message msg;
     msg.subsystem = subsystemID();
     msg.msgId = static_cast<MessageID>(0);
     msg.msgType = MessageType::Configure;
-    msg.payload = payload;
+    msg.payload = encode(write.setting, write.value);
 
+    m_ackTimer->start(m_ackTimeoutMs);
     m_device->sendMessage(msg, true);
 }
 
+void SubsystemConfigurer::handleMessage(const Message &msg) {
+    if (msg.subsystem != SubsystemID::Configurer || msg.msgType != MessageType::Configure)
+        return;
+
+    emit log("[DJI-BLE] " +
+             QString("Received configurer result: %1").arg(QString(msg.payload.toHex())));
+    if (m_inFlight.isEmpty())
+        return;
+
+    m_ackTimer->stop();
+    if (msg.payload.isEmpty() || msg.payload[0] != 0x00) {
+        emit error("[DJI-BLE] " +
+                   QString("Configure failed. Payload: %1").arg(QString(msg.payload.toHex())));
+        finishCommit(false);
+        return;
+    }
+
+    const Write write = m_inFlight.takeFirst();
+    m_mirror.insert(write.setting, write.value);
+    ++m_written;
+    emit settingChanged(write.setting);
+    if (write.setting == Setting::ImageStabilization) {
+        emit imageStabilizationSet();
+    }
+
+    if (m_inFlight.isEmpty()) {
+        finishCommit(true);
+    } else {
+        sendNext();
+    }
+}
+
+void SubsystemConfigurer::onAckTimeout() {
+    if (m_inFlight.isEmpty())
+        return;
+    emit error("[DJI-BLE] Configure timed out waiting for an acknowledgement");
+    finishCommit(false);
+}
+
+void SubsystemConfigurer::reset() {
+    if (!m_inFlight.isEmpty()) {
+        m_ackTimer->stop();
+        finishCommit(false);
+    }
+    // Another app may change the settings while we are not connected.
+    invalidateCache();
+}
+
+void SubsystemConfigurer::finishCommit(bool success) {
+    // Writes that never got acknowledged may or may not have been applied.
+    for (const Write &write : std::as_const(m_inFlight)) {
+        m_mirror.remove(write.setting);
+    }
+    m_inFlight.clear();
+    emit committed(success, m_written, m_skipped);
+
+    if (m_commitQueued) {
+        m_commitQueued = false;
+        startCommit();
+    }
+}
+
+QByteArray SubsystemConfigurer::encode(Setting setting, const QByteArray &value) const {
+    QByteArray payload;
+    switch (setting) {
+    case Setting::ImageStabilization:
+        payload.append(QByteArray::fromHex("0101"));
+        payload.append(static_cast<char>(deviceTypeToStabilizationByte(m_device->deviceType())));
+        payload.append(QByteArray::fromHex("0001"));
+        payload.append(value);
+        break;
+    }
+    return payload;
+}
+
 } // namespace dji
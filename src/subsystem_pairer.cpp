@@ -7,7 +7,7 @@ namespace dji {
 
 static const QString defaultPINCode = "5160";
 
-SubsystemPairer::SubsystemPairer(Device *device) : m_device(device) {
+SubsystemPairer::SubsystemPairer(Device *device) : QObject(device), m_device(device) {
 }
 
 void SubsystemPairer::pair() {
@@ -32,9 +32,18 @@ void SubsystemPairer::connectToWiFi(const QString &ssid, const QString &psk) {
 void SubsystemPairer::startScanningWiFi() {
     emit log("[DJI-BLE] "
              "Starting WiFi scan...");
+    if (!m_wifiNetworks.isEmpty()) {
+        m_wifiNetworks.clear();
+        emit wifiNetworksChanged();
+    }
     sendMessageStartScanningWiFi();
 }
 
+void SubsystemPairer::reset() {
+    m_state = State::Idle;
+    m_wifiNetworks.clear();
+}
+
 void SubsystemPairer::handleMessage(const Message &msg) {
     if (msg.msgType == MessageType::PairingStatus) {
 
@@ -59,15 +68,21 @@ void SubsystemPairer::handleMessage(const Message &msg) {
                      "WiFi connected successfully.");
             emit wifiConnected();
         } else {
-            QString err =
-                "[DJI-BLE] " +
+            const QString reason =
                 QString("WiFi connection failed. Payload: %1").arg(QString(msg.payload.toHex()));
-            emit error(err);
+            emit log("[DJI-BLE] " + reason);
+            emit wifiConnectFailed(reason);
         }
     } else if (msg.msgType == MessageType::WiFiScanReport) {
-        emit log("[DJI-BLE] "
-                 "Received WiFi scan report.");
+        bool ok = false;
+        const QList<WiFiNetwork> networks = WiFiScanTable::parseReport(msg.payload, &ok);
+        emit log("[DJI-BLE] " + QString("Received WiFi scan report with %1 network(s)%2.")
+                                    .arg(networks.size())
+                                    .arg(ok ? QString() : QString(" (truncated)")));
         emit wifiScanReport(msg.payload);
+        if (m_wifiNetworks.update(networks)) {
+            emit wifiNetworksChanged();
+        }
     }
 }
 
@@ -125,9 +140,16 @@ void SubsystemPairer::sendMessageStartScanningWiFi() {
 }
 
 void SubsystemPairer::sendMessageConnectToWiFi(const QString &ssid, const QString &psk) {
+    bool ssidOk = false;
+    bool pskOk = false;
     QByteArray payload;
-    payload.append(packString(ssid));
-    payload.append(packString(psk));
+    payload.append(packString(ssid, &ssidOk));
+    payload.append(packString(psk, &pskOk));
+    if (!ssidOk || !pskOk) {
+        emit error("[DJI-BLE] "
+                   "WiFi SSID or passphrase longer than 255 bytes");
+        return;
+    }
 
     Message msg;
     msg.subsystem = subsystemID();
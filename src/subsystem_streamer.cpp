@@ -6,7 +6,10 @@
 
 namespace dji {
 
-SubsystemStreamer::SubsystemStreamer(Device *device) : m_device(device) {
+SubsystemStreamer::SubsystemStreamer(Device *device)
+    : QObject(device), m_device(device), m_operationTimer(new Timer(this)) {
+    m_operationTimer->setSingleShot(true);
+    connect(m_operationTimer, &Timer::timeout, this, &SubsystemStreamer::onOperationTimeout);
 }
 
 void SubsystemStreamer::prepareToLiveStream() {
@@ -24,11 +27,40 @@ void SubsystemStreamer::startLiveStream(Resolution resolution, uint16_t bitrateK
     m_pendingBitrate = bitrateKbps;
     m_pendingFps = fps;
     m_pendingRtmpUrl = rtmpURL;
+    m_hasStreamSettings = true;
 
-    sendMessageConfigureLiveStream(resolution, bitrateKbps, fps, rtmpURL);
+    if (!sendMessageConfigureLiveStream(resolution, bitrateKbps, fps, rtmpURL)) {
+        m_state = State::Idle;
+        return;
+    }
+
+    m_state = State::Starting;
+    sendMessageStartLiveStream();
+}
+
+bool SubsystemStreamer::stageLiveStream(Resolution resolution, uint16_t bitrateKbps, FPS fps,
+                                        const QString &rtmpURL) {
+    emit log("[DJI-BLE] " + QString("Staging live stream to %1").arg(rtmpURL));
+    m_pendingResolution = resolution;
+    m_pendingBitrate = bitrateKbps;
+    m_pendingFps = fps;
+    m_pendingRtmpUrl = rtmpURL;
+    m_hasStreamSettings = true;
+
+    if (!sendMessageConfigureLiveStream(resolution, bitrateKbps, fps, rtmpURL)) {
+        m_state = State::Idle;
+        return false;
+    }
+    m_state = State::Staging;
+    return true;
+}
 
+bool SubsystemStreamer::fireLiveStream() {
+    if (m_state != State::Staged && m_state != State::Staging)
+        return false;
     m_state = State::Starting;
     sendMessageStartLiveStream();
+    return true;
 }
 
 void SubsystemStreamer::stopLiveStream() {
@@ -38,6 +70,61 @@ void SubsystemStreamer::stopLiveStream() {
     sendMessageStopLiveStream();
 }
 
+bool SubsystemStreamer::switchStreamEndpoint(const QString &rtmpURL) {
+    if (!m_hasStreamSettings) {
+        emit error("[DJI-BLE] "
+                   "Cannot switch the stream endpoint before a stream was started");
+        return false;
+    }
+    if (m_state != State::Idle) {
+        emit error("[DJI-BLE] "
+                   "Cannot switch the stream endpoint while another operation is in progress");
+        return false;
+    }
+
+    Message configure;
+    if (!buildMessageConfigureLiveStream(m_pendingResolution, m_pendingBitrate, m_pendingFps,
+                                         rtmpURL, &configure))
+        return false;
+
+    emit log("[DJI-BLE] " + QString("Switching live stream to %1").arg(rtmpURL));
+    m_pendingRtmpUrl = rtmpURL;
+    m_state = State::Switching;
+    m_switchStarted.start();
+    m_operationTimer->start(m_operationTimeoutMs);
+
+    // The camera handles requests in order, so nothing is gained by waiting
+    // for each acknowledgement; only the final one matters.
+    sendMessageStopLiveStream();
+    m_device->sendMessage(configure, true);
+    sendMessageStartLiveStream();
+    return true;
+}
+
+bool SubsystemStreamer::reconfigureLiveStream(Resolution resolution, uint16_t bitrateKbps,
+                                              FPS fps) {
+    // A reconfiguration that was never acknowledged does not block the next one.
+    if (!m_hasStreamSettings || (m_state != State::Idle && m_state != State::Reconfiguring))
+        return false;
+
+    emit log("[DJI-BLE] " + QString("Reconfiguring live stream to %1 kbps").arg(bitrateKbps));
+    if (!sendMessageConfigureLiveStream(resolution, bitrateKbps, fps, m_rtmpUrl))
+        return false;
+    m_pendingResolution = resolution;
+    m_pendingBitrate = bitrateKbps;
+    m_pendingFps = fps;
+    m_state = State::Reconfiguring;
+    m_operationTimer->start(m_operationTimeoutMs);
+    return true;
+}
+
+void SubsystemStreamer::reset() {
+    m_operationTimer->stop();
+    m_state = State::Idle;
+    m_lastStreamingStatus.invalidate();
+    m_streamStarted.invalidate();
+}
+
 void SubsystemStreamer::handleMessage(const Message &msg) {
     if (msg.msgType == MessageType::PrepareToLiveStreamResult) {
         if (m_state == State::PreparingStage1) {
@@ -65,6 +152,8 @@ void SubsystemStreamer::handleMessage(const Message &msg) {
                 emit log("[DJI-BLE] "
                          "StartLiveStream success.");
                 m_state = State::Idle;
+                m_rtmpUrl = m_pendingRtmpUrl;
+                m_streamStarted.start();
                 emit startLiveStreamComplete();
             }
         } else if (m_state == State::Stopping) {
@@ -72,13 +161,73 @@ void SubsystemStreamer::handleMessage(const Message &msg) {
             emit log("[DJI-BLE] "
                      "StopLiveStream success.");
             m_state = State::Idle;
+            m_streamStarted.invalidate();
             emit stopLiveStreamComplete();
+        } else if (m_state == State::Switching) {
+
+            // The stop and configure acknowledgements are passed over.
+            if (msg.msgId == MessageID::StartStreaming) {
+                const qint64 downtimeMs = m_switchStarted.elapsed();
+                emit log("[DJI-BLE] " + QString("Live stream switched to %1 in %2 ms")
+                                            .arg(m_pendingRtmpUrl)
+                                            .arg(downtimeMs));
+                m_operationTimer->stop();
+                m_state = State::Idle;
+                m_rtmpUrl = m_pendingRtmpUrl;
+                m_streamStarted.start();
+                emit endpointSwitched(m_rtmpUrl, downtimeMs);
+            }
+        } else if (m_state == State::Staging) {
+
+            if (msg.msgId == MessageID::ConfigureStreaming) {
+                emit log("[DJI-BLE] "
+                         "Live stream staged.");
+                m_state = State::Staged;
+                emit liveStreamStaged();
+            }
+        } else if (m_state == State::Reconfiguring) {
+
+            if (msg.msgId == MessageID::ConfigureStreaming) {
+                emit log("[DJI-BLE] "
+                         "Live stream reconfigured.");
+                m_operationTimer->stop();
+                m_state = State::Idle;
+                emit liveStreamReconfigured();
+            }
         }
     } else if (msg.msgType == MessageType::StreamingStatus) {
+        m_lastStreamingStatus.start();
+        if (!m_streamStarted.isValid()) {
+            // A stream found running, e.g. after reconnecting, counts from now.
+            m_streamStarted.start();
+        }
         if (msg.payload.size() >= 21) {
             int battery = static_cast<uint8_t>(msg.payload[20]);
+            m_device->notifyListeners([this, battery](DeviceListener *listener) {
+                listener->batteryPercentageChanged(m_device, battery);
+            });
             emit batteryPercentageChanged(battery);
         }
+        m_device->notifyListeners([this, &msg](DeviceListener *listener) {
+            listener->streamingStatusReceived(m_device, msg.payload);
+        });
+        emit streamingStatusReceived(msg.payload);
+    }
+}
+
+void SubsystemStreamer::onOperationTimeout() {
+    if (m_state == State::Switching) {
+        m_state = State::Idle;
+        emit error("[DJI-BLE] " + QString("Switching live stream to %1 timed out after %2 ms")
+                                      .arg(m_pendingRtmpUrl)
+                                      .arg(m_operationTimeoutMs));
+    } else if (m_state == State::Reconfiguring) {
+        m_state = State::Idle;
+        const QString message =
+            "[DJI-BLE] " +
+            QString("Reconfiguring live stream timed out after %1 ms").arg(m_operationTimeoutMs);
+        emit liveStreamReconfigureFailed(message);
+        emit error(message);
     }
 }
 
@@ -102,8 +251,9 @@ void SubsystemStreamer::sendMessagePrepareToLiveStreamStage2() {
     m_device->sendMessage(msg, true);
 }
 
-void SubsystemStreamer::sendMessageConfigureLiveStream(Resolution resolution, uint16_t bitrateKbps,
-                                                       FPS fps, const QString &rtmpURL) {
+bool SubsystemStreamer::buildMessageConfigureLiveStream(Resolution resolution,
+                                                        uint16_t bitrateKbps, FPS fps,
+                                                        const QString &rtmpURL, Message *msg) {
 
     QByteArray payload;
     payload.append('\0');
@@ -117,15 +267,30 @@ void SubsystemStreamer::sendMessageConfigureLiveStream(Resolution resolution, ui
     payload.append(QByteArray::fromHex("0200"));
     payload.append(static_cast<char>(fps));
     payload.append(QByteArray::fromHex("000000"));
-    payload.append(packURL(rtmpURL));
 
-    Message msg;
-    msg.subsystem = subsystemID();
-    msg.msgId = MessageID::ConfigureStreaming;
-    msg.msgType = MessageType::ConfigureStreaming;
-    msg.payload = payload;
+    const QByteArray url = packURL(rtmpURL);
+    if (url.isEmpty() || payload.size() + url.size() > Message::maxPayloadSize) {
+        emit error("[DJI-BLE] " + QString("RTMP URL too long: %1 bytes, at most %2 fit in a frame")
+                                      .arg(rtmpURL.toUtf8().size())
+                                      .arg(Message::maxPayloadSize - payload.size() - 2));
+        return false;
+    }
+    payload.append(url);
+
+    msg->subsystem = subsystemID();
+    msg->msgId = MessageID::ConfigureStreaming;
+    msg->msgType = MessageType::ConfigureStreaming;
+    msg->payload = payload;
+    return true;
+}
 
+bool SubsystemStreamer::sendMessageConfigureLiveStream(Resolution resolution, uint16_t bitrateKbps,
+                                                       FPS fps, const QString &rtmpURL) {
+    Message msg;
+    if (!buildMessageConfigureLiveStream(resolution, bitrateKbps, fps, rtmpURL, &msg))
+        return false;
     m_device->sendMessage(msg, true);
+    return true;
 }
 
 void SubsystemStreamer::sendMessageStartLiveStream() {
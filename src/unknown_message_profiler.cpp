@@ -0,0 +1,172 @@
+/**
+ * @file unknown_message_profiler.cpp
+ * @brief Implementation of the unknown message statistics.
+ */
+
+#include "dji/unknown_message_profiler.h"
+#include <QJsonArray>
+#include <QMutexLocker>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cstring>
+
+namespace dji {
+
+int ByteProfile::distinct() const {
+    int count = 0;
+    for (quint64 word : values) {
+        count += qPopulationCount(word);
+    }
+    return count;
+}
+
+double UnknownMessageProfile::ratePerSecond() const {
+    const qint64 spanMs = lastSeenMs - firstSeenMs;
+    if (frames < 2 || spanMs <= 0)
+        return 0.0;
+    return (frames - 1) * 1000.0 / spanMs;
+}
+
+QString UnknownMessageProfile::variabilityMap() const {
+    QString map;
+    map.reserve(bytes.size());
+    for (const ByteProfile &byte : bytes) {
+        if (byte.isConstant()) {
+            map.append('.');
+        } else if (byte.isCounter()) {
+            map.append('+');
+        } else if (byte.distinct() <= 4) {
+            map.append('e');
+        } else {
+            map.append('x');
+        }
+    }
+    return map;
+}
+
+UnknownMessageProfiler::UnknownMessageProfiler(int maxKeys, int maxTrackedBytes)
+    : m_maxKeys(qMax(1, maxKeys)), m_maxTrackedBytes(qMax(0, maxTrackedBytes)) {
+    m_clock.start();
+}
+
+void UnknownMessageProfiler::record(const Message &msg) {
+    if (protocol::isKnownMessageType(msg.msgType))
+        return;
+
+    QMutexLocker locker(&m_mutex);
+    const qint64 now = m_clock.elapsed();
+    auto it = m_profiles.find(key(msg));
+    if (it == m_profiles.end()) {
+        if (m_profiles.size() >= m_maxKeys) {
+            ++m_droppedFrames;
+            return;
+        }
+        it = m_profiles.insert(key(msg), UnknownMessageProfile());
+        it->subsystem = msg.subsystem;
+        it->msgId = msg.msgId;
+        it->msgType = msg.msgType;
+        it->firstSeenMs = now;
+    } else {
+        const qint64 interval = now - it->lastSeenMs;
+        it->minIntervalMs = it->minIntervalMs < 0 ? interval : qMin(it->minIntervalMs, interval);
+        it->maxIntervalMs = qMax(it->maxIntervalMs, interval);
+    }
+
+    UnknownMessageProfile &profile = *it;
+    const int size = static_cast<int>(msg.payload.size());
+    ++profile.frames;
+    profile.payloadBytes += size;
+    profile.lastSeenMs = now;
+    ++profile.payloadLengths[size];
+    // A copy, not a shared reference, which would keep the frame's slot in
+    // the FramePool of the device busy.
+    profile.lastPayload.resize(size);
+    std::memcpy(profile.lastPayload.data(), msg.payload.constData(), size);
+
+    const int tracked = qMin(size, m_maxTrackedBytes);
+    if (profile.bytes.size() < tracked) {
+        profile.bytes.resize(tracked);
+    }
+    for (int i = 0; i < tracked; ++i) {
+        const auto value = static_cast<quint8>(msg.payload[i]);
+        ByteProfile &byte = profile.bytes[i];
+        if (byte.frames == 0) {
+            byte.first = value;
+        } else if (value != byte.last) {
+            ++byte.changes;
+            if (value == static_cast<quint8>(byte.last + 1)) {
+                ++byte.increments;
+            }
+        }
+        ++byte.frames;
+        byte.last = value;
+        byte.min = qMin(byte.min, value);
+        byte.max = qMax(byte.max, value);
+        byte.values[value >> 6] |= quint64(1) << (value & 0x3F);
+    }
+}
+
+void UnknownMessageProfiler::reset() {
+    QMutexLocker locker(&m_mutex);
+    m_profiles.clear();
+    m_droppedFrames = 0;
+    m_clock.start();
+}
+
+QList<UnknownMessageProfile> UnknownMessageProfiler::profiles() const {
+    QMutexLocker locker(&m_mutex);
+    QList<quint64> keys = m_profiles.keys();
+    std::sort(keys.begin(), keys.end());
+
+    QList<UnknownMessageProfile> sorted;
+    sorted.reserve(keys.size());
+    for (quint64 k : std::as_const(keys)) {
+        sorted.append(m_profiles.value(k));
+    }
+    return sorted;
+}
+
+quint64 UnknownMessageProfiler::droppedFrames() const {
+    QMutexLocker locker(&m_mutex);
+    return m_droppedFrames;
+}
+
+QJsonObject UnknownMessageProfiler::toJson() const {
+    QJsonArray messages;
+    for (const UnknownMessageProfile &profile : profiles()) {
+        QJsonObject lengths;
+        const QMap<int, quint64> &payloadLengths = profile.payloadLengths;
+        for (auto it = payloadLengths.cbegin(); it != payloadLengths.cend(); ++it) {
+            lengths.insert(QString::number(it.key()), double(it.value()));
+        }
+        QJsonArray bytes;
+        for (const ByteProfile &byte : profile.bytes) {
+            bytes.append(QJsonObject{{"frames", double(byte.frames)},
+                                     {"first", byte.first},
+                                     {"min", byte.min},
+                                     {"max", byte.max},
+                                     {"distinct", byte.distinct()},
+                                     {"changes", double(byte.changes)},
+                                     {"increments", double(byte.increments)}});
+        }
+        messages.append(QJsonObject{
+            {"subsystem", static_cast<int>(profile.subsystem)},
+            {"msg_id", static_cast<int>(profile.msgId)},
+            {"msg_type", static_cast<int>(profile.msgType)},
+            {"frames", double(profile.frames)},
+            {"payload_bytes", double(profile.payloadBytes)},
+            {"first_seen_ms", profile.firstSeenMs},
+            {"last_seen_ms", profile.lastSeenMs},
+            {"min_interval_ms", profile.minIntervalMs},
+            {"max_interval_ms", profile.maxIntervalMs},
+            {"rate_per_s", profile.ratePerSecond()},
+            {"payload_lengths", lengths},
+            {"variability", profile.variabilityMap()},
+            {"bytes", bytes},
+            {"last_payload", QString::fromLatin1(profile.lastPayload.toHex())},
+        });
+    }
+    return QJsonObject{{"messages", messages}, {"dropped_frames", double(droppedFrames())}};
+}
+
+} // namespace dji
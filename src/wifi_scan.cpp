@@ -0,0 +1,117 @@
+/**
+ * @file wifi_scan.cpp
+ * @brief Implementation of the WiFi scan report decoder and AP table.
+ */
+
+#include "dji/wifi_scan.h"
+#include <algorithm>
+
+namespace dji {
+
+static WiFiSecurity securityFromByte(uint8_t value) {
+    switch (value) {
+    case 0:
+        return WiFiSecurity::Open;
+    case 1:
+        return WiFiSecurity::WEP;
+    case 2:
+        return WiFiSecurity::WPA;
+    case 3:
+        return WiFiSecurity::WPA2;
+    case 4:
+        return WiFiSecurity::WPA3;
+    default:
+        return WiFiSecurity::Unknown;
+    }
+}
+
+QList<WiFiNetwork> WiFiScanTable::parseReport(const QByteArray &payload, bool *ok) {
+    QList<WiFiNetwork> networks;
+    if (ok)
+        *ok = false;
+    if (payload.isEmpty())
+        return networks;
+
+    const int count = static_cast<uint8_t>(payload[0]);
+    int pos = 1;
+    for (int i = 0; i < count; ++i) {
+        if (pos >= payload.size())
+            return networks;
+        const int ssidLen = static_cast<uint8_t>(payload[pos]);
+        if (pos + 1 + ssidLen + 3 > payload.size())
+            return networks;
+
+        WiFiNetwork network;
+        network.ssid = QString::fromUtf8(payload.mid(pos + 1, ssidLen));
+        pos += 1 + ssidLen;
+        network.rssi = static_cast<int8_t>(payload[pos]);
+        network.channel = static_cast<uint8_t>(payload[pos + 1]);
+        network.security = securityFromByte(static_cast<uint8_t>(payload[pos + 2]));
+        pos += 3;
+
+        // Hidden networks carry no SSID and cannot be joined by name.
+        if (!network.ssid.isEmpty())
+            networks.append(network);
+    }
+    if (ok)
+        *ok = true;
+    return networks;
+}
+
+bool WiFiScanTable::update(const QByteArray &payload) {
+    return update(parseReport(payload));
+}
+
+bool WiFiScanTable::update(const QList<WiFiNetwork> &networks) {
+    bool changed = false;
+    for (const WiFiNetwork &network : networks) {
+        auto it = std::find_if(m_networks.begin(), m_networks.end(),
+                               [&network](const WiFiNetwork &n) { return n.ssid == network.ssid; });
+        if (it == m_networks.end()) {
+            m_networks.append(network);
+            changed = true;
+        } else if (network.rssi > it->rssi) {
+            // Several APs share an SSID; the best one is what a join gets.
+            *it = network;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+void WiFiScanTable::clear() {
+    m_networks.clear();
+}
+
+QList<WiFiNetwork> WiFiScanTable::networks() const {
+    QList<WiFiNetwork> sorted = m_networks;
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const WiFiNetwork &a, const WiFiNetwork &b) { return a.rssi > b.rssi; });
+    return sorted;
+}
+
+const WiFiNetwork *WiFiScanTable::find(const QString &ssid) const {
+    for (const WiFiNetwork &network : m_networks) {
+        if (network.ssid == ssid)
+            return &network;
+    }
+    return nullptr;
+}
+
+QList<WiFiCredentials> WiFiScanTable::rank(const QList<WiFiCredentials> &candidates) const {
+    QList<WiFiCredentials> heard;
+    QList<WiFiCredentials> unheard;
+    for (const WiFiCredentials &candidate : candidates) {
+        if (contains(candidate.ssid))
+            heard.append(candidate);
+        else
+            unheard.append(candidate);
+    }
+    std::stable_sort(heard.begin(), heard.end(),
+                     [this](const WiFiCredentials &a, const WiFiCredentials &b) {
+                         return find(a.ssid)->rssi > find(b.ssid)->rssi;
+                     });
+    return heard + unheard;
+}
+
+} // namespace dji
@@ -0,0 +1,70 @@
+/**
+ * @file alloc_counter.cpp
+ * @brief malloc() interposition behind AllocCounter.
+ */
+
+#include "alloc_counter.h"
+#include <cstddef>
+
+#if defined(__GLIBC__)
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+}
+
+namespace {
+
+// Plain thread-locals: no locking, and nothing here may allocate.
+thread_local quint64 t_allocations = 0;
+thread_local quint64 t_bytes = 0;
+
+inline void count(size_t size) {
+    ++t_allocations;
+    t_bytes += size;
+}
+
+} // namespace
+
+extern "C" {
+
+void *malloc(size_t size) {
+    count(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count_, size_t size) {
+    count(count_ * size);
+    return __libc_calloc(count_, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    // A grow may or may not move the block; either way it is a trip to the allocator.
+    if (size > 0) {
+        count(size);
+    }
+    return __libc_realloc(ptr, size);
+}
+
+} // extern "C"
+
+bool AllocCounter::isSupported() {
+    return true;
+}
+
+AllocStats AllocCounter::current() {
+    return AllocStats{t_allocations, t_bytes};
+}
+
+#else
+
+bool AllocCounter::isSupported() {
+    return false;
+}
+
+AllocStats AllocCounter::current() {
+    return AllocStats();
+}
+
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QtGlobal>
+
+/**
+ * @brief Heap allocations made by the calling thread.
+ *
+ * Counted by interposing malloc(), calloc() and realloc(), which also covers
+ * operator new and Qt's containers. Only available with glibc; elsewhere
+ * isSupported() is false and the counters stay at 0.
+ */
+struct AllocStats {
+    quint64 allocations = 0;
+    quint64 bytes = 0;
+};
+
+namespace AllocCounter {
+
+bool isSupported();
+// Totals for the calling thread since it started.
+AllocStats current();
+
+} // namespace AllocCounter
+
+// Allocations made by the calling thread since construction.
+class AllocScope {
+public:
+    AllocScope() : m_start(AllocCounter::current()) {
+    }
+
+    AllocStats elapsed() const {
+        const AllocStats now = AllocCounter::current();
+        return AllocStats{now.allocations - m_start.allocations, now.bytes - m_start.bytes};
+    }
+
+private:
+    AllocStats m_start;
+};
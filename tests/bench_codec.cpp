@@ -0,0 +1,274 @@
+/**
+ * @file bench_codec.cpp
+ * @brief Micro-benchmarks for the codec and receive hot paths.
+ *
+ * Reports ns/op, allocations/op and bytes/op per benchmark, as a table and
+ * optionally as JSON for tracking regressions across commits:
+ *
+ *   dji_bench --json bench.json --filter crc
+ */
+
+#include "alloc_counter.h"
+#include "dji/crc.h"
+#include "dji/device.h"
+#include "dji/message.h"
+#include "dji/protocol.h"
+#include "dji/subsystem_streamer.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <cstdio>
+#include <functional>
+
+using namespace dji;
+
+namespace {
+
+struct BenchResult {
+    QString name;
+    qint64 iterations = 0;
+    double nsPerOp = 0;
+    double allocsPerOp = 0;
+    double bytesPerOp = 0;
+};
+
+// Consumes results so the compiler cannot drop the work producing them.
+volatile quint64 g_sink = 0;
+
+void keep(quint64 value) {
+    g_sink = g_sink + value;
+}
+
+// Exposes the notification entry point that the BLE stack normally drives.
+class BenchDevice : public Device {
+public:
+    BenchDevice() : Device(QBluetoothDeviceInfo(), DeviceType::OsmoPocket3) {
+    }
+    void feed(const QByteArray &notification) {
+        receiveNotification(notification);
+    }
+};
+
+Message streamingStatus() {
+    Message msg;
+    msg.subsystem = SubsystemID::Status;
+    msg.msgType = MessageType::StreamingStatus;
+    msg.payload = QByteArray(21, 0);
+    msg.payload[20] = 80;
+    return msg;
+}
+
+Message messageWithPayload(int size) {
+    Message msg;
+    msg.subsystem = SubsystemID::Streamer;
+    msg.msgId = MessageID::ConfigureStreaming;
+    msg.msgType = MessageType::ConfigureStreaming;
+    msg.payload = QByteArray(size, 'x');
+    return msg;
+}
+
+class Runner {
+public:
+    Runner(qint64 minTimeNs, const QString &filter, FILE *table)
+        : m_minTimeNs(minTimeNs), m_filter(filter), m_table(table) {
+        std::fprintf(m_table, "%-40s %12s %12s %10s %10s\n", "benchmark", "iterations", "ns/op",
+                     "allocs/op", "bytes/op");
+    }
+
+    void run(const QString &name, const std::function<void()> &op) {
+        if (!m_filter.isEmpty() && !name.contains(m_filter))
+            return;
+
+        // Warm up caches and lazily created state, then size the measured
+        // run from a calibration pass.
+        for (int i = 0; i < 16; ++i) {
+            op();
+        }
+        qint64 iterations = 1;
+        qint64 elapsedNs = 0;
+        while (true) {
+            elapsedNs = measure(op, iterations, nullptr);
+            if (elapsedNs >= m_minTimeNs / 10 || iterations >= (qint64(1) << 30))
+                break;
+            iterations *= 2;
+        }
+        if (elapsedNs > 0) {
+            iterations = qMax<qint64>(1, iterations * m_minTimeNs / elapsedNs);
+        }
+
+        AllocStats allocs;
+        elapsedNs = measure(op, iterations, &allocs);
+
+        BenchResult result;
+        result.name = name;
+        result.iterations = iterations;
+        result.nsPerOp = double(elapsedNs) / iterations;
+        result.allocsPerOp = double(allocs.allocations) / iterations;
+        result.bytesPerOp = double(allocs.bytes) / iterations;
+        m_results.append(result);
+
+        std::fprintf(m_table, "%-40s %12lld %12.1f %10.2f %10.1f\n", qPrintable(name),
+                     static_cast<long long>(iterations), result.nsPerOp, result.allocsPerOp,
+                     result.bytesPerOp);
+        std::fflush(m_table);
+    }
+
+    QList<BenchResult> results() const {
+        return m_results;
+    }
+
+private:
+    static qint64 measure(const std::function<void()> &op, qint64 iterations, AllocStats *allocs) {
+        QElapsedTimer timer;
+        const AllocScope scope;
+        timer.start();
+        for (qint64 i = 0; i < iterations; ++i) {
+            op();
+        }
+        const qint64 elapsedNs = timer.nsecsElapsed();
+        if (allocs) {
+            *allocs = scope.elapsed();
+        }
+        return elapsedNs;
+    }
+
+    qint64 m_minTimeNs;
+    QString m_filter;
+    FILE *m_table;
+    QList<BenchResult> m_results;
+};
+
+QJsonDocument toJson(const QList<BenchResult> &results) {
+    QJsonArray benchmarks;
+    for (const BenchResult &r : results) {
+        QJsonObject entry;
+        entry["name"] = r.name;
+        entry["iterations"] = r.iterations;
+        entry["ns_per_op"] = r.nsPerOp;
+        entry["allocs_per_op"] = r.allocsPerOp;
+        entry["bytes_per_op"] = r.bytesPerOp;
+        benchmarks.append(entry);
+    }
+    QJsonObject context;
+    context["date"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    context["qt_version"] = QString(qVersion());
+    context["alloc_counting"] = AllocCounter::isSupported();
+
+    QJsonObject root;
+    root["context"] = context;
+    root["benchmarks"] = benchmarks;
+    return QJsonDocument(root);
+}
+
+void registerBenchmarks(Runner &runner) {
+    for (int size : {16, 64, 256, 1024}) {
+        const QByteArray data(size, '\x5a');
+        runner.run(QString("crc8/%1").arg(size), [data]() { keep(crc8(data)); });
+        runner.run(QString("crc16/%1").arg(size), [data]() { keep(crc16(data)); });
+    }
+
+    for (int size : {0, 64, 512}) {
+        const Message msg = messageWithPayload(size);
+        const QByteArray frame = msg.serialize();
+        runner.run(QString("message/serialize/%1").arg(size),
+                   [msg]() { keep(msg.serialize().size()); });
+        runner.run(QString("message/parse/%1").arg(size), [frame]() {
+            bool ok = false;
+            keep(Message::parse(frame, &ok).payload.size());
+        });
+
+        // The same frames through the Qt-free codec.
+        const auto *bytes = reinterpret_cast<const uint8_t *>(frame.constData());
+        const size_t length = static_cast<size_t>(frame.size());
+        runner.run(QString("protocol/serialize/%1").arg(size), [msg, length]() {
+            static uint8_t out[protocol::maxFrameSize];
+            keep(protocol::serializeFrame(
+                msg.subsystem, msg.msgId, msg.msgType,
+                reinterpret_cast<const uint8_t *>(msg.payload.constData()), msg.payload.size(),
+                out, length));
+        });
+        runner.run(QString("protocol/parse/%1").arg(size), [bytes, length]() {
+            protocol::FrameView view;
+            keep(static_cast<int>(protocol::parseFrame(bytes, length, &view)) + view.payloadSize);
+        });
+    }
+
+    const QString ssid = "studio-5g";
+    const QString url = "rtmp://live.example.com/app/0123456789abcdef0123456789abcdef";
+    runner.run("pack/string", [ssid]() { keep(packString(ssid).size()); });
+    runner.run("pack/url", [url]() { keep(packURL(url).size()); });
+
+    // One subsystem, then all receivers of Device::messageReceived.
+    BenchDevice dispatchDevice;
+    const Message status = streamingStatus();
+    runner.run("dispatch/streamer", [&dispatchDevice, status]() {
+        dispatchDevice.streamer()->handleMessage(status);
+    });
+    runner.run("dispatch/device",
+               [&dispatchDevice, status]() { emit dispatchDevice.messageReceived(status); });
+
+    // Bytes in, parsed and dispatched: one frame per notification, and one
+    // frame split over default-MTU notifications.
+    BenchDevice receiveDevice;
+    const QByteArray statusFrame = status.serialize();
+    runner.run("receive/streaming_status",
+               [&receiveDevice, statusFrame]() { receiveDevice.feed(statusFrame); });
+    const QList<QByteArray> chunks = Device::splitForMtu(statusFrame, Device::defaultMtu);
+    runner.run("receive/streaming_status_split", [&receiveDevice, chunks]() {
+        for (const QByteArray &chunk : chunks) {
+            receiveDevice.feed(chunk);
+        }
+    });
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("dji_bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Micro-benchmarks for the libdji codec hot paths");
+    parser.addHelpOption();
+    QCommandLineOption jsonOpt("json", "Write results as JSON to <file> ('-' for stdout).",
+                               "file");
+    QCommandLineOption filterOpt("filter", "Only run benchmarks whose name contains <text>.",
+                                 "text");
+    QCommandLineOption minTimeOpt("min-time-ms", "Measured time per benchmark (default 200).",
+                                  "ms", "200");
+    parser.addOption(jsonOpt);
+    parser.addOption(filterOpt);
+    parser.addOption(minTimeOpt);
+    parser.process(app);
+
+    const qint64 minTimeNs = qMax(1, parser.value(minTimeOpt).toInt()) * qint64(1000000);
+    const QString jsonPath = parser.value(jsonOpt);
+    if (!AllocCounter::isSupported()) {
+        std::fprintf(stderr, "Allocation counting is not supported on this platform.\n");
+    }
+
+    // The table goes to stderr when the JSON takes stdout.
+    Runner runner(minTimeNs, parser.value(filterOpt), jsonPath == "-" ? stderr : stdout);
+    registerBenchmarks(runner);
+
+    if (!jsonPath.isEmpty()) {
+        const QByteArray json = toJson(runner.results()).toJson();
+        if (jsonPath == "-") {
+            std::fwrite(json.constData(), 1, static_cast<size_t>(json.size()), stdout);
+        } else {
+            QFile file(jsonPath);
+            if (!file.open(QIODevice::WriteOnly)) {
+                std::fprintf(stderr, "Cannot write %s\n", qPrintable(jsonPath));
+                return 1;
+            }
+            file.write(json);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,435 @@
+/**
+ * @file loadtest.cpp
+ * @brief Fleet-scale load test on simulated cameras.
+ *
+ * Drives N MockDevice cameras through DeviceManager and StreamingStarter with
+ * the given link latency and loss, then keeps them streaming for a while.
+ * Reports time-to-stream percentiles, event loop utilization and lag, peak
+ * RSS and CPU time per device:
+ *
+ *   dji_loadtest --devices 500 --latency-ms 30 --jitter-ms 20 --loss 0.01
+ *
+ * With --shards, the cameras are spread over a ShardedDeviceManager instead,
+ * once per listed shard count, to see how the fleet scales with threads:
+ *
+ *   dji_loadtest --devices 1000 --shards 1,2,4,8
+ *
+ * The loop metrics then cover the facade thread only; the shards show up in
+ * the process CPU time. Peak RSS is that of the whole sweep so far.
+ *
+ * With --capture, every frame is also recorded for dji_capture_analyze.
+ */
+
+#include "mock_device.h"
+#include "dji/capture_recorder.h"
+#include "dji/device_manager.h"
+#include "dji/sharded_device_manager.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QLoggingCategory>
+#include <QTimer>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <memory>
+
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+using namespace dji;
+
+namespace {
+
+struct LoadOptions {
+    int devices = 100;
+    int latencyMs = 10;
+    int jitterMs = 0;
+    double loss = 0.0;
+    quint32 seed = 1;
+    // Delay between starting consecutive cameras; 0 starts all at once.
+    int rampMs = 0;
+    int timeoutMs = 60000;
+    // Steady-state streaming measured after the last camera went live.
+    int holdMs = 5000;
+    // 0 runs everything on one DeviceManager on the main thread.
+    int shards = 0;
+    // Records every frame to this file if set.
+    QString capturePath;
+};
+
+struct CpuTimes {
+    qint64 processUs = 0;
+    qint64 threadUs = 0;
+};
+
+qint64 toUs(const timeval &tv) {
+    return qint64(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+CpuTimes cpuNow() {
+    CpuTimes times;
+#if defined(Q_OS_UNIX)
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        times.processUs = toUs(usage.ru_utime) + toUs(usage.ru_stime);
+    }
+#if defined(RUSAGE_THREAD)
+    if (getrusage(RUSAGE_THREAD, &usage) == 0) {
+        times.threadUs = toUs(usage.ru_utime) + toUs(usage.ru_stime);
+    }
+#else
+    times.threadUs = times.processUs;
+#endif
+#endif
+    return times;
+}
+
+// -1 where unsupported.
+qint64 peakRssKb() {
+#if defined(Q_OS_MACOS)
+    rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss / 1024 : -1;
+#elif defined(Q_OS_UNIX)
+    rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : -1;
+#else
+    return -1;
+#endif
+}
+
+double percentile(QList<qint64> values, double p) {
+    if (values.isEmpty())
+        return -1;
+    std::sort(values.begin(), values.end());
+    const qsizetype index =
+        qBound<qsizetype>(0, qsizetype(std::ceil(p * values.size())) - 1, values.size() - 1);
+    return double(values[index]);
+}
+
+class LoadTest : public QObject {
+    Q_OBJECT
+public:
+    explicit LoadTest(const LoadOptions &options, QObject *parent = nullptr)
+        : QObject(parent), m_options(options), m_probe(new QTimer(this)),
+          m_deadline(new QTimer(this)) {
+        // Connection profile changes only add noise to the measurement.
+        if (m_options.shards > 0) {
+            m_sharded = new ShardedDeviceManager(m_options.shards, this);
+            m_sharded->setAutoRebalance(false);
+            m_sharded->setLowPowerDelay(-1);
+            connect(m_sharded, &ShardedDeviceManager::finished, this, &LoadTest::onFinished);
+        } else {
+            m_manager = new DeviceManager(nullptr, this);
+            m_manager->setLowPowerDelay(-1);
+            connect(m_manager, &DeviceManager::finished, this, &LoadTest::onFinished);
+        }
+
+        // The probe fires every probeIntervalMs; anything later is time the
+        // event loop spent on other work.
+        m_probe->setTimerType(Qt::PreciseTimer);
+        m_probe->setInterval(probeIntervalMs);
+        connect(m_probe, &QTimer::timeout, this, &LoadTest::onProbe);
+
+        m_deadline->setSingleShot(true);
+        connect(m_deadline, &QTimer::timeout, this, &LoadTest::startHold);
+    }
+
+    bool start() {
+        if (!m_options.capturePath.isEmpty()) {
+            m_captureFile.setFileName(m_options.capturePath);
+            if (!m_captureFile.open(QIODevice::WriteOnly))
+                return false;
+            m_recorder = std::make_unique<CaptureRecorder>(&m_captureFile);
+        }
+        for (int i = 0; i < m_options.devices; ++i) {
+            // The sharded manager takes parentless devices only.
+            auto *device = new MockDevice(m_sharded ? nullptr : this);
+            device->setLinkLatency(m_options.latencyMs, m_options.jitterMs);
+            device->setLossRate(m_options.loss, m_options.seed + quint32(i));
+            if (m_recorder) {
+                m_recorder->attach(device);
+            }
+            if (m_sharded) {
+                m_sharded->addDevice(device);
+            } else {
+                m_manager->addDevice(device);
+            }
+            m_devices.append(device);
+        }
+
+        StreamingOptions streaming;
+        streaming.ssid = "loadtest";
+        streaming.psk = "loadtest-psk";
+        streaming.rtmpUrl = "rtmp://127.0.0.1/live/loadtest";
+
+        m_wall.start();
+        m_cpuStart = cpuNow();
+        m_probeClock.start();
+        m_probe->start();
+        m_deadline->start(m_options.timeoutMs);
+        for (int i = 0; i < m_devices.size(); ++i) {
+            MockDevice *device = m_devices[i];
+            QTimer::singleShot(i * m_options.rampMs, this, [this, device, streaming]() {
+                m_startedAt.insert(device, m_wall.elapsed());
+                if (m_sharded) {
+                    m_sharded->connectToWiFiAndStartStreaming(device, streaming);
+                } else {
+                    m_manager->connectToWiFiAndStartStreaming(device, streaming);
+                }
+            });
+        }
+        return true;
+    }
+
+signals:
+    void done(const QJsonObject &report);
+
+private:
+    static constexpr int probeIntervalMs = 10;
+
+    void onFinished(Device *device, bool success) {
+        if (m_holding || !m_startedAt.contains(device) || m_outcome.contains(device))
+            return;
+        m_outcome.insert(device, success);
+        if (success) {
+            m_timeToStreamMs.append(m_wall.elapsed() - m_startedAt.value(device));
+        }
+        if (m_outcome.size() == m_devices.size()) {
+            startHold();
+        }
+    }
+
+    void onProbe() {
+        const qint64 now = m_probeClock.nsecsElapsed();
+        const qint64 lagUs = (now - m_lastProbeNs) / 1000 - probeIntervalMs * 1000;
+        m_lastProbeNs = now;
+        (m_holding ? m_holdLagUs : m_rampLagUs).append(qMax<qint64>(0, lagUs));
+    }
+
+    void startHold() {
+        if (m_holding)
+            return;
+        m_holding = true;
+        m_deadline->stop();
+        m_rampWallMs = m_wall.elapsed();
+        m_cpuRamp = cpuNow();
+        m_holdWall.start();
+        QTimer::singleShot(m_options.holdMs, this, &LoadTest::finish);
+    }
+
+    void finish() {
+        m_probe->stop();
+        const CpuTimes end = cpuNow();
+        const qint64 holdWallMs = qMax<qint64>(1, m_holdWall.elapsed());
+        const int devices = m_devices.size();
+
+        int live = 0;
+        for (MockDevice *device : std::as_const(m_devices)) {
+            const bool streaming =
+                m_sharded ? m_sharded->isStreaming(device) : m_manager->isStreaming(device);
+            live += streaming ? 1 : 0;
+        }
+        int failed = 0;
+        for (bool success : std::as_const(m_outcome)) {
+            failed += success ? 0 : 1;
+        }
+
+        QJsonObject report;
+        report["devices"] = devices;
+        report["shards"] = m_options.shards;
+        report["latency_ms"] = m_options.latencyMs;
+        report["jitter_ms"] = m_options.jitterMs;
+        report["loss"] = m_options.loss;
+        report["succeeded"] = int(m_timeToStreamMs.size());
+        report["failed"] = failed;
+        report["timed_out"] = devices - int(m_outcome.size());
+        report["live_at_end"] = live;
+        report["ramp_ms"] = m_rampWallMs;
+        report["tts_p50_ms"] = percentile(m_timeToStreamMs, 0.50);
+        report["tts_p90_ms"] = percentile(m_timeToStreamMs, 0.90);
+        report["tts_p99_ms"] = percentile(m_timeToStreamMs, 0.99);
+        report["tts_max_ms"] = percentile(m_timeToStreamMs, 1.0);
+        // Share of wall time the event loop thread spent on the CPU.
+        const qint64 rampWallMs = qMax<qint64>(1, m_rampWallMs);
+        report["loop_utilization_ramp"] =
+            double(m_cpuRamp.threadUs - m_cpuStart.threadUs) / (rampWallMs * 1000);
+        report["loop_utilization_hold"] =
+            double(end.threadUs - m_cpuRamp.threadUs) / (holdWallMs * 1000);
+        report["loop_lag_p99_us_ramp"] = percentile(m_rampLagUs, 0.99);
+        report["loop_lag_p99_us_hold"] = percentile(m_holdLagUs, 0.99);
+        report["loop_lag_max_us"] =
+            qMax(percentile(m_rampLagUs, 1.0), percentile(m_holdLagUs, 1.0));
+        report["peak_rss_kb"] = peakRssKb();
+        if (m_recorder) {
+            // Listeners are only removed on the thread of the device, so the
+            // shards go first.
+            delete m_sharded;
+            m_sharded = nullptr;
+            report["captured_frames"] = double(m_recorder->recordCount());
+            m_recorder.reset();
+            m_captureFile.close();
+        }
+        report["cpu_ms_per_device_ramp"] =
+            double(m_cpuRamp.processUs - m_cpuStart.processUs) / 1000.0 / devices;
+        // Steady state, per device and second of streaming.
+        report["cpu_ms_per_device_s_hold"] =
+            double(end.processUs - m_cpuRamp.processUs) / 1000.0 / devices / (holdWallMs / 1000.0);
+        emit done(report);
+    }
+
+    LoadOptions m_options;
+    // One of the two, as selected by LoadOptions::shards.
+    DeviceManager *m_manager = nullptr;
+    ShardedDeviceManager *m_sharded = nullptr;
+    QTimer *m_probe;
+    QTimer *m_deadline;
+    QList<MockDevice *> m_devices;
+    QHash<Device *, qint64> m_startedAt;
+    QHash<Device *, bool> m_outcome;
+    QList<qint64> m_timeToStreamMs;
+    QList<qint64> m_rampLagUs;
+    QList<qint64> m_holdLagUs;
+    QElapsedTimer m_wall;
+    QElapsedTimer m_holdWall;
+    QElapsedTimer m_probeClock;
+    qint64 m_lastProbeNs = 0;
+    qint64 m_rampWallMs = 0;
+    CpuTimes m_cpuStart;
+    CpuTimes m_cpuRamp;
+    bool m_holding = false;
+    QFile m_captureFile;
+    std::unique_ptr<CaptureRecorder> m_recorder;
+};
+
+void printReport(const QJsonObject &report) {
+    for (const QString &key : report.keys()) {
+        std::printf("%-28s %s\n", qPrintable(key),
+                    qPrintable(QString::number(report.value(key).toDouble())));
+    }
+    std::fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("dji_loadtest");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Fleet-scale load test of libdji on simulated cameras");
+    parser.addHelpOption();
+    QCommandLineOption devicesOpt("devices", "Number of cameras, 1 to 1000 (default 100).", "n",
+                                  "100");
+    QCommandLineOption latencyOpt("latency-ms", "Link latency of every answer (default 10).", "ms",
+                                  "10");
+    QCommandLineOption jitterOpt("jitter-ms", "Random extra latency, up to (default 0).", "ms",
+                                 "0");
+    QCommandLineOption lossOpt("loss", "Share of answers lost, 0 to 1 (default 0).", "rate", "0");
+    QCommandLineOption seedOpt("seed", "Seed for latency jitter and loss (default 1).", "n", "1");
+    QCommandLineOption rampOpt("ramp-ms", "Delay between starting cameras (default 0).", "ms",
+                               "0");
+    QCommandLineOption timeoutOpt("timeout", "Give up on cameras not live after (default 60).",
+                                  "seconds", "60");
+    QCommandLineOption holdOpt("hold", "Keep streaming after the ramp for (default 5).",
+                               "seconds", "5");
+    QCommandLineOption shardsOpt("shards",
+                                 "Run once per comma-separated shard count on a "
+                                 "ShardedDeviceManager; 0 is a plain DeviceManager (default 0).",
+                                 "list", "0");
+    QCommandLineOption jsonOpt("json", "Also write the report as JSON to <file>.", "file");
+    QCommandLineOption captureOpt("capture", "Record every frame to <file>.", "file");
+    QCommandLineOption verboseOpt("verbose", "Keep the debug output of the simulated cameras.");
+    parser.addOptions({devicesOpt, latencyOpt, jitterOpt, lossOpt, seedOpt, rampOpt, timeoutOpt,
+                       holdOpt, shardsOpt, jsonOpt, captureOpt, verboseOpt});
+    parser.process(app);
+
+    QList<int> shardCounts;
+    for (const QString &value : parser.value(shardsOpt).split(',', Qt::SkipEmptyParts)) {
+        bool ok = false;
+        const int shards = value.trimmed().toInt(&ok);
+        if (!ok || shards < 0 || shards > 64) {
+            std::fprintf(stderr, "Invalid shard count: %s\n", qPrintable(value));
+            return 1;
+        }
+        shardCounts.append(shards);
+    }
+    if (shardCounts.isEmpty()) {
+        shardCounts.append(0);
+    }
+
+    LoadOptions options;
+    options.devices = qBound(1, parser.value(devicesOpt).toInt(), 1000);
+    options.latencyMs = qMax(0, parser.value(latencyOpt).toInt());
+    options.jitterMs = qMax(0, parser.value(jitterOpt).toInt());
+    options.loss = qBound(0.0, parser.value(lossOpt).toDouble(), 1.0);
+    options.seed = parser.value(seedOpt).toUInt();
+    options.rampMs = qMax(0, parser.value(rampOpt).toInt());
+    options.timeoutMs = qMax(1, parser.value(timeoutOpt).toInt()) * 1000;
+    options.holdMs = qMax(0, parser.value(holdOpt).toInt()) * 1000;
+    options.capturePath = parser.value(captureOpt);
+    if (!options.capturePath.isEmpty() && shardCounts.size() > 1) {
+        std::fprintf(stderr, "--capture records a single run; give one shard count\n");
+        return 1;
+    }
+
+    // Every simulated frame is traced with qDebug(); at fleet sizes that
+    // would be most of what gets measured.
+    if (!parser.isSet(verboseOpt)) {
+        QLoggingCategory::setFilterRules("default.debug=false");
+    }
+
+    const QString jsonPath = parser.value(jsonOpt);
+    QJsonArray reports;
+    int exitCode = 0;
+    std::unique_ptr<LoadTest> test;
+    std::function<void(int)> run = [&](int index) {
+        test.reset();
+        if (index == shardCounts.size()) {
+            if (!jsonPath.isEmpty()) {
+                QFile file(jsonPath);
+                if (!file.open(QIODevice::WriteOnly)) {
+                    std::fprintf(stderr, "Cannot write %s\n", qPrintable(jsonPath));
+                    app.exit(1);
+                    return;
+                }
+                // A sweep writes an array, a single run just its report.
+                file.write(reports.size() == 1 ? QJsonDocument(reports.first().toObject()).toJson()
+                                               : QJsonDocument(reports).toJson());
+            }
+            app.exit(exitCode);
+            return;
+        }
+
+        options.shards = shardCounts.at(index);
+        test = std::make_unique<LoadTest>(options);
+        QObject::connect(test.get(), &LoadTest::done, &app, [&, index](const QJsonObject &report) {
+            if (index > 0) {
+                std::printf("\n");
+            }
+            printReport(report);
+            reports.append(report);
+            if (report["timed_out"].toInt() != 0 || report["failed"].toInt() != 0) {
+                exitCode = 2;
+            }
+            // Not from within the signal of the test being destroyed.
+            QTimer::singleShot(0, &app, [&run, index]() { run(index + 1); });
+        });
+        if (!test->start()) {
+            std::fprintf(stderr, "Cannot write %s\n", qPrintable(options.capturePath));
+            app.exit(1);
+        }
+    };
+    QTimer::singleShot(0, &app, [&run]() { run(0); });
+    return app.exec();
+}
+
+#include "loadtest.moc"
@@ -0,0 +1,237 @@
+/**
+ * @file mock_device.cpp
+ * @brief Scripted responses of the MockDevice used by the flow tests.
+ */
+
+#include "mock_device.h"
+#include "dji/link_health_monitor.h"
+#include <QDebug>
+#include <QtEndian>
+#include <algorithm>
+
+MockDevice::MockDevice(QObject *parent)
+    : dji::Device(QBluetoothDeviceInfo(), dji::DeviceType::OsmoPocket3, parent),
+      m_statusTimer(new dji::Timer(this)) {
+    // Like the camera, push a StreamingStatus periodically while live.
+    m_statusTimer->setInterval(50);
+    connect(m_statusTimer, &dji::Timer::timeout, this, [this]() {
+        if (!m_linkUp)
+            return;
+        dji::Message status;
+        status.subsystem = dji::SubsystemID::Status;
+        status.msgType = dji::MessageType::StreamingStatus;
+        status.payload = QByteArray(21, 0);
+        const int delivered =
+            m_uplinkKbps > 0 ? std::min(m_uplinkKbps, m_bitrateKbps) : m_bitrateKbps;
+        qToLittleEndian<quint16>(static_cast<quint16>(delivered), status.payload.data() + 2);
+        status.payload[20] = static_cast<char>(m_battery);
+        simulateIncomingMessage(status);
+    });
+}
+
+void MockDevice::setStreaming(bool streaming) {
+    if (streaming) {
+        m_statusTimer->start();
+    } else {
+        m_statusTimer->stop();
+    }
+}
+
+int MockDevice::answerDelay() {
+    if (m_jitterMs <= 0)
+        return m_latencyMs;
+    return m_latencyMs + std::uniform_int_distribution<int>(0, m_jitterMs)(m_rng);
+}
+
+bool MockDevice::answerLost() {
+    return m_lossRate > 0 && std::uniform_real_distribution<double>(0, 1)(m_rng) < m_lossRate;
+}
+
+void MockDevice::connectToDevice() {
+    ++m_connectCount;
+    dji::Timer::singleShot(answerDelay(), this, [this]() {
+        m_linkUp = true;
+        emit connected();
+        emit initialized();
+    });
+}
+
+void MockDevice::disconnectFromDevice() {
+    if (m_linkUp) {
+        simulateLinkLoss();
+    }
+}
+
+QByteArray MockDevice::wifiScanReport(const QList<dji::WiFiNetwork> &networks) {
+    QByteArray report;
+    report.append(static_cast<char>(networks.size()));
+    for (const dji::WiFiNetwork &network : networks) {
+        report.append(dji::packString(network.ssid));
+        report.append(static_cast<char>(network.rssi));
+        report.append(static_cast<char>(network.channel));
+        report.append(static_cast<char>(network.security));
+    }
+    return report;
+}
+
+void MockDevice::readRssi() {
+    if (m_rssi != 0) {
+        dji::Timer::singleShot(1, this, [this]() { emit rssiRead(m_rssi); });
+    }
+}
+
+void MockDevice::simulateLinkLoss() {
+    m_linkUp = false;
+    emit disconnected();
+}
+
+void MockDevice::sendMessage(const dji::Message &msg, bool noResponse) {
+    Q_UNUSED(noResponse);
+
+    qDebug().noquote() << "SENT_HEX:" << msg.serialize().toHex().toUpper();
+    notifyMessageSent(msg);
+    emit messageSent(msg);
+
+    if (answerLost())
+        return;
+    // Always respond asynchronously to avoid recursion issues
+    dji::Timer::singleShot(answerDelay(), this, [this, msg]() { handleSentMessage(msg); });
+}
+
+void MockDevice::sendRawPairing(const QByteArray &data) {
+    qDebug().noquote() << "SENT_HEX:" << data.toHex().toUpper();
+    emit rawPairingSent(data);
+
+    if (answerLost())
+        return;
+    // Simulate pairing status response
+    dji::Timer::singleShot(answerDelay(), this, [this]() {
+        dji::Message resp;
+        resp.subsystem = dji::SubsystemID::Status;
+        resp.msgType = dji::MessageType::MaybeStatus;
+        resp.payload = QByteArray(100, 0);
+        simulateIncomingMessage(resp);
+    });
+}
+
+void MockDevice::simulateIncomingMessage(const dji::Message &msg) {
+    qDebug().noquote() << "RECV_HEX:" << msg.serialize().toHex().toUpper();
+    deliverMessage(msg);
+}
+
+void MockDevice::handleSentMessage(const dji::Message &msg) {
+
+    dji::Message resp;
+    resp.subsystem = msg.subsystem;
+    resp.msgId = msg.msgId;
+    bool shouldRespond = false;
+
+    qDebug() << "MockDevice sent message type:" << static_cast<int>(msg.msgType)
+             << "Subsystem:" << static_cast<int>(msg.subsystem);
+
+    if (msg.msgType == dji::MessageType::SetPairingPIN) {
+
+        resp.msgType = dji::MessageType::PairingStatus;
+        resp.payload = QByteArray::fromHex("0001");
+        shouldRespond = true;
+
+    } else if (msg.msgType == dji::MessageType::PrepareToLiveStream) {
+
+        resp.msgType = dji::MessageType::PrepareToLiveStreamResult;
+        resp.payload = QByteArray::fromHex("00");
+        shouldRespond = true;
+
+    } else if (msg.msgType == dji::MessageType::ConnectToWiFi) {
+
+        const QString ssid = QString::fromUtf8(
+            msg.payload.mid(1, msg.payload.isEmpty() ? 0 : static_cast<uint8_t>(msg.payload[0])));
+        m_joinedSsids.append(ssid);
+        resp.msgType = dji::MessageType::ConnectToWiFiResult;
+        resp.payload = QByteArray::fromHex(m_rejectedSsids.contains(ssid) ? "0100" : "0000");
+        shouldRespond = true;
+
+    } else if (msg.msgType == dji::MessageType::StartScanningWiFi) {
+
+        int delayMs = 10;
+        for (const dji::WiFiNetwork &network : std::as_const(m_wifiNetworks)) {
+            dji::Message report;
+            report.subsystem = msg.subsystem;
+            report.msgId = msg.msgId;
+            report.msgType = dji::MessageType::WiFiScanReport;
+            report.payload = wifiScanReport({network});
+            dji::Timer::singleShot(delayMs, this, [this, report]() { simulateIncomingMessage(report); });
+            delayMs += 10;
+        }
+
+    } else if (msg.msgType == dji::MessageType::StartStopStreaming ||
+               msg.msgType == dji::MessageType::Configure ||
+               msg.msgType == dji::MessageType::ConfigureStreaming) {
+        resp.msgType = msg.msgType;
+        resp.payload = QByteArray::fromHex("00");
+
+        if (msg.subsystem == dji::SubsystemID::Streamer) {
+            if (msg.msgType == dji::MessageType::ConfigureStreaming) {
+                // 12 bytes of stream settings, then the URL with a 16-bit LE length.
+                m_rtmpUrl = QString::fromUtf8(msg.payload.mid(14));
+                m_bitrateKbps = qFromLittleEndian<quint16>(msg.payload.constData() + 4);
+                // ConfigureStreaming doesn't seem to have a specific result type in constants.h
+                // but let's assume it returns success
+                resp.msgType = dji::MessageType::StartStopStreamingResult;
+            } else {
+                resp.msgType = dji::MessageType::StartStopStreamingResult;
+            }
+        }
+        shouldRespond = msg.msgType != dji::MessageType::ConfigureStreaming ||
+                        m_answersConfigureStreaming;
+
+        qDebug() << "StartStopStreaming/Configure payload hex:" << msg.payload.toHex();
+
+        if (msg.subsystem == dji::SubsystemID::Streamer && msg.payload.size() >= 1 &&
+            static_cast<unsigned char>(msg.payload.at(0)) == 0x01 &&
+            msg.msgType == dji::MessageType::StartStopStreaming) {
+            // The last byte tells start (0x01) from stop (0x02).
+            const bool start = static_cast<unsigned char>(msg.payload.back()) == 0x01;
+            qDebug() << "Condition met, stream is now" << (start ? "live" : "stopped")
+                     << "Payload size:" << msg.payload.size();
+            setStreaming(start);
+        }
+    }
+
+    if (shouldRespond) {
+        simulateIncomingMessage(resp);
+    }
+}
+
+dji::StreamingOptions testStreamingOptions() {
+    dji::StreamingOptions opts;
+    opts.ssid = "test-ssid";
+    opts.psk = "test-psk";
+    opts.rtmpUrl = "rtmp://test/live";
+    return opts;
+}
+
+int countSent(const QList<QList<QVariant>> &sent, dji::MessageType type) {
+    int count = 0;
+    for (const QList<QVariant> &args : sent) {
+        if (args.at(0).value<dji::Message>().msgType == type)
+            ++count;
+    }
+    return count;
+}
+
+bool startStreaming(dji::VirtualScheduler &clock, dji::DeviceManager &manager, MockDevice &device,
+                    const dji::StreamingOptions &options) {
+    int finished = 0;
+    bool success = false;
+    const QMetaObject::Connection connection =
+        QObject::connect(&manager, &dji::DeviceManager::finished,
+                         [&device, &finished, &success](dji::Device *dev, bool ok) {
+                             if (dev == &device && finished++ == 0) {
+                                 success = ok;
+                             }
+                         });
+    manager.connectToWiFiAndStartStreaming(&device, options);
+    const bool done = clock.advanceUntil([&finished]() { return finished > 0; }, 5000);
+    QObject::disconnect(connection);
+    return done && success;
+}
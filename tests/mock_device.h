@@ -0,0 +1,145 @@
+/**
+ * @file mock_device.h
+ * @brief In-process DJI device double that answers the connection flow.
+ */
+
+#ifndef TST_MOCK_DEVICE_H
+#define TST_MOCK_DEVICE_H
+
+#include "dji/device.h"
+#include "dji/device_manager.h"
+#include "dji/message.h"
+#include "dji/scheduler.h"
+#include "dji/wifi_scan.h"
+#include <QByteArray>
+#include <QList>
+#include <QStringList>
+#include <QVariant>
+#include <random>
+
+class MockDevice : public dji::Device {
+    Q_OBJECT
+public:
+    explicit MockDevice(QObject *parent = nullptr);
+
+    void connectToDevice() override;
+    void disconnectFromDevice() override;
+    void readRssi() override;
+    void sendMessage(const dji::Message &msg, bool noResponse = true) override;
+    void sendRawPairing(const QByteArray &data) override;
+
+    bool isConnected() const override {
+        return m_linkUp;
+    }
+    bool isInitialized() const override {
+        return m_linkUp;
+    }
+
+    void simulateIncomingMessage(const dji::Message &msg);
+    // Feeds raw notification bytes through the frame reassembly of dji::Device.
+    void simulateNotification(const QByteArray &data) {
+        receiveNotification(data);
+    }
+    // Drops the BLE link as if the camera went out of range.
+    void simulateLinkLoss();
+    // Value answered to readRssi(); 0 answers nothing.
+    void setRssi(int rssi) {
+        m_rssi = rssi;
+    }
+    // Starts or stops the camera-side stream without going through the protocol.
+    void setStreaming(bool streaming);
+    bool isStreaming() const {
+        return m_statusTimer->isActive();
+    }
+    // Period of the StreamingStatus pushes while live (default 50 ms).
+    void setStatusInterval(int ms) {
+        m_statusTimer->setInterval(ms);
+    }
+    // APs reported after StartScanningWiFi, one scan report each.
+    void setWiFiNetworks(const QList<dji::WiFiNetwork> &networks) {
+        m_wifiNetworks = networks;
+    }
+    // SSIDs whose ConnectToWiFi is answered with a failure.
+    void setRejectedSsids(const QStringList &ssids) {
+        m_rejectedSsids = ssids;
+    }
+    QStringList joinedSsids() const {
+        return m_joinedSsids;
+    }
+    // URL and bitrate of the last ConfigureStreaming request.
+    QString rtmpUrl() const {
+        return m_rtmpUrl;
+    }
+    int bitrateKbps() const {
+        return m_bitrateKbps;
+    }
+    // Battery percentage reported in StreamingStatus.
+    void setBattery(int percentage) {
+        m_battery = percentage;
+    }
+    // Uplink capacity; StreamingStatus reports what of the bitrate gets through.
+    // 0 means unlimited.
+    void setUplinkKbps(int kbps) {
+        m_uplinkKbps = kbps;
+    }
+    // Whether ConfigureStreaming gets an answer; what the camera sends back
+    // to it is only inferred.
+    void setAnswersConfigureStreaming(bool answers) {
+        m_answersConfigureStreaming = answers;
+    }
+    static QByteArray wifiScanReport(const QList<dji::WiFiNetwork> &networks);
+    int connectCount() const {
+        return m_connectCount;
+    }
+    // Delay of every answer and of the link coming up: latencyMs plus up to
+    // jitterMs more.
+    void setLinkLatency(int latencyMs, int jitterMs = 0) {
+        m_latencyMs = latencyMs;
+        m_jitterMs = jitterMs;
+    }
+    // Share (0..1) of answers that never arrive, drawn from a seeded generator
+    // so that runs are repeatable.
+    void setLossRate(double rate, quint32 seed = 1) {
+        m_lossRate = rate;
+        m_rng.seed(seed);
+    }
+
+signals:
+    void messageSent(const dji::Message &msg);
+    void rawPairingSent(const QByteArray &data);
+
+private:
+    void handleSentMessage(const dji::Message &msg);
+    int answerDelay();
+    bool answerLost();
+
+    dji::Timer *m_statusTimer;
+    bool m_linkUp = true;
+    int m_rssi = 0;
+    QList<dji::WiFiNetwork> m_wifiNetworks;
+    QStringList m_rejectedSsids;
+    QStringList m_joinedSsids;
+    QString m_rtmpUrl;
+    int m_bitrateKbps = 0;
+    int m_uplinkKbps = 0;
+    int m_battery = 100;
+    bool m_answersConfigureStreaming = true;
+    int m_connectCount = 0;
+    int m_latencyMs = 10;
+    int m_jitterMs = 0;
+    double m_lossRate = 0.0;
+    std::mt19937 m_rng;
+};
+
+// Options the mock joins and streams with: "test-ssid" / "test-psk" to rtmp://test/live.
+dji::StreamingOptions testStreamingOptions();
+
+// Messages of the given type recorded by a QSignalSpy on MockDevice::messageSent.
+int countSent(const QList<QList<QVariant>> &sent, dji::MessageType type);
+
+// Runs connectToWiFiAndStartStreaming() on virtual time; true once the flow
+// finished successfully.
+bool startStreaming(dji::VirtualScheduler &clock, dji::DeviceManager &manager, MockDevice &device,
+                    const dji::StreamingOptions &options = testStreamingOptions());
+
+#endif
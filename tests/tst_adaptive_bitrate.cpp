@@ -0,0 +1,213 @@
+/**
+ * @file tst_adaptive_bitrate.cpp
+ * @brief Unit tests for the adaptive bitrate policy and controller.
+ */
+
+#include "tst_adaptive_bitrate.h"
+#include "mock_device.h"
+#include "dji/adaptive_bitrate.h"
+#include "dji/device_manager.h"
+#include "dji/scheduler.h"
+#include "dji/subsystem_streamer.h"
+#include <QSignalSpy>
+#include <QtTest>
+
+using namespace dji;
+
+namespace {
+
+const StreamSettings ceiling{Resolution::Res1080p, 4000, FPS::FPS25};
+
+StreamTelemetry sample(int deliveredKbps, int linkScore = 100) {
+    StreamTelemetry telemetry;
+    telemetry.deliveredKbps = deliveredKbps;
+    telemetry.linkScore = linkScore;
+    return telemetry;
+}
+
+LadderBitratePolicy::Options fastOptions() {
+    LadderBitratePolicy::Options options;
+    options.downgradeAfter = 3;
+    options.upgradeAfter = 5;
+    return options;
+}
+
+} // namespace
+
+void TestAdaptiveBitrate::testLadderHysteresis() {
+    LadderBitratePolicy policy(LadderBitratePolicy::defaultLadder(), fastOptions());
+    policy.reset(ceiling);
+    QCOMPARE(policy.rungs().first(), ceiling);
+    QCOMPARE(policy.rungs().last().bitrateKbps, uint16_t(600));
+    QCOMPARE(policy.rungs().last().fps, FPS::FPS25);
+
+    // Two bad samples are tolerated, the third drops to what 1800 kbps carries.
+    StreamSettings current = ceiling;
+    QCOMPARE(policy.decide(current, sample(1800)), current);
+    QCOMPARE(policy.decide(current, sample(1800)), current);
+    current = policy.decide(current, sample(1800));
+    QCOMPARE(current.resolution, Resolution::Res720p);
+    QCOMPARE(current.bitrateKbps, uint16_t(1500));
+
+    // A good sample in between restarts the count.
+    QCOMPARE(policy.decide(current, sample(1500)), current);
+    QCOMPARE(policy.decide(current, sample(1000)), current);
+    QCOMPARE(policy.decide(current, sample(1500)), current);
+    QCOMPARE(policy.decide(current, sample(1000)), current);
+
+    // Climbing is one rung at a time, and slower than dropping.
+    for (int i = 0; i < 4; ++i) {
+        QCOMPARE(policy.decide(current, sample(1500)), current);
+    }
+    current = policy.decide(current, sample(1500));
+    QCOMPARE(current.bitrateKbps, uint16_t(2500));
+    for (int i = 0; i < 4; ++i) {
+        QCOMPARE(policy.decide(current, sample(2500)), current);
+    }
+    QCOMPARE(policy.decide(current, sample(2500)), ceiling);
+    // Never above the ceiling.
+    for (int i = 0; i < 10; ++i) {
+        QCOMPARE(policy.decide(ceiling, sample(4000)), ceiling);
+    }
+}
+
+void TestAdaptiveBitrate::testFailedProbeBacksOff() {
+    LadderBitratePolicy policy(LadderBitratePolicy::defaultLadder(), fastOptions());
+    policy.reset(ceiling);
+    StreamSettings current = policy.rungs().at(2);
+    QCOMPARE(current.bitrateKbps, uint16_t(1500));
+
+    for (int i = 0; i < 4; ++i) {
+        QCOMPARE(policy.decide(current, sample(1500)), current);
+    }
+    current = policy.decide(current, sample(1500));
+    QCOMPARE(current.bitrateKbps, uint16_t(2500));
+
+    // The uplink tops out at 1200 kbps: the probe fails.
+    for (int i = 0; i < 2; ++i) {
+        QCOMPARE(policy.decide(current, sample(1200)), current);
+    }
+    current = policy.decide(current, sample(1200));
+    QCOMPARE(current.bitrateKbps, uint16_t(1000));
+
+    // The next attempt waits twice as long.
+    for (int i = 0; i < 9; ++i) {
+        QCOMPARE(policy.decide(current, sample(1000)), current);
+    }
+    QCOMPARE(policy.decide(current, sample(1000)).bitrateKbps, uint16_t(1500));
+}
+
+void TestAdaptiveBitrate::testLinkHealthBlocksUpgrade() {
+    LadderBitratePolicy policy(LadderBitratePolicy::defaultLadder(), fastOptions());
+    policy.reset(ceiling);
+    StreamSettings current = policy.rungs().at(1);
+
+    for (int i = 0; i < 20; ++i) {
+        QCOMPARE(policy.decide(current, sample(current.bitrateKbps, 40)), current);
+    }
+    // Unknown throughput never changes anything.
+    for (int i = 0; i < 20; ++i) {
+        QCOMPARE(policy.decide(current, sample(-1)), current);
+    }
+}
+
+void TestAdaptiveBitrate::testFollowsBandwidthTrace() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    DeviceManager manager(&device);
+    AdaptiveBitrateController *controller = manager.bitrateController(&device);
+    controller->setPolicy(std::make_unique<LadderBitratePolicy>(
+        LadderBitratePolicy::defaultLadder(), fastOptions()));
+    controller->setMinReconfigureInterval(300);
+
+    ElapsedTimer elapsed;
+    QList<qint64> changedAt;
+    int lowestKbps = 4000;
+    connect(controller, &AdaptiveBitrateController::settingsChanged, this,
+            [&](const StreamSettings &settings, int) {
+                changedAt.append(elapsed.elapsed());
+                lowestKbps = std::min<int>(lowestKbps, settings.bitrateKbps);
+            });
+
+    QSignalSpy spyFinished(&manager, &DeviceManager::finished);
+    StreamingOptions opts = testStreamingOptions();
+    opts.adaptiveBitrate = true;
+    manager.connectToWiFiAndStartStreaming(&device, opts);
+    QVERIFY(clock.advanceUntil([&spyFinished]() { return !spyFinished.isEmpty(); }, 5000));
+    QVERIFY(controller->isRunning());
+    elapsed.start();
+
+    // Scripted uplink: plenty, then congested, then plenty again.
+    const QList<QPair<int, int>> trace{{10000, 600}, {1200, 2000}, {10000, 4000}};
+    for (int i = 0; i < trace.size(); ++i) {
+        device.setUplinkKbps(trace[i].first);
+        clock.advance(trace[i].second);
+        if (i == 0) {
+            QCOMPARE(controller->reconfigureCount(), 0);
+        }
+    }
+
+    // Dropped to what the congested uplink carries, and probed up sparingly.
+    QVERIFY(lowestKbps <= 1000);
+    QVERIFY(controller->reconfigureCount() <= 8);
+    QVERIFY(clock.advanceUntil([&device]() { return device.bitrateKbps() == 4000; }, 5000));
+    QCOMPARE(controller->settings(), (StreamSettings{Resolution::Res1080p, 4000, FPS::FPS25}));
+
+    // The reconfiguration rate stays under the cap.
+    for (int i = 1; i < changedAt.size(); ++i) {
+        QVERIFY(changedAt[i] - changedAt[i - 1] >= 300);
+    }
+    QVERIFY(device.isStreaming());
+}
+
+void TestAdaptiveBitrate::testCooldownStartsAtFirstChange() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    DeviceManager manager(&device);
+    QVERIFY(startStreaming(clock, manager, device));
+
+    AdaptiveBitrateController controller(&device);
+    controller.setPolicy(std::make_unique<LadderBitratePolicy>(
+        LadderBitratePolicy::defaultLadder(), fastOptions()));
+    controller.setMinReconfigureInterval(60000);
+    controller.start(ceiling);
+
+    // Congestion right after the start is acted on at once...
+    for (int i = 0; i < 3; ++i) {
+        controller.onTelemetry(sample(1800));
+    }
+    QCOMPARE(controller.reconfigureCount(), 1);
+    QVERIFY(
+        clock.advanceUntil([&device]() { return !device.streamer()->isReconfiguring(); }, 5000));
+
+    // ...and only then the cooldown holds further changes back.
+    for (int i = 0; i < 6; ++i) {
+        controller.onTelemetry(sample(600));
+    }
+    QCOMPARE(controller.reconfigureCount(), 1);
+}
+
+void TestAdaptiveBitrate::testReconfigureTimesOut() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    DeviceManager manager(&device);
+    QVERIFY(startStreaming(clock, manager, device));
+
+    SubsystemStreamer *streamer = device.streamer();
+    streamer->setOperationTimeout(200);
+    device.setLossRate(1.0);
+    QSignalSpy spyError(streamer, &SubsystemStreamer::error);
+    QVERIFY(streamer->reconfigureLiveStream(Resolution::Res720p, 2500, FPS::FPS25));
+    QVERIFY(streamer->isReconfiguring());
+
+    // Nothing is answered, so the operation timeout decides.
+    clock.advance(199);
+    QVERIFY(streamer->isReconfiguring());
+    clock.advance(1);
+    QCOMPARE(spyError.count(), 1);
+    QVERIFY(!streamer->isReconfiguring());
+    QVERIFY(!streamer->isSwitchingEndpoint());
+}
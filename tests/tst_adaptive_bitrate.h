@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QObject>
+#include <QTest>
+
+class TestAdaptiveBitrate : public QObject {
+    Q_OBJECT
+private slots:
+    void testLadderHysteresis();
+    void testFailedProbeBacksOff();
+    void testLinkHealthBlocksUpgrade();
+    void testFollowsBandwidthTrace();
+    void testCooldownStartsAtFirstChange();
+    void testReconfigureTimesOut();
+};
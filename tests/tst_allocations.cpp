@@ -0,0 +1,117 @@
+/**
+ * @file tst_allocations.cpp
+ * @brief Heap allocation budgets of the receive path.
+ */
+
+#include "tst_allocations.h"
+#include "alloc_counter.h"
+#include "mock_device.h"
+#include "dji/subsystem_streamer.h"
+#include <QtTest>
+
+using namespace dji;
+
+namespace {
+
+const int iterations = 1000;
+
+QByteArray streamingStatusFrame(int battery) {
+    Message msg;
+    msg.subsystem = SubsystemID::Status;
+    msg.msgType = MessageType::StreamingStatus;
+    msg.payload = QByteArray(21, 0);
+    msg.payload[20] = static_cast<char>(battery);
+    return msg.serialize();
+}
+
+} // namespace
+
+void TestAllocations::testCounter() {
+    if (!AllocCounter::isSupported())
+        QSKIP("Allocation counting needs glibc");
+
+    // Otherwise a broken counter would pass every budget below.
+    AllocScope scope;
+    QByteArray data(4096, 'x');
+    data[0] = 'y';
+    const AllocStats stats = scope.elapsed();
+    QVERIFY(stats.allocations >= 1);
+    QVERIFY(stats.bytes >= 4096);
+}
+
+void TestAllocations::testStreamingStatusReceive() {
+    if (!AllocCounter::isSupported())
+        QSKIP("Allocation counting needs glibc");
+
+    MockDevice device;
+    int battery = -1;
+    int statuses = 0;
+    connect(device.streamer(), &SubsystemStreamer::batteryPercentageChanged, &device,
+            [&battery, &statuses](int percentage) {
+                battery = percentage;
+                ++statuses;
+            });
+    const QByteArray frame = streamingStatusFrame(80);
+
+    // The first frame sizes the payload buffer it is parsed into.
+    device.simulateNotification(frame);
+    QCOMPARE(statuses, 1);
+
+    // Receive, parse, dispatch to every subsystem and handle the status.
+    AllocScope scope;
+    for (int i = 0; i < iterations; ++i) {
+        device.simulateNotification(frame);
+    }
+    const AllocStats stats = scope.elapsed();
+    QCOMPARE(statuses, 1 + iterations);
+    QCOMPARE(battery, 80);
+    QVERIFY(device.streamer()->hasRecentStreamingStatus(1000));
+    QCOMPARE(stats.allocations, quint64(0));
+}
+
+void TestAllocations::testSeveralFramesPerNotification() {
+    if (!AllocCounter::isSupported())
+        QSKIP("Allocation counting needs glibc");
+
+    MockDevice device;
+    int statuses = 0;
+    connect(device.streamer(), &SubsystemStreamer::batteryPercentageChanged, &device,
+            [&statuses](int) { ++statuses; });
+    // Two frames behind a byte of noise, in a single notification.
+    const QByteArray notification =
+        QByteArray(1, '\x00') + streamingStatusFrame(80) + streamingStatusFrame(79);
+    device.simulateNotification(notification);
+    QCOMPARE(statuses, 2);
+
+    AllocScope scope;
+    for (int i = 0; i < iterations; ++i) {
+        device.simulateNotification(notification);
+    }
+    const AllocStats stats = scope.elapsed();
+    QCOMPARE(statuses, 2 + 2 * iterations);
+    QCOMPARE(stats.allocations, quint64(0));
+}
+
+void TestAllocations::testReceiverKeepsCopies() {
+    if (!AllocCounter::isSupported())
+        QSKIP("Allocation counting needs glibc");
+
+    // Like DeviceEventBus, keep the last message of the device.
+    MockDevice device;
+    Message last;
+    connect(&device, &Device::messageReceived, &device,
+            [&last](const Message &msg) { last = msg; });
+    const QByteArray frame = streamingStatusFrame(80);
+    // Parsed into two messages in turn, each sized by its first frame.
+    device.simulateNotification(frame);
+    device.simulateNotification(frame);
+
+    AllocScope scope;
+    for (int i = 0; i < iterations; ++i) {
+        device.simulateNotification(frame);
+    }
+    const AllocStats stats = scope.elapsed();
+    QCOMPARE(last.msgType, MessageType::StreamingStatus);
+    QCOMPARE(device.framePool().misses(), quint64(0));
+    QCOMPARE(stats.allocations, quint64(0));
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <QObject>
+#include <QTest>
+
+class TestAllocations : public QObject {
+    Q_OBJECT
+private slots:
+    void testCounter();
+    void testStreamingStatusReceive();
+    void testSeveralFramesPerNotification();
+    void testReceiverKeepsCopies();
+};
@@ -0,0 +1,155 @@
+/**
+ * @file tst_battery_policy.cpp
+ * @brief Unit tests for battery history, threshold actions and standby starts.
+ */
+
+#include "tst_battery_policy.h"
+#include "mock_device.h"
+#include "dji/battery_policy.h"
+#include "dji/device_manager.h"
+#include "dji/scheduler.h"
+#include "dji/subsystem_streamer.h"
+#include <QSignalSpy>
+#include <QtTest>
+
+using namespace dji;
+
+namespace {
+
+StreamingOptions streamOptions() {
+    StreamingOptions opts = testStreamingOptions();
+    opts.fps = FPS::FPS30;
+    return opts;
+}
+
+} // namespace
+
+void TestBatteryPolicy::testTimeToEmpty() {
+    BatteryHistory history;
+    QCOMPARE(history.percentage(), -1);
+    QCOMPARE(history.timeToEmptyMs(), qint64(-1));
+
+    // 1% every 30 s with a reading that bounces back once.
+    const qint64 minute = 60000;
+    history.addSample(0, 80);
+    history.addSample(minute / 2, 79);
+    history.addSample(minute, 78);
+    history.addSample(minute + 1000, 79);
+    history.addSample(3 * minute / 2, 77);
+    history.addSample(2 * minute, 76);
+    QCOMPARE(history.percentage(), 76);
+    QCOMPARE(history.samples().size(), 6);
+
+    const double rate = history.dischargeRatePerMinute();
+    QVERIFY(rate > 1.7 && rate < 2.3);
+    const qint64 tte = history.timeToEmptyMs();
+    QVERIFY(tte > 33 * minute && tte < 45 * minute);
+
+    // Repeated readings are not stored; old ones fall out of the window.
+    history.addSample(3 * minute, 76);
+    QCOMPARE(history.samples().size(), 6);
+    history.setWindow(minute);
+    history.addSample(4 * minute, 74);
+    QCOMPARE(history.samples().first().percentage, 76);
+
+    // Charging: no prediction.
+    BatteryHistory charging;
+    charging.addSample(0, 50);
+    charging.addSample(minute, 52);
+    charging.addSample(2 * minute, 54);
+    QCOMPARE(charging.timeToEmptyMs(), qint64(-1));
+}
+
+void TestBatteryPolicy::testThresholdActions() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    DeviceManager manager(&device);
+    BatteryPolicy policy;
+    policy.thresholds = {{30, -1, BatteryAction::Alert},
+                         {20, -1, BatteryAction::LowerBitrate},
+                         {10, -1, BatteryAction::LowerFrameRate}};
+    manager.setBatteryPolicy(policy);
+    QSignalSpy spyThreshold(&manager, &DeviceManager::batteryThresholdReached);
+    QSignalSpy spyFinished(&manager, &DeviceManager::finished);
+
+    manager.connectToWiFiAndStartStreaming(&device, streamOptions());
+    QVERIFY(clock.advanceUntil([&]() { return spyFinished.count() == 1; }, 5000));
+    QVERIFY(clock.advanceUntil([&]() { return manager.batteryPercentage(&device) == 100; }, 2000));
+    QCOMPARE(device.bitrateKbps(), 4000);
+
+    device.setBattery(25);
+    QVERIFY(clock.advanceUntil([&]() { return spyThreshold.count() == 1; }, 2000));
+    QCOMPARE(spyThreshold.at(0).at(1).toInt(), 25);
+    QCOMPARE(device.bitrateKbps(), 4000);
+
+    // Further readings do not fire the same threshold again.
+    device.setBattery(19);
+    QVERIFY(clock.advanceUntil([&]() { return device.bitrateKbps() == 2000; }, 2000));
+    clock.advance(200);
+    QCOMPARE(spyThreshold.count(), 2);
+    QCOMPARE(device.streamer()->fps(), FPS::FPS30);
+
+    device.setBattery(9);
+    QVERIFY(clock.advanceUntil([&]() { return device.streamer()->fps() == FPS::FPS25; }, 2000));
+    QCOMPARE(spyThreshold.count(), 3);
+    QCOMPARE(device.bitrateKbps(), 2000);
+    QVERIFY(device.isStreaming());
+}
+
+void TestBatteryPolicy::testStandbyThenGoLive() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    DeviceManager manager(&device);
+    QSignalSpy spyFinished(&manager, &DeviceManager::finished);
+
+    StreamingOptions opts = streamOptions();
+    opts.standby = true;
+    manager.connectToWiFiAndStartStreaming(&device, opts);
+    QVERIFY(clock.advanceUntil([&]() { return spyFinished.count() == 1; }, 5000));
+    QCOMPARE(spyFinished.first().at(1).toBool(), true);
+    QVERIFY(manager.isWiFiConnected(&device));
+    QVERIFY(!manager.isStreaming(&device));
+    QVERIFY(!device.isStreaming());
+
+    manager.goLive(&device);
+    QVERIFY(clock.advanceUntil([&]() { return spyFinished.count() == 2; }, 5000));
+    QCOMPARE(spyFinished.last().at(1).toBool(), true);
+    QVERIFY(manager.isStreaming(&device));
+    QVERIFY(device.isStreaming());
+    QCOMPARE(device.joinedSsids().size(), 1);
+}
+
+void TestBatteryPolicy::testStopStreamingSurvivesReconnect() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    DeviceManager manager(&device);
+    ReconnectPolicy reconnect;
+    reconnect.enabled = true;
+    reconnect.initialDelayMs = 10;
+    manager.setReconnectPolicy(reconnect);
+    BatteryPolicy policy;
+    policy.thresholds = {{15, -1, BatteryAction::StopStreaming}};
+    manager.setBatteryPolicy(policy);
+    QSignalSpy spyFinished(&manager, &DeviceManager::finished);
+    QSignalSpy spyReconnected(&manager, &DeviceManager::reconnected);
+
+    manager.connectToWiFiAndStartStreaming(&device, streamOptions());
+    QVERIFY(clock.advanceUntil([&]() { return spyFinished.count() == 1; }, 5000));
+    device.setBattery(10);
+    QVERIFY(clock.advanceUntil([&]() { return !manager.isStreaming(&device); }, 2000));
+    QVERIFY(!device.isStreaming());
+
+    // Resuming after the link comes back keeps the camera on standby.
+    device.simulateLinkLoss();
+    QVERIFY(clock.advanceUntil([&]() { return spyReconnected.count() == 1; }, 5000));
+    QVERIFY(clock.advanceUntil([&]() { return !manager.hasActiveFlow(&device); }, 5000));
+    QVERIFY(!device.isStreaming());
+    QVERIFY(!manager.isStreaming(&device));
+
+    manager.goLive(&device);
+    QVERIFY(clock.advanceUntil([&]() { return manager.isStreaming(&device); }, 5000));
+    QVERIFY(device.isStreaming());
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <QObject>
+#include <QTest>
+
+class TestBatteryPolicy : public QObject {
+    Q_OBJECT
+private slots:
+    void testTimeToEmpty();
+    void testThresholdActions();
+    void testStandbyThenGoLive();
+    void testStopStreamingSurvivesReconnect();
+};
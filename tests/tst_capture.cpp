@@ -0,0 +1,174 @@
+/**
+ * @file tst_capture.cpp
+ * @brief Unit tests for the capture format and CaptureRecorder.
+ */
+
+#include "tst_capture.h"
+#include "mock_device.h"
+#include "dji/capture.h"
+#include "dji/capture_recorder.h"
+#include "dji/scheduler.h"
+#include <QBuffer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QtTest>
+
+using namespace dji;
+
+namespace {
+
+Message streamingStatus(int battery) {
+    Message msg;
+    msg.subsystem = SubsystemID::Status;
+    msg.msgType = MessageType::StreamingStatus;
+    msg.payload = QByteArray(21, 0);
+    msg.payload[20] = static_cast<char>(battery);
+    return msg;
+}
+
+QByteArray record(uint64_t timestampUs, uint16_t device, capture::Direction direction,
+                  const Message &msg) {
+    uint8_t header[capture::recordHeaderSize];
+    capture::writeRecordHeader(timestampUs, device, direction, header);
+    return QByteArray(reinterpret_cast<const char *>(header), sizeof(header)) + msg.serialize();
+}
+
+const uint8_t *bytes(const QByteArray &data) {
+    return reinterpret_cast<const uint8_t *>(data.constData());
+}
+
+} // namespace
+
+void TestCapture::testRecorder() {
+    VirtualScheduler scheduler;
+    ScopedScheduler scope(&scheduler);
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+
+    MockDevice first;
+    MockDevice second;
+    CaptureRecorder recorder(&buffer);
+    QCOMPARE(recorder.attach(&first), 0);
+    QCOMPARE(recorder.attach(&second), 1);
+    QCOMPARE(recorder.attach(&first), 0);
+
+    scheduler.advance(5);
+    Message request;
+    request.subsystem = SubsystemID::Streamer;
+    request.msgId = MessageID::ConfigureStreaming;
+    request.msgType = MessageType::ConfigureStreaming;
+    request.payload = QByteArray("\x01\x02", 2);
+    first.sendMessage(request);
+    scheduler.advance(2);
+    second.simulateIncomingMessage(streamingStatus(80));
+
+    recorder.detach(&second);
+    second.simulateIncomingMessage(streamingStatus(79));
+    QCOMPARE(recorder.recordCount(), quint64(2));
+    QCOMPARE(recorder.writeErrors(), quint64(0));
+
+    const QByteArray data = buffer.data();
+    QVERIFY(capture::hasMagic(bytes(data), data.size()));
+    size_t offset = capture::magicSize;
+
+    capture::Record rec;
+    size_t size = capture::readRecord(bytes(data) + offset, data.size() - offset, &rec);
+    QVERIFY(size > 0);
+    QCOMPARE(rec.timestampUs, uint64_t(5000));
+    QCOMPARE(rec.device, uint16_t(0));
+    QVERIFY(rec.direction == capture::Direction::Sent);
+    QVERIFY(rec.frame.msgType == MessageType::ConfigureStreaming);
+    QCOMPARE(QByteArray(reinterpret_cast<const char *>(rec.frame.payload), rec.frame.payloadSize),
+             request.payload);
+    offset += size;
+
+    size = capture::readRecord(bytes(data) + offset, data.size() - offset, &rec);
+    QVERIFY(size > 0);
+    QCOMPARE(rec.timestampUs, uint64_t(7000));
+    QCOMPARE(rec.device, uint16_t(1));
+    QVERIFY(rec.direction == capture::Direction::Received);
+    QVERIFY(rec.frame.msgType == MessageType::StreamingStatus);
+    offset += size;
+    QCOMPARE(offset, size_t(data.size()));
+}
+
+void TestCapture::testResync() {
+    const QByteArray first = record(100, 0, capture::Direction::Sent, streamingStatus(80));
+    const QByteArray second = record(200, 3, capture::Direction::Received, streamingStatus(79));
+    const QByteArray data = first + second;
+
+    capture::Record rec;
+    QCOMPARE(capture::readRecord(bytes(data), data.size(), &rec), size_t(first.size()));
+    // Cut off, or not at a record boundary.
+    QCOMPARE(capture::readRecord(bytes(first), first.size() - 1, &rec), size_t(0));
+    QCOMPARE(capture::readRecord(bytes(data) + 3, data.size() - 3, &rec), size_t(0));
+
+    // Starting anywhere inside the first record finds the second.
+    for (qsizetype start = 1; start < first.size(); ++start) {
+        QCOMPARE(capture::findRecord(bytes(data) + start, data.size() - start),
+                 size_t(first.size() - start));
+    }
+    QCOMPARE(capture::findRecord(bytes(data), data.size()), size_t(0));
+    QCOMPARE(capture::findRecord(bytes(second), second.size() - 1), size_t(second.size() - 1));
+
+    // A corrupt frame is skipped.
+    QByteArray corrupt = data;
+    corrupt[capture::recordHeaderSize + protocol::headerSize] ^= 0x01;
+    QCOMPARE(capture::readRecord(bytes(corrupt), corrupt.size(), &rec), size_t(0));
+    QCOMPARE(capture::findRecord(bytes(corrupt), corrupt.size()), size_t(first.size()));
+    QCOMPARE(capture::readRecord(bytes(corrupt) + first.size(), second.size(), &rec),
+             size_t(second.size()));
+    QCOMPARE(rec.timestampUs, uint64_t(200));
+    QCOMPARE(rec.device, uint16_t(3));
+}
+
+void TestCapture::testAnalyzerChunking() {
+#ifndef DJI_CAPTURE_ANALYZE
+    QSKIP("dji_capture_analyze is not built");
+#else
+    // One unknown type with a new payload in nearly every frame: far more
+    // distinct payloads than are listed, spread over several 1 MiB chunks.
+    const int frames = 120000;
+    QByteArray data(capture::magic, capture::magicSize);
+    Message msg;
+    msg.subsystem = SubsystemID::Status;
+    msg.msgId = static_cast<MessageID>(0x1234);
+    msg.msgType = MessageType::Unknown3;
+    for (int i = 0; i < frames; ++i) {
+        msg.payload = i % 50 == 0 ? QByteArray::fromHex("feedface")
+                                  : QByteArray::number(i, 16).rightJustified(8, '0');
+        data += record(uint64_t(i) * 100, 0, capture::Direction::Received, msg);
+    }
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QFile file(dir.filePath("high_cardinality.djicap"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(data);
+    file.close();
+
+    const auto analyze = [&file](const QStringList &arguments) {
+        QProcess process;
+        process.start(DJI_CAPTURE_ANALYZE, arguments + QStringList{"--json", "-", file.fileName()});
+        process.waitForFinished(60000);
+        return process.readAllStandardOutput();
+    };
+    const QByteArray whole = analyze({"--threads", "1", "--chunk-mb", "64"});
+    const QByteArray chunked = analyze({"--threads", "4", "--chunk-mb", "1"});
+    QVERIFY(!whole.isEmpty());
+    QCOMPARE(chunked, whole);
+
+    const QJsonObject unknown =
+        QJsonDocument::fromJson(whole).object().value("unknown").toArray().first().toObject();
+    QCOMPARE(unknown.value("frames").toInt(), frames);
+    QCOMPARE(unknown.value("distinct_payloads").toInt(), frames - frames / 50 + 1);
+    const QJsonArray payloads = unknown.value("payloads").toArray();
+    QCOMPARE(payloads.size(), 16);
+    QCOMPARE(payloads.first().toObject().value("hex").toString(), QString("feedface"));
+    QCOMPARE(payloads.first().toObject().value("count").toInt(), frames / 50);
+    QCOMPARE(unknown.value("other_payload_frames").toInt(), frames - frames / 50 - 15);
+#endif
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <QObject>
+#include <QTest>
+
+class TestCapture : public QObject {
+    Q_OBJECT
+private slots:
+    void testRecorder();
+    void testResync();
+    void testAnalyzerChunking();
+};
@@ -0,0 +1,113 @@
+/**
+ * @file tst_configurer.cpp
+ * @brief Unit tests for the SubsystemConfigurer settings store.
+ */
+
+#include "tst_configurer.h"
+#include "mock_device.h"
+#include "dji/scheduler.h"
+#include "dji/subsystem_configurer.h"
+#include <QSignalSpy>
+#include <QtTest>
+
+using namespace dji;
+
+namespace {
+
+class SilentDevice : public MockDevice {
+public:
+    void sendMessage(const Message &msg, bool noResponse = true) override {
+        Q_UNUSED(noResponse);
+        emit messageSent(msg);
+    }
+};
+
+} // namespace
+
+void TestConfigurer::testRedundantWriteIsSkipped() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    SubsystemConfigurer *configurer = device.configurer();
+    QSignalSpy spySent(&device, &MockDevice::messageSent);
+    QSignalSpy spyCommitted(configurer, &SubsystemConfigurer::committed);
+
+    configurer->stageImageStabilization(ImageStabilization::RockSteady);
+    configurer->commit();
+    QVERIFY(configurer->isCommitting());
+    QVERIFY(clock.advanceUntil([&]() { return spyCommitted.count() == 1; }, 5000));
+    QVERIFY(spyCommitted.at(0).at(0).toBool());
+    QCOMPARE(spyCommitted.at(0).at(1).toInt(), 1);
+    QCOMPARE(configurer->value(SubsystemConfigurer::Setting::ImageStabilization),
+             QByteArray(1, static_cast<char>(ImageStabilization::RockSteady)));
+
+    // Re-applying the same preset is answered from the mirror.
+    configurer->stageImageStabilization(ImageStabilization::RockSteady);
+    configurer->commit();
+    QCOMPARE(spyCommitted.count(), 2);
+    QVERIFY(spyCommitted.at(1).at(0).toBool());
+    QCOMPARE(spyCommitted.at(1).at(1).toInt(), 0);
+    QCOMPARE(spyCommitted.at(1).at(2).toInt(), 1);
+    QCOMPARE(countSent(spySent, MessageType::Configure), 1);
+}
+
+void TestConfigurer::testCommitWhileBusyIsQueued() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    SubsystemConfigurer *configurer = device.configurer();
+    QSignalSpy spySent(&device, &MockDevice::messageSent);
+    QSignalSpy spyCommitted(configurer, &SubsystemConfigurer::committed);
+
+    configurer->stageImageStabilization(ImageStabilization::RockSteady);
+    configurer->commit();
+    configurer->stageImageStabilization(ImageStabilization::HorizonSteady);
+    configurer->commit();
+    QCOMPARE(countSent(spySent, MessageType::Configure), 1);
+
+    QVERIFY(clock.advanceUntil([&]() { return spyCommitted.count() == 2; }, 5000));
+    QCOMPARE(countSent(spySent, MessageType::Configure), 2);
+    QCOMPARE(configurer->value(SubsystemConfigurer::Setting::ImageStabilization),
+             QByteArray(1, static_cast<char>(ImageStabilization::HorizonSteady)));
+}
+
+void TestConfigurer::testMissingAckForgetsValue() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    SilentDevice device;
+    SubsystemConfigurer *configurer = device.configurer();
+    configurer->setAckTimeout(50);
+    QSignalSpy spyCommitted(configurer, &SubsystemConfigurer::committed);
+    QSignalSpy spyError(configurer, &SubsystemConfigurer::error);
+
+    configurer->setImageStabilization(ImageStabilization::RockSteady);
+    QVERIFY(clock.advanceUntil([&]() { return spyCommitted.count() == 1; }, 5000));
+    QVERIFY(!spyCommitted.at(0).at(0).toBool());
+    QCOMPARE(spyError.count(), 1);
+    QVERIFY(configurer->value(SubsystemConfigurer::Setting::ImageStabilization).isEmpty());
+}
+
+void TestConfigurer::testReconnectForgetsMirror() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    SubsystemConfigurer *configurer = device.configurer();
+    QSignalSpy spySent(&device, &MockDevice::messageSent);
+    QSignalSpy spyCommitted(configurer, &SubsystemConfigurer::committed);
+
+    configurer->setImageStabilization(ImageStabilization::RockSteady);
+    QVERIFY(clock.advanceUntil([&]() { return spyCommitted.count() == 1; }, 5000));
+    QVERIFY(!configurer->value(SubsystemConfigurer::Setting::ImageStabilization).isEmpty());
+
+    device.simulateLinkLoss();
+    QVERIFY(configurer->value(SubsystemConfigurer::Setting::ImageStabilization).isEmpty());
+
+    // The same preset is written again after reconnecting.
+    QSignalSpy spyConnected(&device, &Device::connected);
+    device.connectToDevice();
+    QVERIFY(clock.advanceUntil([&]() { return spyConnected.count() == 1; }, 5000));
+    configurer->setImageStabilization(ImageStabilization::RockSteady);
+    QVERIFY(clock.advanceUntil([&]() { return spyCommitted.count() == 2; }, 5000));
+    QCOMPARE(spyCommitted.at(1).at(1).toInt(), 1);
+    QCOMPARE(countSent(spySent, MessageType::Configure), 2);
+}
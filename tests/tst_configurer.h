@@ -0,0 +1,13 @@
+#pragma once
+
+#include <QObject>
+#include <QTest>
+
+class TestConfigurer : public QObject {
+    Q_OBJECT
+private slots:
+    void testRedundantWriteIsSkipped();
+    void testCommitWhileBusyIsQueued();
+    void testMissingAckForgetsValue();
+    void testReconnectForgetsMirror();
+};
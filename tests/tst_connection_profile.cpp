@@ -0,0 +1,74 @@
+/**
+ * @file tst_connection_profile.cpp
+ * @brief Unit tests for the BLE connection profiles picked by DeviceManager.
+ */
+
+#include "tst_connection_profile.h"
+#include "mock_device.h"
+#include "dji/device_flow.h"
+#include "dji/device_manager.h"
+#include "dji/scheduler.h"
+#include <QSignalSpy>
+#include <QtTest>
+
+using namespace dji;
+
+namespace {
+
+class FailingFlow : public DeviceFlow {
+public:
+    void start(Device *dev) override {
+        Timer::singleShot(0, this, [this, dev]() { emit finished(dev, false); });
+    }
+};
+
+} // namespace
+
+void TestConnectionProfile::testParameterSets() {
+    const auto fast = Device::parametersFor(ConnectionProfile::LowLatency);
+    const auto balanced = Device::parametersFor(ConnectionProfile::Balanced);
+    const auto slow = Device::parametersFor(ConnectionProfile::LowPower);
+
+    QVERIFY(fast.maximumInterval() < balanced.minimumInterval());
+    QVERIFY(balanced.maximumInterval() < slow.minimumInterval());
+    QVERIFY(slow.latency() > 0);
+
+    // The supervision timeout must outlast the skipped events (BT core spec).
+    for (const auto &p : {fast, balanced, slow}) {
+        QVERIFY(p.supervisionTimeout() > (1 + p.latency()) * p.maximumInterval() * 2);
+    }
+}
+
+void TestConnectionProfile::testProfileFollowsFlow() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    DeviceManager manager(&device);
+    manager.setLowPowerDelay(50);
+    QSignalSpy spyProfile(&device, &Device::connectionProfileChanged);
+    QSignalSpy spyFinished(&manager, &DeviceManager::finished);
+
+    const StreamingOptions opts = testStreamingOptions();
+    manager.connectToWiFiAndStartStreaming(&device, opts);
+
+    QCOMPARE(device.connectionProfile(), ConnectionProfile::LowLatency);
+    QVERIFY(clock.advanceUntil([&]() { return spyFinished.count() == 1; }, 5000));
+    QCOMPARE(device.connectionProfile(), ConnectionProfile::LowLatency);
+
+    QVERIFY(clock.advanceUntil(
+        [&]() { return device.connectionProfile() == ConnectionProfile::LowPower; }, 5000));
+    QCOMPARE(spyProfile.count(), 2);
+}
+
+void TestConnectionProfile::testFailedFlowRevertsToBalanced() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    DeviceManager manager(&device);
+    QSignalSpy spyFinished(&manager, &DeviceManager::finished);
+
+    manager.runFlow(&device, new FailingFlow);
+    QCOMPARE(device.connectionProfile(), ConnectionProfile::LowLatency);
+    QVERIFY(clock.advanceUntil([&]() { return spyFinished.count() == 1; }, 5000));
+    QCOMPARE(device.connectionProfile(), ConnectionProfile::Balanced);
+}
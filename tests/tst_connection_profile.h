@@ -0,0 +1,12 @@
+#pragma once
+
+#include <QObject>
+#include <QTest>
+
+class TestConnectionProfile : public QObject {
+    Q_OBJECT
+private slots:
+    void testParameterSets();
+    void testProfileFollowsFlow();
+    void testFailedFlowRevertsToBalanced();
+};
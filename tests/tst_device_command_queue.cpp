@@ -0,0 +1,128 @@
+/**
+ * @file tst_device_command_queue.cpp
+ * @brief Unit tests for the thread-safe DeviceManager command facade.
+ */
+
+#include "tst_device_command_queue.h"
+#include "mock_device.h"
+#include "dji/device_flow.h"
+#include "dji/mpsc_queue.h"
+#include "dji/scheduler.h"
+#include <QFuture>
+#include <QThread>
+#include <QtTest>
+#include <thread>
+#include <vector>
+
+using namespace dji;
+
+void TestDeviceCommandQueue::testMpscQueueMultipleProducers() {
+    constexpr int producers = 4;
+    constexpr int perProducer = 1000;
+
+    MpscQueue<int> queue;
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&queue, p]() {
+            for (int i = 0; i < perProducer; ++i) {
+                queue.push(p * perProducer + i);
+            }
+        });
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+
+    std::vector<int> last(producers, -1);
+    int count = 0;
+    int value = 0;
+    while (queue.pop(value)) {
+        const int producer = value / perProducer;
+        // Items from one producer keep their order.
+        QVERIFY(value % perProducer > last[producer]);
+        last[producer] = value % perProducer;
+        count++;
+    }
+    QCOMPARE(count, producers * perProducer);
+}
+
+void TestDeviceCommandQueue::testCommandFromForeignThread() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    DeviceManager manager(&device);
+    DeviceCommandQueue commands(&manager);
+
+    auto initial = commands.snapshot();
+    QVERIFY(initial);
+    QCOMPARE(initial->devices.size(), 1);
+    QVERIFY(!initial->devices.at(0).isStreaming);
+
+    const StreamingOptions opts = testStreamingOptions();
+
+    QFuture<bool> future;
+    std::thread client([&]() { future = commands.connectToWiFiAndStartStreaming(&device, opts); });
+    client.join();
+
+    // The running flow shows up before the manager reports any progress.
+    QVERIFY(clock.advanceUntil(
+        [&]() {
+            auto running = commands.snapshot();
+            const DeviceStateSnapshot *state = running->find(&device);
+            return state && state->hasActiveFlow;
+        },
+        5000));
+    QVERIFY(!future.isFinished());
+
+    QVERIFY(clock.advanceUntil([&]() { return future.isFinished(); }, 5000));
+    QVERIFY(future.result());
+
+    auto snapshot = commands.snapshot();
+    QVERIFY(snapshot->generation > initial->generation);
+    const DeviceStateSnapshot *state = snapshot->find(&device);
+    QVERIFY(state);
+    QVERIFY(state->isPaired);
+    QVERIFY(state->isWiFiConnected);
+    QVERIFY(state->isStreaming);
+    QVERIFY(!state->hasActiveFlow);
+
+    // The old snapshot is immutable.
+    QVERIFY(!initial->devices.at(0).isStreaming);
+}
+
+void TestDeviceCommandQueue::testFlowMadeOnOwnerThread() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    MockDevice stranger;
+    DeviceManager manager(&device);
+    DeviceCommandQueue commands(&manager);
+
+    const StreamingOptions opts = testStreamingOptions();
+
+    QThread *madeOn = nullptr;
+    bool madeForStranger = false;
+    QFuture<bool> known;
+    QFuture<bool> unknown;
+    std::thread client([&]() {
+        unknown = commands.runFlow(&stranger, [&]() -> DeviceFlow * {
+            madeForStranger = true;
+            return new StreamingStarter(opts);
+        });
+        known = commands.runFlow(&device, [&]() -> DeviceFlow * {
+            madeOn = QThread::currentThread();
+            return new StreamingStarter(opts);
+        });
+    });
+    client.join();
+
+    QVERIFY(clock.advanceUntil([&]() { return known.isFinished(); }, 5000));
+    QVERIFY(known.result());
+    QCOMPARE(madeOn, QThread::currentThread());
+
+    // Unknown devices are refused rather than adopted.
+    QVERIFY(unknown.isFinished());
+    QVERIFY(!unknown.result());
+    QVERIFY(!madeForStranger);
+    QVERIFY(!manager.devices().contains(&stranger));
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "dji/device_command_queue.h"
+#include <QObject>
+#include <QTest>
+
+class TestDeviceCommandQueue : public QObject {
+    Q_OBJECT
+private slots:
+    void testMpscQueueMultipleProducers();
+    void testCommandFromForeignThread();
+    void testFlowMadeOnOwnerThread();
+};
@@ -0,0 +1,68 @@
+/**
+ * @file tst_device_event_bus.cpp
+ * @brief Unit tests for the per-tick device event aggregation.
+ */
+
+#include "tst_device_event_bus.h"
+#include "dji/device.h"
+#include "dji/device_manager.h"
+#include "dji/scheduler.h"
+#include "dji/subsystem_streamer.h"
+#include <QSignalSpy>
+#include <QtTest>
+
+using namespace dji;
+
+void TestDeviceEventBus::testCoalescesStateEvents() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    Device device(QBluetoothDeviceInfo(), DeviceType::OsmoPocket3);
+    DeviceManager manager(&device);
+    DeviceEventBus bus(&manager);
+    bus.setTickRate(100);
+
+    QSignalSpy spy(&bus, &DeviceEventBus::batchReady);
+
+    Message status;
+    status.subsystem = SubsystemID::Status;
+    status.msgType = MessageType::StreamingStatus;
+    status.payload = QByteArray(21, 0);
+
+    emit device.streamer()->batteryPercentageChanged(90);
+    emit device.messageReceived(status);
+    emit device.streamer()->batteryPercentageChanged(80);
+    emit device.messageReceived(status);
+    emit device.streamer()->batteryPercentageChanged(70);
+
+    QVERIFY(clock.advanceUntil([&]() { return spy.count() == 1; }, 1000));
+    QCOMPARE(spy.count(), 1);
+
+    DeviceEventBatch batch = spy.at(0).at(0).value<DeviceEventBatch>();
+    QCOMPARE(batch.devices.size(), 1);
+    QCOMPARE(batch.devices.at(0).device, &device);
+    QCOMPARE(batch.devices.at(0).batteryPercentage, 70);
+    QCOMPARE(batch.devices.at(0).messagesReceived, 2);
+    QCOMPARE(batch.devices.at(0).lastMessage.msgType, MessageType::StreamingStatus);
+}
+
+void TestDeviceEventBus::testCapsLogsPerBatch() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    DeviceManager manager;
+    DeviceEventBus bus(&manager);
+    bus.setTickRate(100);
+    bus.setMaxLogsPerBatch(2);
+
+    QSignalSpy spy(&bus, &DeviceEventBus::batchReady);
+
+    for (int i = 0; i < 5; ++i) {
+        emit manager.log(QString("line %1").arg(i));
+    }
+
+    QVERIFY(clock.advanceUntil([&]() { return spy.count() == 1; }, 1000));
+    QCOMPARE(spy.count(), 1);
+
+    DeviceEventBatch batch = spy.at(0).at(0).value<DeviceEventBatch>();
+    QCOMPARE(batch.logs, QStringList({"line 0", "line 1"}));
+    QCOMPARE(batch.droppedLogs, 3);
+}
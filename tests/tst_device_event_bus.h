@@ -0,0 +1,12 @@
+#pragma once
+
+#include "dji/device_event_bus.h"
+#include <QObject>
+#include <QTest>
+
+class TestDeviceEventBus : public QObject {
+    Q_OBJECT
+private slots:
+    void testCoalescesStateEvents();
+    void testCapsLogsPerBatch();
+};
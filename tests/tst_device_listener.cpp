@@ -0,0 +1,121 @@
+/**
+ * @file tst_device_listener.cpp
+ * @brief Unit tests for the direct-call DeviceListener hooks.
+ */
+
+#include "tst_device_listener.h"
+#include "mock_device.h"
+#include "dji/device_listener.h"
+#include "dji/subsystem_streamer.h"
+#include <QStringList>
+#include <QtTest>
+
+using namespace dji;
+
+namespace {
+
+class RecordingListener : public DeviceListener {
+public:
+    explicit RecordingListener(QStringList *events, const QString &name = QString())
+        : m_events(events), m_name(name) {
+    }
+
+    void notificationReceived(Device *device, QByteArrayView data) override {
+        Q_UNUSED(device);
+        record(QString("notification %1").arg(data.size()));
+    }
+    void messageReceived(Device *device, const Message &msg) override {
+        Q_UNUSED(device);
+        record(QString("message 0x%1").arg(static_cast<uint32_t>(msg.msgType), 0, 16));
+        if (removeFrom) {
+            removeFrom->removeListener(this);
+        }
+    }
+    void messageSent(Device *device, const Message &msg) override {
+        Q_UNUSED(device);
+        record(QString("sent 0x%1").arg(static_cast<uint32_t>(msg.msgType), 0, 16));
+    }
+    void streamingStatusReceived(Device *device, QByteArrayView payload) override {
+        Q_UNUSED(device);
+        record(QString("status %1").arg(payload.size()));
+    }
+    void batteryPercentageChanged(Device *device, int percentage) override {
+        Q_UNUSED(device);
+        record(QString("battery %1").arg(percentage));
+    }
+
+    // Removes itself from this device on its first message.
+    Device *removeFrom = nullptr;
+
+private:
+    void record(const QString &event) {
+        m_events->append(m_name.isEmpty() ? event : m_name + " " + event);
+    }
+
+    QStringList *m_events;
+    QString m_name;
+};
+
+Message streamingStatus(int battery) {
+    Message msg;
+    msg.subsystem = SubsystemID::Status;
+    msg.msgType = MessageType::StreamingStatus;
+    msg.payload = QByteArray(21, 0);
+    msg.payload[20] = static_cast<char>(battery);
+    return msg;
+}
+
+} // namespace
+
+void TestDeviceListener::testEventsBeforeSignals() {
+    MockDevice device;
+    QStringList events;
+    RecordingListener listener(&events);
+    device.addListener(&listener);
+    device.addListener(&listener);
+    connect(&device, &Device::messageReceived, &device,
+            [&events](const Message &) { events.append("signal"); });
+
+    const QByteArray frame = streamingStatus(80).serialize();
+    device.simulateNotification(frame);
+    QCOMPARE(events, QStringList({QString("notification %1").arg(frame.size()), "message 0xd02",
+                                  "battery 80", "status 21", "signal"}));
+
+    device.removeListener(&listener);
+    events.clear();
+    device.simulateNotification(frame);
+    QCOMPARE(events, QStringList({"signal"}));
+}
+
+void TestDeviceListener::testSentMessages() {
+    MockDevice device;
+    QStringList events;
+    RecordingListener listener(&events);
+    device.addListener(&listener);
+
+    Message msg;
+    msg.subsystem = SubsystemID::Streamer;
+    msg.msgId = MessageID::ConfigureStreaming;
+    msg.msgType = MessageType::ConfigureStreaming;
+    device.sendMessage(msg);
+    QCOMPARE(events, QStringList({"sent 0x400878"}));
+}
+
+void TestDeviceListener::testRemoveWhileNotifying() {
+    MockDevice device;
+    QStringList events;
+    RecordingListener first(&events, "first");
+    RecordingListener second(&events, "second");
+    first.removeFrom = &device;
+    device.addListener(&first);
+    device.addListener(&second);
+
+    device.simulateIncomingMessage(streamingStatus(80));
+    QCOMPARE(events, QStringList({"first message 0xd02", "second message 0xd02",
+                                  "second battery 80", "second status 21"}));
+
+    events.clear();
+    device.simulateIncomingMessage(streamingStatus(79));
+    QCOMPARE(events, QStringList({"second message 0xd02", "second battery 79",
+                                  "second status 21"}));
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <QObject>
+#include <QTest>
+
+class TestDeviceListener : public QObject {
+    Q_OBJECT
+private slots:
+    void testEventsBeforeSignals();
+    void testSentMessages();
+    void testRemoveWhileNotifying();
+};
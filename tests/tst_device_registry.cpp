@@ -0,0 +1,131 @@
+/**
+ * @file tst_device_registry.cpp
+ * @brief Unit tests for the slot map behind DeviceManager's device registry.
+ */
+
+#include "tst_device_registry.h"
+#include "mock_device.h"
+#include "dji/device.h"
+#include "dji/slot_map.h"
+#include "dji/subsystem_pairer.h"
+#include <QSignalSpy>
+#include <QtTest>
+
+using namespace dji;
+
+void TestDeviceRegistry::testSlotMapHandles() {
+    SlotMap<int> map;
+    const SlotHandle a = map.insert(1);
+    const SlotHandle b = map.insert(2);
+    const SlotHandle c = map.insert(3);
+    QCOMPARE(map.size(), size_t(3));
+
+    QVERIFY(map.erase(a));
+    QVERIFY(!map.contains(a));
+    QVERIFY(map.get(a) == nullptr);
+    QVERIFY(!map.erase(a));
+
+    // The other handles still resolve, and the values keep their order.
+    QCOMPARE(*map.get(b), 2);
+    QCOMPARE(*map.get(c), 3);
+    QCOMPARE(map.at(0), 2);
+    QCOMPARE(map.at(1), 3);
+
+    // The freed slot is reused under a new generation.
+    const SlotHandle d = map.insert(4);
+    QCOMPARE(d.index, a.index);
+    QVERIFY(d != a);
+    QVERIFY(map.get(a) == nullptr);
+    QCOMPARE(*map.get(d), 4);
+    QCOMPARE(map.at(2), 4);
+
+    QVERIFY(map.get(SlotHandle()) == nullptr);
+}
+
+void TestDeviceRegistry::testTakeKeepsDeviceOrder() {
+    DeviceManager manager;
+    QList<Device *> added;
+    for (int i = 0; i < 4; ++i) {
+        auto *dev = new MockDevice(&manager);
+        manager.addDevice(dev);
+        added.append(dev);
+    }
+
+    Device *first = added.takeFirst();
+    QVERIFY(manager.takeDevice(first));
+    QCOMPARE(manager.devices(), added);
+    QCOMPARE(manager.device(), added.first());
+
+    Device *middle = added.takeAt(1);
+    QVERIFY(manager.takeDevice(middle));
+    QCOMPARE(manager.devices(), added);
+    delete first;
+    delete middle;
+}
+
+void TestDeviceRegistry::testTakenDeviceHandleGoesStale() {
+    DeviceManager manager;
+    auto *dev = new MockDevice(&manager);
+    manager.addDevice(dev);
+
+    const DeviceHandle handle = manager.handleOf(dev);
+    QVERIFY(!handle.isNull());
+    QCOMPARE(manager.deviceFor(handle), dev);
+
+    QVERIFY(manager.takeDevice(dev));
+    QVERIFY(manager.deviceFor(handle) == nullptr);
+    QVERIFY(manager.handleOf(dev).isNull());
+    QVERIFY(!manager.isPaired(handle));
+
+    // Signals from a taken device no longer reach the manager.
+    QSignalSpy spyPaired(&manager, &DeviceManager::isPairedChanged);
+    emit dev->pairer()->pairingComplete();
+    QCOMPARE(spyPaired.count(), 0);
+    delete dev;
+}
+
+void TestDeviceRegistry::testDestroyedDeviceIsForgotten() {
+    DeviceManager manager;
+    auto *dev = new MockDevice(&manager);
+    auto *other = new MockDevice(&manager);
+    manager.addDevice(dev);
+    manager.addDevice(other);
+    const DeviceHandle handle = manager.handleOf(dev);
+
+    QSignalSpy spyDevices(&manager, &DeviceManager::devicesChanged);
+    delete dev;
+
+    QCOMPARE(spyDevices.count(), 1);
+    QVERIFY(manager.deviceFor(handle) == nullptr);
+    QCOMPARE(manager.devices(), QList<Device *>{other});
+    QCOMPARE(manager.deviceFor(manager.handleOf(other)), other);
+}
+
+void TestDeviceRegistry::testChurnReusesSlots() {
+    SlotMap<int> map;
+    for (int round = 0; round < 100; ++round) {
+        QList<SlotHandle> handles;
+        for (int i = 0; i < 8; ++i) {
+            handles.append(map.insert(i));
+        }
+        for (const SlotHandle &handle : std::as_const(handles)) {
+            QVERIFY(map.erase(handle));
+        }
+    }
+    QVERIFY(map.isEmpty());
+    QCOMPARE(map.slotCapacity(), size_t(8));
+
+    DeviceManager manager;
+    for (int round = 0; round < 100; ++round) {
+        QList<Device *> devices;
+        for (int i = 0; i < 8; ++i) {
+            auto *dev = new MockDevice(&manager);
+            manager.addDevice(dev);
+            devices.append(dev);
+        }
+        QCOMPARE(manager.deviceCount(), 8);
+        qDeleteAll(devices);
+        QCOMPARE(manager.deviceCount(), 0);
+    }
+    QVERIFY(manager.devices().isEmpty());
+}
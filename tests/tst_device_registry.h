@@ -0,0 +1,15 @@
+#pragma once
+
+#include "dji/device_manager.h"
+#include <QObject>
+#include <QTest>
+
+class TestDeviceRegistry : public QObject {
+    Q_OBJECT
+private slots:
+    void testSlotMapHandles();
+    void testTakeKeepsDeviceOrder();
+    void testTakenDeviceHandleGoesStale();
+    void testDestroyedDeviceIsForgotten();
+    void testChurnReusesSlots();
+};
@@ -0,0 +1,226 @@
+/**
+ * @file tst_fleet.cpp
+ * @brief Unit tests for fleet commands and the synchronized start.
+ */
+
+#include "tst_fleet.h"
+#include "mock_device.h"
+#include "dji/adaptive_bitrate.h"
+#include "dji/device_manager.h"
+#include "dji/fleet_operation.h"
+#include "dji/scheduler.h"
+#include "dji/subsystem_configurer.h"
+#include "dji/subsystem_streamer.h"
+#include <QSignalSpy>
+#include <QtTest>
+#include <memory>
+
+using namespace dji;
+
+namespace {
+
+// Runs the operation to completion; false if it never finished.
+bool waitFor(VirtualScheduler &clock, FleetOperation *operation, FleetResult *result,
+             int timeoutMs = 10000) {
+    auto done = std::make_shared<bool>(false);
+    QObject::connect(operation, &FleetOperation::finished, [result, done](const FleetResult &r) {
+        *result = r;
+        *done = true;
+    });
+    return clock.advanceUntil([done]() { return *done; }, timeoutMs);
+}
+
+int countStarts(const QSignalSpy &spy) {
+    int count = 0;
+    for (int i = 0; i < spy.count(); ++i) {
+        const Message msg = spy.at(i).at(0).value<Message>();
+        if (msg.msgType == MessageType::StartStopStreaming && msg.payload.size() >= 1 &&
+            static_cast<unsigned char>(msg.payload.back()) == 0x01)
+            ++count;
+    }
+    return count;
+}
+
+} // namespace
+
+void TestFleet::testSynchronizedStart() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice a, b, c;
+    DeviceManager manager;
+    manager.addDevice(&a);
+    manager.addDevice(&b);
+    manager.addDevice(&c);
+    QSignalSpy spySentA(&a, &MockDevice::messageSent);
+
+    FleetResult result;
+    QVERIFY(waitFor(clock, manager.startFleet({&a, &b, &c}, testStreamingOptions()), &result));
+    QVERIFY(result.success());
+    QCOMPARE(result.succeeded(), 3);
+    QCOMPARE(result.devices.size(), 3);
+    QVERIFY(a.isStreaming() && b.isStreaming() && c.isStreaming());
+    QVERIFY(manager.isStreaming(&a) && manager.isStreaming(&b) && manager.isStreaming(&c));
+    QCOMPARE(countStarts(spySentA), 1);
+
+    // The start frames leave back to back; only the acks carry the mock delay.
+    QVERIFY(result.startSkewUs >= 0);
+    QVERIFY(result.startSkewUs < 50000);
+    QVERIFY(result.ackSkewMs >= 0);
+    for (const FleetDeviceResult &r : result.devices) {
+        QVERIFY(r.startOffsetUs >= 0);
+        QVERIFY(r.ackLatencyMs >= 0);
+        QVERIFY(r.error.isEmpty());
+    }
+
+    // Starting again leaves the running streams alone.
+    FleetResult again;
+    QVERIFY(waitFor(clock, manager.startFleet({&a, &b, &c}, testStreamingOptions()), &again));
+    QVERIFY(again.success());
+    QCOMPARE(again.startSkewUs, qint64(-1));
+    QCOMPARE(countStarts(spySentA), 1);
+}
+
+void TestFleet::testPartialFailure() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice a, b, c;
+    b.setRejectedSsids({"test-ssid"});
+    DeviceManager manager;
+    manager.addDevice(&a);
+    manager.addDevice(&b);
+    manager.addDevice(&c);
+
+    FleetResult result;
+    QVERIFY(waitFor(clock, manager.startFleet({&a, &b, &c}, testStreamingOptions()), &result));
+    QVERIFY(!result.success());
+    QCOMPARE(result.succeeded(), 2);
+    QVERIFY(result.find(&a)->success);
+    QVERIFY(!result.find(&b)->success);
+    QVERIFY(!result.find(&b)->error.isEmpty());
+    QCOMPARE(result.find(&b)->startOffsetUs, qint64(-1));
+    QVERIFY(result.find(&c)->success);
+    QVERIFY(a.isStreaming() && c.isStreaming());
+    QVERIFY(!b.isStreaming());
+    QVERIFY(result.startSkewUs >= 0);
+}
+
+void TestFleet::testStopAndStabilization() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice a, b;
+    DeviceManager manager;
+    manager.addDevice(&a);
+    manager.addDevice(&b);
+    FleetResult started;
+    QVERIFY(waitFor(clock, manager.startFleet({&a, &b}, testStreamingOptions()), &started));
+    QVERIFY(started.success());
+
+    FleetResult stabilized;
+    QVERIFY(waitFor(clock,
+        manager.setFleetImageStabilization({&a, &b}, ImageStabilization::RockSteady), &stabilized));
+    QVERIFY(stabilized.success());
+    QCOMPARE(a.configurer()->value(SubsystemConfigurer::Setting::ImageStabilization),
+             QByteArray(1, static_cast<char>(ImageStabilization::RockSteady)));
+
+    StreamSettings settings;
+    settings.resolution = Resolution::Res720p;
+    settings.bitrateKbps = 2500;
+    FleetResult reconfigured;
+    QVERIFY(waitFor(clock, manager.reconfigureFleet({&a, &b}, settings), &reconfigured));
+    QVERIFY(reconfigured.success());
+    QCOMPARE(a.bitrateKbps(), 2500);
+    QCOMPARE(b.bitrateKbps(), 2500);
+
+    FleetResult stopped;
+    QVERIFY(waitFor(clock, manager.stopFleet({&a, &b}), &stopped));
+    QVERIFY(stopped.success());
+    QVERIFY(!a.isStreaming() && !b.isStreaming());
+    QVERIFY(!manager.isStreaming(&a) && !manager.isStreaming(&b));
+
+    // Nothing to reconfigure once stopped; an empty set finishes at once.
+    FleetResult idle;
+    QVERIFY(waitFor(clock, manager.reconfigureFleet({&a}, settings), &idle));
+    QVERIFY(!idle.success());
+    QCOMPARE(idle.find(&a)->error, QString("Not streaming"));
+    FleetResult empty;
+    QVERIFY(waitFor(clock, manager.stopFleet({}), &empty));
+    QVERIFY(empty.devices.isEmpty());
+}
+
+void TestFleet::testStabilizationWaitsForOwnCommit() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice a;
+    DeviceManager manager;
+    manager.addDevice(&a);
+    SubsystemConfigurer *configurer = a.configurer();
+    QSignalSpy spyCommitted(configurer, &SubsystemConfigurer::committed);
+
+    // An unrelated commit is still waiting for its acknowledgement.
+    configurer->stageImageStabilization(ImageStabilization::RockSteady);
+    configurer->commit();
+    QVERIFY(configurer->isCommitting());
+
+    FleetOperation *operation =
+        manager.setFleetImageStabilization({&a}, ImageStabilization::HorizonSteady);
+    QSignalSpy spyFinished(operation, &FleetOperation::finished);
+    QVERIFY(clock.advanceUntil([&]() { return spyCommitted.count() == 1; }, 5000));
+    QCOMPARE(spyFinished.count(), 0);
+
+    FleetResult result;
+    QVERIFY(waitFor(clock, operation, &result));
+    QVERIFY(result.success());
+    QCOMPARE(spyCommitted.count(), 2);
+    QCOMPARE(configurer->value(SubsystemConfigurer::Setting::ImageStabilization),
+             QByteArray(1, static_cast<char>(ImageStabilization::HorizonSteady)));
+}
+
+void TestFleet::testUnacknowledgedConfiguration() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice a, b;
+    b.setAnswersConfigureStreaming(false);
+    DeviceManager manager;
+    manager.addDevice(&a);
+    manager.addDevice(&b);
+
+    // b never confirms its configuration; it is started once the round times
+    // out, and its start acknowledgement decides.
+    FleetOptions fleetOptions;
+    fleetOptions.ackTimeoutMs = 300;
+    FleetResult result;
+    QVERIFY(waitFor(clock, manager.startFleet({&a, &b}, testStreamingOptions(), fleetOptions), &result));
+    QVERIFY(result.success());
+    QVERIFY(a.isStreaming() && b.isStreaming());
+    QCOMPARE(b.rtmpUrl(), QString("rtmp://test/live"));
+    QVERIFY(result.find(&b)->ackLatencyMs >= 0);
+}
+
+void TestFleet::testForeignStreamerErrors() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice a, b;
+    DeviceManager manager;
+    manager.addDevice(&a);
+    manager.addDevice(&b);
+    FleetResult started;
+    QVERIFY(waitFor(clock, manager.startFleet({&a, &b}, testStreamingOptions()), &started));
+    QVERIFY(started.success());
+
+    // Errors of other streamer requests while a fleet command is pending are
+    // not its failures.
+    StreamSettings settings;
+    settings.bitrateKbps = 3000;
+    FleetOperation *reconfigure = manager.reconfigureFleet({&a, &b}, settings);
+    emit a.streamer()->error("[DJI-BLE] Unrelated failure");
+    FleetResult reconfigured;
+    QVERIFY(waitFor(clock, reconfigure, &reconfigured));
+    QVERIFY(reconfigured.success());
+
+    FleetOperation *stop = manager.stopFleet({&a, &b});
+    emit a.streamer()->error("[DJI-BLE] Unrelated failure");
+    FleetResult stopped;
+    QVERIFY(waitFor(clock, stop, &stopped));
+    QVERIFY(stopped.success());
+    QVERIFY(!a.isStreaming() && !b.isStreaming());
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QObject>
+#include <QTest>
+
+class TestFleet : public QObject {
+    Q_OBJECT
+private slots:
+    void testSynchronizedStart();
+    void testPartialFailure();
+    void testStopAndStabilization();
+    void testStabilizationWaitsForOwnCommit();
+    void testUnacknowledgedConfiguration();
+    void testForeignStreamerErrors();
+};
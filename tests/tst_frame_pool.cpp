@@ -0,0 +1,100 @@
+/**
+ * @file tst_frame_pool.cpp
+ * @brief Unit tests for the recycled messages of received frames.
+ */
+
+#include "tst_frame_pool.h"
+#include "mock_device.h"
+#include "dji/frame_pool.h"
+#include <QMutex>
+#include <QThread>
+#include <QtTest>
+
+using namespace dji;
+
+namespace {
+
+QByteArray streamingStatusFrame(int battery) {
+    Message msg;
+    msg.subsystem = SubsystemID::Status;
+    msg.msgType = MessageType::StreamingStatus;
+    msg.payload = QByteArray(21, 0);
+    msg.payload[20] = static_cast<char>(battery);
+    return msg.serialize();
+}
+
+int batteryOf(const Message &msg) {
+    return static_cast<uint8_t>(msg.payload.at(20));
+}
+
+} // namespace
+
+void TestFramePool::testRecycling() {
+    FramePool pool(2);
+    QCOMPARE(pool.size(), 2);
+    QCOMPARE(pool.available(), 2);
+
+    Message *first = pool.acquire();
+    QVERIFY(Message::parseInto(streamingStatusFrame(80), first));
+    const Message kept = *first;
+    QCOMPARE(pool.available(), 1);
+
+    // A message a reader holds is not handed out again while others are free.
+    Message *second = pool.acquire();
+    QVERIFY(second != first);
+    QVERIFY(Message::parseInto(streamingStatusFrame(79), second));
+    Message keptToo = *second;
+    QCOMPARE(pool.available(), 0);
+    QCOMPARE(pool.misses(), quint64(0));
+
+    // All held: the next one is reused, and its readers keep their frame.
+    Message *third = pool.acquire();
+    QCOMPARE(pool.misses(), quint64(1));
+    QVERIFY(Message::parseInto(streamingStatusFrame(78), third));
+    QCOMPARE(batteryOf(*third), 78);
+    QCOMPARE(batteryOf(kept), 80);
+    QCOMPARE(batteryOf(keptToo), 79);
+    const Message keptThird = *third;
+    QCOMPARE(pool.available(), 0);
+
+    // Dropping the last copy frees the message again.
+    keptToo = Message();
+    QCOMPARE(pool.available(), 1);
+    QCOMPARE(pool.acquire(), second);
+}
+
+void TestFramePool::testSharedAcrossThreads() {
+    MockDevice device;
+    QThread thread;
+    QObject receiver;
+    receiver.moveToThread(&thread);
+    thread.start();
+
+    QMutex mutex;
+    QList<Message> received;
+    connect(&device, &Device::messageReceived, &receiver, [&mutex, &received](const Message &msg) {
+        QMutexLocker locker(&mutex);
+        received.append(msg);
+    });
+    auto receivedCount = [&mutex, &received]() {
+        QMutexLocker locker(&mutex);
+        return received.size();
+    };
+
+    // More frames than the pool holds, all kept by the other thread.
+    const int frames = 3 * FramePool::defaultSize;
+    for (int i = 0; i < frames; ++i) {
+        device.simulateNotification(streamingStatusFrame(100 - i));
+    }
+    QTRY_COMPARE(receivedCount(), frames);
+
+    thread.quit();
+    thread.wait();
+    for (int i = 0; i < frames; ++i) {
+        QCOMPARE(batteryOf(received.at(i)), 100 - i);
+    }
+    QCOMPARE(device.framePool().available(), 0);
+
+    received.clear();
+    QCOMPARE(device.framePool().available(), FramePool::defaultSize);
+}
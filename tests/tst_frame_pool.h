@@ -0,0 +1,11 @@
+#pragma once
+
+#include <QObject>
+#include <QTest>
+
+class TestFramePool : public QObject {
+    Q_OBJECT
+private slots:
+    void testRecycling();
+    void testSharedAcrossThreads();
+};
@@ -0,0 +1,114 @@
+/**
+ * @file tst_link_health.cpp
+ * @brief Unit tests for LinkHealthMonitor and its DeviceManager hooks.
+ */
+
+#include "tst_link_health.h"
+#include "mock_device.h"
+#include "dji/device_manager.h"
+#include "dji/link_health_monitor.h"
+#include "dji/scheduler.h"
+#include <QSignalSpy>
+#include <QtTest>
+
+using namespace dji;
+
+namespace {
+
+LinkHealthOptions fastOptions() {
+    LinkHealthOptions options;
+    options.evaluationIntervalMs = 20;
+    options.rssiIntervalMs = 0;
+    options.minCadenceMs = 50;
+    return options;
+}
+
+} // namespace
+
+void TestLinkHealth::testSilenceDegradesLink() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    DeviceManager manager(&device);
+    LinkHealthMonitor *health = device.linkHealth();
+    health->setOptions(fastOptions());
+    health->start();
+    QSignalSpy spyDegraded(&manager, &DeviceManager::linkDegraded);
+    QSignalSpy spyRecovered(&manager, &DeviceManager::linkRecovered);
+
+    Message keepAlive;
+    keepAlive.subsystem = SubsystemID::Status;
+    keepAlive.msgType = MessageType::MaybeKeepAlive;
+    Timer heartbeat;
+    heartbeat.setInterval(50);
+    connect(&heartbeat, &Timer::timeout, &device,
+            [&device, &keepAlive]() { device.simulateIncomingMessage(keepAlive); });
+    heartbeat.start();
+
+    clock.advance(300);
+    QVERIFY(health->cadenceMs() > 0);
+    QCOMPARE(spyDegraded.count(), 0);
+
+    // The camera goes quiet long before any supervision timeout would fire.
+    heartbeat.stop();
+    QVERIFY(clock.advanceUntil([&]() { return spyDegraded.count() == 1; }, 2000));
+    QVERIFY(health->isDegraded());
+    QVERIFY(spyDegraded.first().at(2).toString().contains("silent"));
+
+    heartbeat.start();
+    QVERIFY(clock.advanceUntil([&]() { return spyRecovered.count() == 1; }, 2000));
+    QVERIFY(!health->isDegraded());
+    QCOMPARE(spyDegraded.count(), 1);
+}
+
+void TestLinkHealth::testRoundTripTime() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    LinkHealthMonitor *health = device.linkHealth();
+    health->setOptions(fastOptions());
+    health->start();
+    QCOMPARE(health->rttMs(), -1);
+
+    QSignalSpy spyReceived(&device, &Device::messageReceived);
+    Message request;
+    request.subsystem = SubsystemID::Configurer;
+    request.msgId = static_cast<MessageID>(0x1234);
+    request.msgType = MessageType::Configure;
+    request.payload = QByteArray::fromHex("0100");
+    device.sendMessage(request, false);
+
+    QVERIFY(clock.advanceUntil([&]() { return spyReceived.count() > 0; }, 2000));
+    QVERIFY(health->rttMs() >= 0);
+    QVERIFY(health->rttMs() < 1000);
+}
+
+void TestLinkHealth::testRssiHysteresis() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    LinkHealthMonitor *health = device.linkHealth();
+    LinkHealthOptions options = fastOptions();
+    options.rssiIntervalMs = 20;
+    health->setOptions(options);
+    QSignalSpy spyDegraded(health, &LinkHealthMonitor::degraded);
+    QSignalSpy spyRecovered(health, &LinkHealthMonitor::recovered);
+
+    device.setRssi(-90);
+    health->start();
+    QVERIFY(clock.advanceUntil([&]() { return spyDegraded.count() == 1; }, 2000));
+    QCOMPARE(health->rssi(), -90);
+    QVERIFY(spyDegraded.first().at(1).toString().contains("RSSI"));
+
+    // Between the two thresholds: still degraded.
+    device.setRssi(-80);
+    clock.advance(200);
+    QCOMPARE(health->rssi(), -80);
+    QVERIFY(health->isDegraded());
+    QCOMPARE(spyRecovered.count(), 0);
+
+    device.setRssi(-60);
+    QVERIFY(clock.advanceUntil([&]() { return spyRecovered.count() == 1; }, 2000));
+    QCOMPARE(health->score(), 100);
+    QCOMPARE(spyDegraded.count(), 1);
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <QObject>
+#include <QTest>
+
+class TestLinkHealth : public QObject {
+    Q_OBJECT
+private slots:
+    void testSilenceDegradesLink();
+    void testRoundTripTime();
+    void testRssiHysteresis();
+};
@@ -6,9 +6,31 @@
 #include <QCoreApplication>
 #include <QTest>
 
+#include "tst_adaptive_bitrate.h"
+#include "tst_allocations.h"
+#include "tst_battery_policy.h"
+#include "tst_capture.h"
+#include "tst_configurer.h"
 #include "tst_connect_flow.h"
+#include "tst_connection_profile.h"
 #include "tst_crc.h"
+#include "tst_device_command_queue.h"
+#include "tst_device_event_bus.h"
+#include "tst_device_listener.h"
+#include "tst_device_registry.h"
+#include "tst_fleet.h"
+#include "tst_frame_pool.h"
+#include "tst_link_health.h"
 #include "tst_message.h"
+#include "tst_protocol.h"
+#include "tst_protocol_worker.h"
+#include "tst_reconnect.h"
+#include "tst_sharded_device_manager.h"
+#include "tst_stream_failover.h"
+#include "tst_streaming_plan.h"
+#include "tst_unknown_message_profiler.h"
+#include "tst_virtual_time.h"
+#include "tst_wifi_scan.h"
 
 int main(int argc, char *argv[]) {
     QCoreApplication app(argc, argv);
@@ -29,5 +51,115 @@ int main(int argc, char *argv[]) {
         status |= QTest::qExec(&tcf, argc, argv);
     }
 
+    {
+        TestConnectionProfile tcp;
+        status |= QTest::qExec(&tcp, argc, argv);
+    }
+
+    {
+        TestDeviceEventBus teb;
+        status |= QTest::qExec(&teb, argc, argv);
+    }
+
+    {
+        TestProtocolWorker tpw;
+        status |= QTest::qExec(&tpw, argc, argv);
+    }
+
+    {
+        TestShardedDeviceManager tsm;
+        status |= QTest::qExec(&tsm, argc, argv);
+    }
+
+    {
+        TestDeviceCommandQueue tcq;
+        status |= QTest::qExec(&tcq, argc, argv);
+    }
+
+    {
+        TestDeviceRegistry tdr;
+        status |= QTest::qExec(&tdr, argc, argv);
+    }
+
+    {
+        TestReconnect trc;
+        status |= QTest::qExec(&trc, argc, argv);
+    }
+
+    {
+        TestStreamingPlan tsp;
+        status |= QTest::qExec(&tsp, argc, argv);
+    }
+
+    {
+        TestConfigurer tcf;
+        status |= QTest::qExec(&tcf, argc, argv);
+    }
+
+    {
+        TestLinkHealth tlh;
+        status |= QTest::qExec(&tlh, argc, argv);
+    }
+
+    {
+        TestWiFiScan tws;
+        status |= QTest::qExec(&tws, argc, argv);
+    }
+
+    {
+        TestStreamFailover tsf;
+        status |= QTest::qExec(&tsf, argc, argv);
+    }
+
+    {
+        TestAdaptiveBitrate tab;
+        status |= QTest::qExec(&tab, argc, argv);
+    }
+
+    {
+        TestBatteryPolicy tbp;
+        status |= QTest::qExec(&tbp, argc, argv);
+    }
+
+    {
+        TestFleet tfl;
+        status |= QTest::qExec(&tfl, argc, argv);
+    }
+
+    {
+        TestVirtualTime tvt;
+        status |= QTest::qExec(&tvt, argc, argv);
+    }
+
+    {
+        TestAllocations tal;
+        status |= QTest::qExec(&tal, argc, argv);
+    }
+
+    {
+        TestFramePool tfp;
+        status |= QTest::qExec(&tfp, argc, argv);
+    }
+
+    {
+        TestDeviceListener tdl;
+        status |= QTest::qExec(&tdl, argc, argv);
+    }
+
+    {
+        TestProtocol tpr;
+        status |= QTest::qExec(&tpr, argc, argv);
+    }
+
+    {
+        TestCapture tca;
+        status |= QTest::qExec(&tca, argc, argv);
+    }
+
+    {
+        TestUnknownMessageProfiler tum;
+        status |= QTest::qExec(&tum, argc, argv);
+    }
+
     return status;
 }
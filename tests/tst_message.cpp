@@ -1,4 +1,7 @@
 #include "tst_message.h"
+#include "mock_device.h"
+#include "dji/subsystem_streamer.h"
+#include <QSignalSpy>
 #include <QDebug>
 #include <QtEndian>
 #include <QtTest>
@@ -80,3 +83,86 @@ void TestMessage::testPackURL() {
     QCOMPARE(len, s.size());
     QCOMPARE(packed.mid(2), s.toUtf8());
 }
+
+void TestMessage::testLongFrameRoundTrip() {
+    Message original;
+    original.subsystem = SubsystemID::Streamer;
+    original.msgId = MessageID::ConfigureStreaming;
+    original.msgType = MessageType::ConfigureStreaming;
+    original.payload = QByteArray(600, 'x');
+
+    bool ok = false;
+    QByteArray frame = original.serialize(&ok);
+    QVERIFY(ok);
+    QCOMPARE(frame.size(), 600 + Message::overhead);
+    QCOMPARE(Message::frameLength(frame), frame.size());
+    QCOMPARE(static_cast<uint8_t>(frame[2]) >> 2, 1);
+
+    Message parsed = Message::parse(frame, &ok);
+    QVERIFY(ok);
+    QCOMPARE(parsed.payload, original.payload);
+
+    original.payload = QByteArray(Message::maxPayloadSize, 'x');
+    frame = original.serialize(&ok);
+    QVERIFY(ok);
+    QCOMPARE(frame.size(), Message::maxFrameSize);
+}
+
+void TestMessage::testOversizeInputRejected() {
+    Message msg;
+    msg.payload = QByteArray(Message::maxPayloadSize + 1, 'x');
+    bool ok = true;
+    QVERIFY(msg.serialize(&ok).isEmpty());
+    QVERIFY(!ok);
+
+    ok = true;
+    QVERIFY(packString(QString(256, 'a'), &ok).isEmpty());
+    QVERIFY(!ok);
+
+    // A signed URL that no longer fits a configure frame is refused, not truncated.
+    MockDevice device;
+    QSignalSpy spySent(&device, &MockDevice::messageSent);
+    QSignalSpy spyError(&device, &Device::errorOccurred);
+    device.streamer()->startLiveStream(Resolution::Res1080p, 4000, FPS::FPS30,
+                                       "rtmp://test/live?token=" + QString(1000, 't'));
+    QCOMPARE(spySent.count(), 0);
+    QCOMPARE(spyError.count(), 1);
+}
+
+void TestMessage::testSplitForMtu() {
+    const QByteArray frame(100, 'x');
+
+    QList<QByteArray> chunks = Device::splitForMtu(frame, Device::defaultMtu);
+    QCOMPARE(chunks.size(), 5);
+    QCOMPARE(chunks.first().size(), 20);
+    QByteArray joined;
+    for (const QByteArray &chunk : std::as_const(chunks)) {
+        joined.append(chunk);
+    }
+    QCOMPARE(joined, frame);
+
+    chunks = Device::splitForMtu(frame, 247);
+    QCOMPARE(chunks.size(), 1);
+}
+
+void TestMessage::testNotificationReassembly() {
+    Message msg;
+    msg.subsystem = SubsystemID::Status;
+    msg.msgType = MessageType::StreamingStatus;
+    msg.payload = QByteArray(300, 'p');
+    const QByteArray frame = msg.serialize();
+
+    MockDevice device;
+    QSignalSpy spyReceived(&device, &Device::messageReceived);
+
+    // Garbage, then one frame split over notifications, then two frames in one.
+    device.simulateNotification(QByteArray::fromHex("0102"));
+    for (const QByteArray &chunk : Device::splitForMtu(frame, Device::defaultMtu)) {
+        device.simulateNotification(chunk);
+    }
+    QCOMPARE(spyReceived.count(), 1);
+    QCOMPARE(spyReceived.at(0).at(0).value<Message>().payload, msg.payload);
+
+    device.simulateNotification(frame + frame);
+    QCOMPARE(spyReceived.count(), 3);
+}
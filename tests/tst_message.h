@@ -11,4 +11,8 @@ private slots:
     void testParse();
     void testPackString();
     void testPackURL();
+    void testLongFrameRoundTrip();
+    void testOversizeInputRejected();
+    void testSplitForMtu();
+    void testNotificationReassembly();
 };
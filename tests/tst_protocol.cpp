@@ -0,0 +1,107 @@
+/**
+ * @file tst_protocol.cpp
+ * @brief Unit tests for the Qt-free frame codec.
+ */
+
+#include "tst_protocol.h"
+#include "dji/message.h"
+#include "dji/protocol.h"
+#include <QtTest>
+#include <cstring>
+#include <vector>
+
+using namespace dji;
+
+namespace {
+
+std::vector<uint8_t> serialize(const std::vector<uint8_t> &payload) {
+    std::vector<uint8_t> frame(protocol::frameSize(payload.size()));
+    const size_t length = protocol::serializeFrame(
+        SubsystemID::Streamer, MessageID::ConfigureStreaming, MessageType::ConfigureStreaming,
+        payload.data(), payload.size(), frame.data(), frame.size());
+    frame.resize(length);
+    return frame;
+}
+
+} // namespace
+
+void TestProtocol::testMatchesMessage() {
+    const std::vector<uint8_t> payload = {0x00, 0x2A, 0x00, 0x0A, 0xA0, 0x0F};
+    const std::vector<uint8_t> frame = serialize(payload);
+    QCOMPARE(frame.size(), protocol::overhead + payload.size());
+
+    Message msg;
+    msg.subsystem = SubsystemID::Streamer;
+    msg.msgId = MessageID::ConfigureStreaming;
+    msg.msgType = MessageType::ConfigureStreaming;
+    msg.payload = QByteArray(reinterpret_cast<const char *>(payload.data()), payload.size());
+    const QByteArray expected = msg.serialize();
+    QCOMPARE(QByteArray(reinterpret_cast<const char *>(frame.data()), frame.size()), expected);
+
+    protocol::FrameView view;
+    QCOMPARE(protocol::frameLength(frame.data(), frame.size()), static_cast<int>(frame.size()));
+    QCOMPARE(protocol::parseFrame(frame.data(), frame.size(), &view), protocol::ParseResult::Ok);
+    QCOMPARE(view.subsystem, SubsystemID::Streamer);
+    QCOMPARE(view.msgId, MessageID::ConfigureStreaming);
+    QCOMPARE(view.msgType, MessageType::ConfigureStreaming);
+    QCOMPARE(view.payloadSize, payload.size());
+    QCOMPARE(view.payload, frame.data() + protocol::headerSize);
+    QVERIFY(std::equal(payload.begin(), payload.end(), view.payload));
+}
+
+void TestProtocol::testParseErrors() {
+    const std::vector<uint8_t> frame = serialize({0x01, 0x02, 0x03});
+    protocol::FrameView view;
+
+    QCOMPARE(protocol::parseFrame(frame.data(), 12, &view), protocol::ParseResult::TooShort);
+    QCOMPARE(protocol::parseFrame(frame.data(), frame.size() - 1, &view),
+             protocol::ParseResult::Incomplete);
+    QCOMPARE(protocol::frameLength(frame.data(), 3), -1);
+
+    std::vector<uint8_t> bad = frame;
+    bad[0] = 0x54;
+    QCOMPARE(protocol::parseFrame(bad.data(), bad.size(), &view), protocol::ParseResult::BadMagic);
+    bad = frame;
+    bad[3] ^= 0x01;
+    QCOMPARE(protocol::parseFrame(bad.data(), bad.size(), &view),
+             protocol::ParseResult::BadHeaderCrc);
+    QCOMPARE(protocol::frameLength(bad.data(), bad.size()), -1);
+    bad = frame;
+    bad[protocol::headerSize] ^= 0x01;
+    QCOMPARE(protocol::parseFrame(bad.data(), bad.size(), &view), protocol::ParseResult::BadCrc);
+
+    // Trailing bytes after the frame are not part of it.
+    std::vector<uint8_t> longer = frame;
+    longer.push_back(0x55);
+    QCOMPARE(protocol::parseFrame(longer.data(), longer.size(), &view), protocol::ParseResult::Ok);
+    QCOMPARE(view.payloadSize, size_t(3));
+    QVERIFY(std::strstr(protocol::toString(protocol::ParseResult::BadCrc), "CRC"));
+}
+
+void TestProtocol::testSerializeBounds() {
+    std::vector<uint8_t> payload(protocol::maxPayloadSize, 0x42);
+    std::vector<uint8_t> out(protocol::maxFrameSize);
+    QCOMPARE(protocol::serializeFrame(SubsystemID::Status, MessageID::StartStreaming,
+                                      MessageType::StreamingStatus, payload.data(), payload.size(),
+                                      out.data(), out.size()),
+             protocol::maxFrameSize);
+
+    // One byte too many for the payload, or for the output.
+    payload.push_back(0x42);
+    QCOMPARE(protocol::serializeFrame(SubsystemID::Status, MessageID::StartStreaming,
+                                      MessageType::StreamingStatus, payload.data(), payload.size(),
+                                      out.data(), out.size()),
+             size_t(0));
+    QCOMPARE(protocol::serializeFrame(SubsystemID::Status, MessageID::StartStreaming,
+                                      MessageType::StreamingStatus, payload.data(), 1, out.data(),
+                                      protocol::frameSize(1) - 1),
+             size_t(0));
+}
+
+void TestProtocol::testIdentifyDeviceType() {
+    QCOMPARE(identifyDeviceType(QByteArray::fromHex("1400")), DeviceType::OsmoAction4);
+    QCOMPARE(identifyDeviceType(QByteArray::fromHex("2000ff")), DeviceType::OsmoPocket3);
+    QCOMPARE(identifyDeviceType(QByteArray::fromHex("9900")), DeviceType::Unknown);
+    QCOMPARE(identifyDeviceType(QByteArray::fromHex("14")), DeviceType::Undefined);
+    QCOMPARE(identifyDeviceType(QByteArray()), DeviceType::Undefined);
+}
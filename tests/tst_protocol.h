@@ -0,0 +1,13 @@
+#pragma once
+
+#include <QObject>
+#include <QTest>
+
+class TestProtocol : public QObject {
+    Q_OBJECT
+private slots:
+    void testMatchesMessage();
+    void testParseErrors();
+    void testSerializeBounds();
+    void testIdentifyDeviceType();
+};
@@ -0,0 +1,90 @@
+/**
+ * @file tst_protocol_worker.cpp
+ * @brief Unit tests for the threaded protocol worker and its result queue.
+ */
+
+#include "tst_protocol_worker.h"
+#include "dji/device.h"
+#include "dji/device_flow.h"
+#include "dji/link_health_monitor.h"
+#include "dji/spsc_queue.h"
+#include "dji/subsystem_configurer.h"
+#include "dji/subsystem_pairer.h"
+#include "dji/subsystem_streamer.h"
+#include <QSignalSpy>
+#include <QThread>
+#include <QTimer>
+#include <QtTest>
+
+using namespace dji;
+
+namespace {
+
+class ThreadRecordingFlow : public DeviceFlow {
+    Q_OBJECT
+public:
+    explicit ThreadRecordingFlow(QThread **startedOn) : m_startedOn(startedOn) {}
+
+    void start(Device *dev) override {
+        *m_startedOn = QThread::currentThread();
+        QTimer::singleShot(0, this, [this, dev]() { emit finished(dev, true); });
+    }
+
+private:
+    QThread **m_startedOn;
+};
+
+} // namespace
+
+void TestProtocolWorker::testSpscQueue() {
+    SpscQueue<int> queue(3);
+    QCOMPARE(queue.capacity(), size_t(4));
+
+    for (int i = 0; i < 4; ++i) {
+        QVERIFY(queue.push(i));
+    }
+    QVERIFY(!queue.push(4));
+
+    int value = -1;
+    QVERIFY(queue.pop(value));
+    QCOMPARE(value, 0);
+    QVERIFY(queue.push(4));
+
+    for (int expected = 1; expected <= 4; ++expected) {
+        QVERIFY(queue.pop(value));
+        QCOMPARE(value, expected);
+    }
+    QVERIFY(!queue.pop(value));
+    QVERIFY(queue.isEmpty());
+}
+
+void TestProtocolWorker::testFlowRunsOnWorkerThread() {
+    auto *device = new Device(QBluetoothDeviceInfo(), DeviceType::OsmoPocket3);
+    QThread *startedOn = nullptr;
+    auto *flow = new ThreadRecordingFlow(&startedOn);
+
+    {
+        ProtocolWorker worker;
+        QSignalSpy spyFinished(&worker, &ProtocolWorker::finished);
+        QSignalSpy spyDevices(&worker, &ProtocolWorker::devicesChanged);
+
+        worker.runFlow(device, flow);
+
+        QVERIFY(spyFinished.wait(2000));
+        QCOMPARE(spyFinished.at(0).at(0).value<Device *>(), device);
+        QVERIFY(spyFinished.at(0).at(1).toBool());
+        QVERIFY(spyDevices.count() >= 1);
+        QVERIFY(worker.devices().contains(device));
+        QCOMPARE(startedOn, worker.workerThread());
+        QCOMPARE(device->thread(), worker.workerThread());
+        // The subsystems are children of the device and move with it.
+        QCOMPARE(device->pairer()->thread(), worker.workerThread());
+        QCOMPARE(device->streamer()->thread(), worker.workerThread());
+        QCOMPARE(device->configurer()->thread(), worker.workerThread());
+        QCOMPARE(device->linkHealth()->thread(), worker.workerThread());
+    }
+
+    delete device;
+}
+
+#include "tst_protocol_worker.moc"
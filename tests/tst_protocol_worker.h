@@ -0,0 +1,12 @@
+#pragma once
+
+#include "dji/protocol_worker.h"
+#include <QObject>
+#include <QTest>
+
+class TestProtocolWorker : public QObject {
+    Q_OBJECT
+private slots:
+    void testSpscQueue();
+    void testFlowRunsOnWorkerThread();
+};
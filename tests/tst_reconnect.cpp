@@ -0,0 +1,156 @@
+/**
+ * @file tst_reconnect.cpp
+ * @brief Unit tests for DeviceManager's automatic reconnect and state resumption.
+ */
+
+#include "tst_reconnect.h"
+#include "mock_device.h"
+#include "dji/device_manager.h"
+#include "dji/message.h"
+#include "dji/scheduler.h"
+#include <QSignalSpy>
+#include <QtTest>
+
+using namespace dji;
+
+namespace {
+
+ReconnectPolicy fastPolicy() {
+    ReconnectPolicy policy;
+    policy.enabled = true;
+    policy.initialDelayMs = 10;
+    policy.maxDelayMs = 40;
+    policy.connectTimeoutMs = 200;
+    return policy;
+}
+
+class UnreachableDevice : public MockDevice {
+public:
+    void connectToDevice() override {
+        ++attempts;
+    }
+    int attempts = 0;
+};
+
+} // namespace
+
+void TestReconnect::testDropoutKeepsStreamRunning() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    DeviceManager manager(&device);
+    manager.setReconnectPolicy(fastPolicy());
+    QSignalSpy spyFinished(&manager, &DeviceManager::finished);
+    QSignalSpy spyReconnected(&manager, &DeviceManager::reconnected);
+
+    manager.connectToWiFiAndStartStreaming(&device, testStreamingOptions());
+    QVERIFY(clock.advanceUntil([&]() { return spyFinished.count() == 1; }, 5000));
+    QVERIFY(spyFinished.at(0).at(1).toBool());
+
+    QSignalSpy spySent(&device, &MockDevice::messageSent);
+    device.simulateLinkLoss();
+    QVERIFY(!manager.isPaired(&device));
+    QVERIFY(manager.isStreaming(&device));
+
+    QVERIFY(clock.advanceUntil([&]() { return spyReconnected.count() == 1; }, 5000));
+    QVERIFY(clock.advanceUntil([&]() { return manager.isPaired(&device); }, 5000));
+    QVERIFY(!manager.hasActiveFlow(&device));
+
+    // Only the BLE session was redone; the camera kept its WiFi and stream.
+    QCOMPARE(device.connectCount(), 1);
+    QVERIFY(countSent(spySent, MessageType::SetPairingPIN) > 0);
+    QCOMPARE(countSent(spySent, MessageType::PrepareToLiveStream), 0);
+    QCOMPARE(countSent(spySent, MessageType::ConnectToWiFi), 0);
+    QCOMPARE(countSent(spySent, MessageType::ConfigureStreaming), 0);
+    QCOMPARE(countSent(spySent, MessageType::StartStopStreaming), 0);
+    QVERIFY(manager.isStreaming(&device));
+    QCOMPARE(spyFinished.count(), 1);
+}
+
+void TestReconnect::testDropoutMidFlowResumes() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    DeviceManager manager(&device);
+    manager.setReconnectPolicy(fastPolicy());
+    QSignalSpy spyFinished(&manager, &DeviceManager::finished);
+    QSignalSpy spySent(&device, &MockDevice::messageSent);
+
+    // Drop the link right after the WiFi ack, before the stream is started.
+    bool dropped = false;
+    connect(&manager, &DeviceManager::isWiFiConnectedChanged, &device, [&]() {
+        if (!dropped) {
+            dropped = true;
+            device.simulateLinkLoss();
+        }
+    });
+
+    manager.connectToWiFiAndStartStreaming(&device, testStreamingOptions());
+    QVERIFY(clock.advanceUntil([&]() { return spyFinished.count() == 1; }, 5000));
+    QVERIFY(dropped);
+    QVERIFY(spyFinished.at(0).at(1).toBool());
+    QVERIFY(manager.isStreaming(&device));
+
+    QCOMPARE(device.connectCount(), 1);
+    QCOMPARE(countSent(spySent, MessageType::PrepareToLiveStream), 1);
+    QCOMPARE(countSent(spySent, MessageType::ConnectToWiFi), 1);
+    QCOMPARE(countSent(spySent, MessageType::ConfigureStreaming), 1);
+}
+
+void TestReconnect::testDropoutWithoutPolicyFailsFlow() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    DeviceManager manager(&device);
+    QSignalSpy spyFinished(&manager, &DeviceManager::finished);
+    QSignalSpy spyError(&manager, &DeviceManager::error);
+    QSignalSpy spyReconnecting(&manager, &DeviceManager::reconnecting);
+
+    bool dropped = false;
+    connect(&manager, &DeviceManager::isWiFiConnectedChanged, &device, [&]() {
+        if (!dropped) {
+            dropped = true;
+            device.simulateLinkLoss();
+        }
+    });
+
+    manager.connectToWiFiAndStartStreaming(&device, testStreamingOptions());
+    QVERIFY(clock.advanceUntil([&]() { return spyFinished.count() == 1; }, 5000));
+    QVERIFY(dropped);
+    QVERIFY(!spyFinished.at(0).at(1).toBool());
+    QCOMPARE(spyError.count(), 1);
+    QVERIFY(!manager.hasActiveFlow(&device));
+
+    // No reconnect is attempted and the flow does not report twice.
+    clock.advance(1000);
+    QCOMPARE(spyFinished.count(), 1);
+    QCOMPARE(spyReconnecting.count(), 0);
+    QCOMPARE(device.connectCount(), 1);
+}
+
+void TestReconnect::testGivesUpAfterMaxAttempts() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    UnreachableDevice device;
+    DeviceManager manager(&device);
+    ReconnectPolicy policy = fastPolicy();
+    policy.maxAttempts = 3;
+    policy.connectTimeoutMs = 20;
+    manager.setReconnectPolicy(policy);
+    QSignalSpy spyFinished(&manager, &DeviceManager::finished);
+    QSignalSpy spyReconnecting(&manager, &DeviceManager::reconnecting);
+    QSignalSpy spyError(&manager, &DeviceManager::error);
+
+    manager.connectToWiFiAndStartStreaming(&device, testStreamingOptions());
+    QVERIFY(clock.advanceUntil([&]() { return spyFinished.count() == 1; }, 5000));
+
+    device.simulateLinkLoss();
+    QVERIFY(clock.advanceUntil([&]() { return spyError.count() == 1; }, 5000));
+    QCOMPARE(spyReconnecting.count(), 3);
+    QCOMPARE(device.attempts, 3);
+    QCOMPARE(spyReconnecting.at(1).at(2).toInt(), 20);
+
+    // Stopped retrying: no further attempts are scheduled.
+    clock.advance(200);
+    QCOMPARE(device.attempts, 3);
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <QObject>
+#include <QTest>
+
+class TestReconnect : public QObject {
+    Q_OBJECT
+private slots:
+    void testDropoutKeepsStreamRunning();
+    void testDropoutMidFlowResumes();
+    void testDropoutWithoutPolicyFailsFlow();
+    void testGivesUpAfterMaxAttempts();
+};
@@ -0,0 +1,98 @@
+/**
+ * @file tst_sharded_device_manager.cpp
+ * @brief Unit tests for the sharded, multi-threaded DeviceManager facade.
+ */
+
+#include "tst_sharded_device_manager.h"
+#include "mock_device.h"
+#include "dji/adaptive_bitrate.h"
+#include "dji/device.h"
+#include "dji/subsystem_pairer.h"
+#include "dji/subsystem_streamer.h"
+#include <QPointer>
+#include <QSet>
+#include <QSignalSpy>
+#include <QThread>
+#include <QtTest>
+
+using namespace dji;
+
+void TestShardedDeviceManager::testFlowsRunOnOwningShard() {
+    ShardedDeviceManager manager(2);
+    manager.setAutoRebalance(false);
+    QSignalSpy spyFinished(&manager, &ShardedDeviceManager::finished);
+
+    QList<Device *> devices;
+    for (int i = 0; i < 4; ++i) {
+        auto *dev = new MockDevice;
+        devices.append(dev);
+        manager.addDevice(dev);
+    }
+    QCOMPARE(manager.shardLoad(0), 2);
+    QCOMPARE(manager.shardLoad(1), 2);
+
+    const StreamingOptions opts = testStreamingOptions();
+    for (Device *dev : devices) {
+        manager.connectToWiFiAndStartStreaming(dev, opts);
+    }
+
+    QTRY_COMPARE_WITH_TIMEOUT(spyFinished.count(), 4, 5000);
+
+    QSet<QThread *> threads;
+    for (int i = 0; i < spyFinished.count(); ++i) {
+        QVERIFY(spyFinished.at(i).at(1).toBool());
+        Device *dev = spyFinished.at(i).at(0).value<Device *>();
+        QVERIFY(manager.isStreaming(dev));
+        threads.insert(dev->thread());
+    }
+    QCOMPARE(threads.size(), 2);
+}
+
+void TestShardedDeviceManager::testRebalanceMovesIdleDevices() {
+    ShardedDeviceManager manager(2);
+    QSignalSpy spyMigrated(&manager, &ShardedDeviceManager::deviceMigrated);
+
+    for (int i = 0; i < 4; ++i) {
+        manager.addDevice(new Device(QBluetoothDeviceInfo(), DeviceType::OsmoPocket3), 0);
+    }
+    QCOMPARE(manager.shardLoad(0), 4);
+    QCOMPARE(manager.shardLoad(1), 0);
+
+    // Once shard 0 confirms its devices, the automatic rebalance steals two of them.
+    QTRY_COMPARE_WITH_TIMEOUT(spyMigrated.count(), 2, 2000);
+    QCOMPARE(manager.shardLoad(0), 2);
+    QCOMPARE(manager.shardLoad(1), 2);
+    for (int i = 0; i < spyMigrated.count(); ++i) {
+        QCOMPARE(spyMigrated.at(i).at(1).toInt(), 0);
+        QCOMPARE(spyMigrated.at(i).at(2).toInt(), 1);
+    }
+}
+
+void TestShardedDeviceManager::testTakeDeviceCarriesState() {
+    DeviceManager source;
+    DeviceManager target;
+    auto *dev = new MockDevice;
+    source.addDevice(dev);
+
+    emit dev->pairer()->pairingComplete();
+    emit dev->streamer()->batteryPercentageChanged(80);
+    emit dev->streamer()->batteryPercentageChanged(79);
+    AdaptiveBitrateController *controller = source.bitrateController(dev);
+
+    DeviceTransfer transfer;
+    QVERIFY(source.takeDevice(dev, &transfer));
+    QCOMPARE(transfer.bitrateController, controller);
+    target.addDevice(dev, transfer);
+
+    QVERIFY(target.isPaired(dev));
+    QCOMPARE(target.batteryHistory(dev).samples().size(), 2);
+    QCOMPARE(target.batteryHistory(dev).percentage(), 79);
+    QCOMPARE(target.bitrateController(dev), controller);
+    QCOMPARE(dev->findChildren<AdaptiveBitrateController *>().size(), 1);
+
+    // Without a transfer, the controller goes with the manager that made it.
+    QPointer<AdaptiveBitrateController> taken(controller);
+    QVERIFY(target.takeDevice(dev));
+    QVERIFY(taken.isNull());
+    delete dev;
+}
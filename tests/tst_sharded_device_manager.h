@@ -0,0 +1,13 @@
+#pragma once
+
+#include "dji/sharded_device_manager.h"
+#include <QObject>
+#include <QTest>
+
+class TestShardedDeviceManager : public QObject {
+    Q_OBJECT
+private slots:
+    void testFlowsRunOnOwningShard();
+    void testRebalanceMovesIdleDevices();
+    void testTakeDeviceCarriesState();
+};
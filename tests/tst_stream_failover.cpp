@@ -0,0 +1,121 @@
+/**
+ * @file tst_stream_failover.cpp
+ * @brief Unit tests for RTMP endpoint switching and primary/backup failover.
+ */
+
+#include "tst_stream_failover.h"
+#include "mock_device.h"
+#include "dji/device_manager.h"
+#include "dji/scheduler.h"
+#include "dji/subsystem_streamer.h"
+#include <QSignalSpy>
+#include <QtTest>
+
+using namespace dji;
+
+namespace {
+
+StreamingOptions streamOptions() {
+    StreamingOptions opts = testStreamingOptions();
+    opts.rtmpUrl = "rtmp://primary/live";
+    return opts;
+}
+
+} // namespace
+
+void TestStreamFailover::testSwitchIsPipelined() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    DeviceManager manager(&device);
+    QSignalSpy spyFinished(&manager, &DeviceManager::finished);
+    QSignalSpy spySwitched(&manager, &DeviceManager::streamEndpointSwitched);
+
+    manager.connectToWiFiAndStartStreaming(&device, streamOptions());
+    QVERIFY(clock.advanceUntil([&]() { return spyFinished.count() == 1; }, 5000));
+    QCOMPARE(device.rtmpUrl(), QString("rtmp://primary/live"));
+
+    // Stop, configure and start all go out before the first acknowledgement.
+    QSignalSpy spySent(&device, &MockDevice::messageSent);
+    QVERIFY(manager.switchStreamEndpoint(&device, "rtmp://other/live"));
+    QCOMPARE(spySent.count(), 3);
+    QVERIFY(device.streamer()->isSwitchingEndpoint());
+
+    QVERIFY(clock.advanceUntil([&]() { return spySwitched.count() == 1; }, 5000));
+    QCOMPARE(spySwitched.first().at(1).toString(), QString("rtmp://other/live"));
+    const qint64 downtimeMs = spySwitched.first().at(2).toLongLong();
+    QVERIFY(downtimeMs >= 0);
+    QVERIFY(downtimeMs < 1000);
+
+    QCOMPARE(device.rtmpUrl(), QString("rtmp://other/live"));
+    QCOMPARE(device.streamer()->rtmpUrl(), QString("rtmp://other/live"));
+    QVERIFY(device.isStreaming());
+    QVERIFY(manager.isStreaming(&device));
+}
+
+void TestStreamFailover::testFailoverToBackup() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    DeviceManager manager(&device);
+    QSignalSpy spyFinished(&manager, &DeviceManager::finished);
+    QSignalSpy spySwitched(&manager, &DeviceManager::streamEndpointSwitched);
+
+    StreamingOptions opts = streamOptions();
+    opts.backupRtmpUrl = "rtmp://backup/live";
+    opts.failoverAfterMs = 300;
+    manager.connectToWiFiAndStartStreaming(&device, opts);
+    QVERIFY(clock.advanceUntil([&]() { return spyFinished.count() == 1; }, 5000));
+
+    // Healthy stream: no failover.
+    clock.advance(600);
+    QCOMPARE(spySwitched.count(), 0);
+
+    // The ingest server goes away; the camera stops reporting, BLE stays up.
+    device.setStreaming(false);
+    QVERIFY(clock.advanceUntil([&]() { return spySwitched.count() == 1; }, 5000));
+    QCOMPARE(spySwitched.first().at(1).toString(), QString("rtmp://backup/live"));
+    QCOMPARE(device.rtmpUrl(), QString("rtmp://backup/live"));
+    QVERIFY(device.isStreaming());
+
+    clock.advance(600);
+    QCOMPARE(spySwitched.count(), 1);
+}
+
+void TestStreamFailover::testSwitchNeedsStream() {
+    MockDevice device;
+    DeviceManager manager(&device);
+    QSignalSpy spyError(&manager, &DeviceManager::error);
+
+    QVERIFY(!manager.switchStreamEndpoint(&device, "rtmp://other/live"));
+    QCOMPARE(spyError.count(), 1);
+    QCOMPARE(device.rtmpUrl(), QString());
+}
+
+void TestStreamFailover::testSwitchTimesOut() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    DeviceManager manager(&device);
+    QSignalSpy spyFinished(&manager, &DeviceManager::finished);
+    manager.connectToWiFiAndStartStreaming(&device, streamOptions());
+    QVERIFY(clock.advanceUntil([&]() { return spyFinished.count() == 1; }, 5000));
+
+    device.streamer()->setOperationTimeout(200);
+    device.setLossRate(1.0);
+    QSignalSpy spyError(device.streamer(), &SubsystemStreamer::error);
+    QVERIFY(manager.switchStreamEndpoint(&device, "rtmp://other/live"));
+
+    // A second switch is refused while the first is in flight.
+    QVERIFY(!device.streamer()->switchStreamEndpoint("rtmp://third/live"));
+    QCOMPARE(spyError.count(), 1);
+
+    QVERIFY(clock.advanceUntil([&]() { return spyError.count() == 2; }, 5000));
+    QVERIFY(!device.streamer()->isSwitchingEndpoint());
+
+    // Idle again, so the next switch goes through once answers arrive.
+    device.setLossRate(0.0);
+    QSignalSpy spySwitched(&manager, &DeviceManager::streamEndpointSwitched);
+    QVERIFY(manager.switchStreamEndpoint(&device, "rtmp://other/live"));
+    QVERIFY(clock.advanceUntil([&]() { return spySwitched.count() == 1; }, 5000));
+}
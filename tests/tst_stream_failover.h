@@ -0,0 +1,13 @@
+#pragma once
+
+#include <QObject>
+#include <QTest>
+
+class TestStreamFailover : public QObject {
+    Q_OBJECT
+private slots:
+    void testSwitchIsPipelined();
+    void testFailoverToBackup();
+    void testSwitchNeedsStream();
+    void testSwitchTimesOut();
+};
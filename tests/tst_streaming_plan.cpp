@@ -0,0 +1,141 @@
+/**
+ * @file tst_streaming_plan.cpp
+ * @brief Unit tests for StreamingStarter's state probing and step plan.
+ */
+
+#include "tst_streaming_plan.h"
+#include "mock_device.h"
+#include "dji/device_flow.h"
+#include "dji/device_manager.h"
+#include "dji/message.h"
+#include "dji/scheduler.h"
+#include "dji/subsystem_streamer.h"
+#include <QSignalSpy>
+#include <QtTest>
+
+using namespace dji;
+
+namespace {
+
+StreamingOptions testOptions() {
+    StreamingOptions opts = testStreamingOptions();
+    opts.probeTimeoutMs = 150;
+    return opts;
+}
+
+} // namespace
+
+void TestStreamingPlan::testLiveCameraSkipsAllSteps() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    DeviceManager manager(&device);
+    const StreamingOptions opts = testOptions();
+    QVERIFY(startStreaming(clock, manager, device, opts));
+
+    // A new flow with the same settings, on a stream that is still pushing status.
+    QSignalSpy spySent(&device, &MockDevice::messageSent);
+    StreamingStarter flow(opts);
+    QSignalSpy spyFinished(&flow, &DeviceFlow::finished);
+    flow.start(&device);
+    QVERIFY(clock.advanceUntil([&]() { return spyFinished.count() > 0; }, 5000));
+    QVERIFY(spyFinished.at(0).at(1).toBool());
+
+    QVERIFY(countSent(spySent, MessageType::SetPairingPIN) > 0);
+    QCOMPARE(countSent(spySent, MessageType::PrepareToLiveStream), 0);
+    QCOMPARE(countSent(spySent, MessageType::ConnectToWiFi), 0);
+    QCOMPARE(countSent(spySent, MessageType::ConfigureStreaming), 0);
+    QCOMPARE(countSent(spySent, MessageType::StartStopStreaming), 0);
+}
+
+void TestStreamingPlan::testLiveCameraWithOtherSettingsIsReconfigured() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    DeviceManager manager(&device);
+    device.setStreaming(true);
+    clock.advance(100);
+
+    // Nothing is known about the stream the camera runs: it is reconfigured,
+    // but not prepared again.
+    QSignalSpy spySent(&device, &MockDevice::messageSent);
+    StreamingOptions opts = testOptions();
+    QVERIFY(startStreaming(clock, manager, device, opts));
+    QCOMPARE(countSent(spySent, MessageType::PrepareToLiveStream), 0);
+    QCOMPARE(countSent(spySent, MessageType::ConfigureStreaming), 1);
+    QCOMPARE(countSent(spySent, MessageType::StartStopStreaming), 1);
+
+    // A different bitrate on the live stream is applied, not skipped.
+    opts.bitrateKbps = 2500;
+    spySent.clear();
+    QVERIFY(startStreaming(clock, manager, device, opts));
+    QCOMPARE(countSent(spySent, MessageType::PrepareToLiveStream), 0);
+    QCOMPARE(countSent(spySent, MessageType::ConfigureStreaming), 1);
+    QCOMPARE(device.streamer()->bitrateKbps(), uint16_t(2500));
+}
+
+void TestStreamingPlan::testKnownStreamIsConfirmed() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    DeviceManager manager(&device);
+    QVERIFY(startStreaming(clock, manager, device, testOptions()));
+
+    QSignalSpy spySent(&device, &MockDevice::messageSent);
+    QVERIFY(startStreaming(clock, manager, device, testOptions()));
+
+    QCOMPARE(countSent(spySent, MessageType::PrepareToLiveStream), 0);
+    QCOMPARE(countSent(spySent, MessageType::ConnectToWiFi), 0);
+    QCOMPARE(countSent(spySent, MessageType::ConfigureStreaming), 0);
+    QCOMPARE(countSent(spySent, MessageType::StartStopStreaming), 0);
+}
+
+void TestStreamingPlan::testStaleStreamIsRestarted() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    DeviceManager manager(&device);
+    const StreamingOptions opts = testOptions();
+    QVERIFY(startStreaming(clock, manager, device, opts));
+
+    // The camera dropped its stream behind our back; its status pushes stop.
+    device.setStreaming(false);
+    clock.advance(opts.probeTimeoutMs + 50);
+
+    QSignalSpy spySent(&device, &MockDevice::messageSent);
+    QVERIFY(startStreaming(clock, manager, device, opts));
+
+    QVERIFY(device.isStreaming());
+    QCOMPARE(countSent(spySent, MessageType::PrepareToLiveStream), 0);
+    QCOMPARE(countSent(spySent, MessageType::ConnectToWiFi), 0);
+    QCOMPARE(countSent(spySent, MessageType::ConfigureStreaming), 1);
+    QCOMPARE(countSent(spySent, MessageType::StartStopStreaming), 1);
+}
+
+void TestStreamingPlan::testChangedStreamSettingsAreApplied() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    DeviceManager manager(&device);
+    StreamingOptions opts = testOptions();
+    QVERIFY(startStreaming(clock, manager, device, opts));
+
+    device.setStreaming(false);
+    clock.advance(opts.probeTimeoutMs + 50);
+
+    // Same WiFi, new ingest URL: only the stream is (re)configured.
+    opts.rtmpUrl = "rtmp://test/other";
+    QSignalSpy spySent(&device, &MockDevice::messageSent);
+    QVERIFY(startStreaming(clock, manager, device, opts));
+
+    QCOMPARE(countSent(spySent, MessageType::PrepareToLiveStream), 0);
+    QCOMPARE(countSent(spySent, MessageType::ConnectToWiFi), 0);
+    QCOMPARE(countSent(spySent, MessageType::ConfigureStreaming), 1);
+
+    // New WiFi credentials: WiFi is joined again before starting.
+    opts.ssid = "other-ssid";
+    spySent.clear();
+    QVERIFY(startStreaming(clock, manager, device, opts));
+    QCOMPARE(countSent(spySent, MessageType::ConnectToWiFi), 1);
+    QCOMPARE(countSent(spySent, MessageType::ConfigureStreaming), 1);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <QObject>
+#include <QTest>
+
+class TestStreamingPlan : public QObject {
+    Q_OBJECT
+private slots:
+    void testLiveCameraSkipsAllSteps();
+    void testLiveCameraWithOtherSettingsIsReconfigured();
+    void testKnownStreamIsConfirmed();
+    void testStaleStreamIsRestarted();
+    void testChangedStreamSettingsAreApplied();
+};
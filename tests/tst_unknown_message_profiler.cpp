@@ -0,0 +1,129 @@
+/**
+ * @file tst_unknown_message_profiler.cpp
+ * @brief Unit tests for the statistics on unknown message types.
+ */
+
+#include "tst_unknown_message_profiler.h"
+#include "mock_device.h"
+#include "dji/scheduler.h"
+#include "dji/unknown_message_profiler.h"
+#include <QJsonArray>
+#include <QtTest>
+
+using namespace dji;
+
+namespace {
+
+// Payload of the i-th frame: a constant, a sequence number, a flag and a
+// byte all over the place, then an optional tail.
+Message unknownFrame(int i, int tail = 0) {
+    Message msg;
+    msg.subsystem = SubsystemID::Status;
+    msg.msgId = static_cast<MessageID>(0x0042);
+    msg.msgType = MessageType::Unknown3;
+    msg.payload = QByteArray(4 + tail, 0);
+    msg.payload[0] = 0x01;
+    msg.payload[1] = static_cast<char>(i);
+    msg.payload[2] = static_cast<char>(i % 2);
+    msg.payload[3] = static_cast<char>(i * 37);
+    return msg;
+}
+
+Message streamingStatus() {
+    Message msg;
+    msg.subsystem = SubsystemID::Status;
+    msg.msgType = MessageType::StreamingStatus;
+    msg.payload = QByteArray(21, 0);
+    return msg;
+}
+
+} // namespace
+
+void TestUnknownMessageProfiler::testProfile() {
+    VirtualScheduler scheduler;
+    ScopedScheduler scope(&scheduler);
+    UnknownMessageProfiler profiler;
+
+    for (int i = 0; i < 5; ++i) {
+        profiler.record(unknownFrame(i, i == 4 ? 2 : 0));
+        profiler.record(streamingStatus());
+        scheduler.advance(100);
+    }
+    Message unlisted;
+    unlisted.msgType = static_cast<MessageType>(0x123456);
+    profiler.record(unlisted);
+
+    const QList<UnknownMessageProfile> profiles = profiler.profiles();
+    QCOMPARE(profiles.size(), 2);
+    QVERIFY(profiles[0].msgType == static_cast<MessageType>(0x123456));
+    QCOMPARE(profiles[0].frames, quint64(1));
+    QCOMPARE(profiles[0].ratePerSecond(), 0.0);
+    QVERIFY(profiles[0].bytes.isEmpty());
+
+    const UnknownMessageProfile &profile = profiles[1];
+    QVERIFY(profile.msgType == MessageType::Unknown3);
+    QCOMPARE(profile.frames, quint64(5));
+    QCOMPARE(profile.payloadBytes, quint64(22));
+    QCOMPARE(profile.firstSeenMs, qint64(0));
+    QCOMPARE(profile.lastSeenMs, qint64(400));
+    QCOMPARE(profile.minIntervalMs, qint64(100));
+    QCOMPARE(profile.maxIntervalMs, qint64(100));
+    QCOMPARE(profile.ratePerSecond(), 10.0);
+    QCOMPARE(profile.payloadLengths, (QMap<int, quint64>{{4, 4}, {6, 1}}));
+    QCOMPARE(profile.lastPayload, unknownFrame(4, 2).payload);
+
+    QCOMPARE(profile.variabilityMap(), QString(".+ex.."));
+    QCOMPARE(profile.bytes[1].increments, quint64(4));
+    QCOMPARE(profile.bytes[2].distinct(), 2);
+    QCOMPARE(profile.bytes[3].distinct(), 5);
+    QCOMPARE(profile.bytes[3].min, quint8(0));
+    QCOMPARE(profile.bytes[3].max, quint8(148));
+    QCOMPARE(profile.bytes[4].frames, quint64(1));
+
+    const QJsonArray messages = profiler.toJson()["messages"].toArray();
+    QCOMPARE(messages.size(), 2);
+    QCOMPARE(messages.at(1).toObject()["variability"].toString(), QString(".+ex.."));
+
+    profiler.reset();
+    QVERIFY(profiler.profiles().isEmpty());
+}
+
+void TestUnknownMessageProfiler::testDeviceProfiling() {
+    MockDevice device;
+    QVERIFY(!device.unknownMessageProfiler());
+    device.simulateNotification(unknownFrame(0).serialize());
+
+    device.setUnknownMessageProfiling(true);
+    const std::shared_ptr<UnknownMessageProfiler> profiler = device.unknownMessageProfiler();
+    QVERIFY(profiler);
+    device.setUnknownMessageProfiling(true);
+    QCOMPARE(device.unknownMessageProfiler(), profiler);
+
+    for (int i = 0; i < 3; ++i) {
+        device.simulateNotification(unknownFrame(i).serialize());
+        device.simulateNotification(streamingStatus().serialize());
+    }
+    QCOMPARE(profiler->profiles().size(), 1);
+    QCOMPARE(profiler->profiles().first().frames, quint64(3));
+    // The profile copies payloads instead of holding on to received frames.
+    QCOMPARE(device.framePool().available(), device.framePool().size());
+
+    // A reader still holding the profiler keeps what it collected.
+    device.setUnknownMessageProfiling(false);
+    QVERIFY(!device.unknownMessageProfiler());
+    device.simulateNotification(unknownFrame(3).serialize());
+    QCOMPARE(profiler->profiles().first().frames, quint64(3));
+}
+
+void TestUnknownMessageProfiler::testMaxKeys() {
+    UnknownMessageProfiler profiler(2, 2);
+    for (int id = 0; id < 3; ++id) {
+        Message msg = unknownFrame(id);
+        msg.msgId = static_cast<MessageID>(id);
+        profiler.record(msg);
+    }
+    QCOMPARE(profiler.profiles().size(), 2);
+    QCOMPARE(profiler.droppedFrames(), quint64(1));
+    QCOMPARE(profiler.profiles().first().bytes.size(), 2);
+    QCOMPARE(profiler.profiles().first().payloadLengths.value(4), quint64(1));
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <QObject>
+#include <QTest>
+
+class TestUnknownMessageProfiler : public QObject {
+    Q_OBJECT
+private slots:
+    void testProfile();
+    void testDeviceProfiling();
+    void testMaxKeys();
+};
@@ -0,0 +1,153 @@
+/**
+ * @file tst_virtual_time.cpp
+ * @brief Flow, link health and battery scenarios run on a VirtualScheduler.
+ */
+
+#include "tst_virtual_time.h"
+#include "mock_device.h"
+#include "dji/battery_policy.h"
+#include "dji/device_manager.h"
+#include "dji/link_health_monitor.h"
+#include "dji/scheduler.h"
+#include <QElapsedTimer>
+#include <QSignalSpy>
+#include <QtTest>
+
+using namespace dji;
+
+namespace {
+
+StreamingOptions streamOptions() {
+    StreamingOptions opts = testStreamingOptions();
+    opts.fps = FPS::FPS30;
+    return opts;
+}
+
+} // namespace
+
+void TestVirtualTime::testSchedulerOrdering() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    QStringList order;
+
+    Timer::singleShot(30, nullptr, [&order]() { order.append("c"); });
+    Timer::singleShot(10, nullptr, [&order]() { order.append("a"); });
+    Timer::singleShot(10, nullptr, [&order]() { order.append("b"); });
+    const Scheduler::TimerId cancelled =
+        clock.schedule(20, nullptr, [&order]() { order.append("cancelled"); });
+    clock.cancel(cancelled);
+    {
+        QObject context;
+        Timer::singleShot(20, &context, [&order]() { order.append("destroyed"); });
+    }
+
+    ElapsedTimer elapsed;
+    elapsed.start();
+    clock.advance(15);
+    QCOMPARE(order, QStringList({"a", "b"}));
+    QCOMPARE(elapsed.elapsed(), qint64(15));
+    clock.advance(100);
+    QCOMPARE(order, QStringList({"a", "b", "c"}));
+    QCOMPARE(clock.pendingCount(), 0);
+
+    Timer repeating;
+    repeating.setInterval(1000);
+    int ticks = 0;
+    connect(&repeating, &Timer::timeout, &repeating, [&ticks]() { ++ticks; });
+    repeating.start();
+    clock.advance(10500);
+    QCOMPARE(ticks, 10);
+    repeating.stop();
+    QVERIFY(!repeating.isActive());
+    QCOMPARE(clock.pendingCount(), 0);
+}
+
+void TestVirtualTime::testElapsedTimerKeepsScheduler() {
+    VirtualScheduler outer;
+    ScopedScheduler outerScope(&outer);
+    ElapsedTimer elapsed;
+    elapsed.start();
+    outer.advance(10);
+    {
+        // Another scheduler installed later does not move this timer.
+        VirtualScheduler inner(qint64(1000) * 1000000);
+        ScopedScheduler innerScope(&inner);
+        QCOMPARE(elapsed.elapsed(), qint64(10));
+        inner.advance(500);
+        QCOMPARE(elapsed.elapsed(), qint64(10));
+        outer.advance(5);
+        QCOMPARE(elapsed.restart(), qint64(15));
+    }
+    outer.advance(20);
+    QCOMPARE(elapsed.elapsed(), qint64(20));
+}
+
+void TestVirtualTime::testConnectFlow() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    DeviceManager manager(&device);
+    QSignalSpy spyFinished(&manager, &DeviceManager::finished);
+
+    QElapsedTimer wall;
+    wall.start();
+    manager.connectToWiFiAndStartStreaming(&device, streamOptions());
+    QVERIFY(clock.advanceUntil([&spyFinished]() { return !spyFinished.isEmpty(); }, 60000));
+    QVERIFY(spyFinished.first().at(1).toBool());
+    QVERIFY(manager.isStreaming(&device));
+    QVERIFY(device.isStreaming());
+    // Only the mock's answer latency passed, however slow the machine is.
+    QVERIFY(clock.elapsedMs() < 5000);
+    QVERIFY(wall.elapsed() < 5000);
+}
+
+void TestVirtualTime::testSilenceAfterAnHour() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    LinkHealthMonitor *health = device.linkHealth();
+    QSignalSpy spyDegraded(health, &LinkHealthMonitor::degraded);
+    device.setStatusInterval(10000);
+    health->start();
+    device.setStreaming(true);
+
+    // An hour of a status every 10 s, with the production options.
+    clock.advance(60 * 60 * 1000);
+    QCOMPARE(health->cadenceMs(), 10000);
+    QCOMPARE(health->score(), 100);
+    QVERIFY(spyDegraded.isEmpty());
+
+    // Degraded once four intervals pass in silence, to the evaluation tick.
+    device.setStreaming(false);
+    QVERIFY(clock.advanceUntil([&spyDegraded]() { return !spyDegraded.isEmpty(); }, 120000));
+    QVERIFY(health->silenceMs() > 40000);
+    QVERIFY(health->silenceMs() <= 40000 + LinkHealthOptions().evaluationIntervalMs);
+}
+
+void TestVirtualTime::testBatteryDrain() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    device.setStatusInterval(5000);
+    DeviceManager manager(&device);
+    BatteryPolicy policy;
+    policy.thresholds = {{-1, 60, BatteryAction::Alert}};
+    manager.setBatteryPolicy(policy);
+    QSignalSpy spyThreshold(&manager, &DeviceManager::batteryThresholdReached);
+    QSignalSpy spyFinished(&manager, &DeviceManager::finished);
+
+    manager.connectToWiFiAndStartStreaming(&device, streamOptions());
+    QVERIFY(clock.advanceUntil([&spyFinished]() { return !spyFinished.isEmpty(); }, 60000));
+
+    // 1% a minute: an hour to go once the camera is down to 60%.
+    for (int percentage = 99; percentage > 0 && spyThreshold.isEmpty(); --percentage) {
+        device.setBattery(percentage);
+        clock.advance(60000);
+    }
+    QCOMPARE(spyThreshold.count(), 1);
+    const int percentage = spyThreshold.first().at(1).toInt();
+    QVERIFY(percentage >= 59 && percentage <= 60);
+    const qint64 tte = spyThreshold.first().at(2).toLongLong();
+    QVERIFY(tte > 58 * 60000 && tte <= 60 * 60000);
+    QCOMPARE(manager.batteryPercentage(&device), percentage);
+}
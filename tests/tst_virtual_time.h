@@ -0,0 +1,14 @@
+#pragma once
+
+#include <QObject>
+#include <QTest>
+
+class TestVirtualTime : public QObject {
+    Q_OBJECT
+private slots:
+    void testSchedulerOrdering();
+    void testElapsedTimerKeepsScheduler();
+    void testConnectFlow();
+    void testSilenceAfterAnHour();
+    void testBatteryDrain();
+};
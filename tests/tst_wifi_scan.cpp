@@ -0,0 +1,139 @@
+/**
+ * @file tst_wifi_scan.cpp
+ * @brief Unit tests for WiFi scan decoding and best-network selection.
+ */
+
+#include "tst_wifi_scan.h"
+#include "mock_device.h"
+#include "dji/device_manager.h"
+#include "dji/scheduler.h"
+#include "dji/subsystem_pairer.h"
+#include "dji/wifi_scan.h"
+#include <QSignalSpy>
+#include <QtTest>
+
+using namespace dji;
+
+namespace {
+
+WiFiNetwork network(const QString &ssid, int rssi, int channel = 6) {
+    WiFiNetwork n;
+    n.ssid = ssid;
+    n.rssi = rssi;
+    n.channel = channel;
+    n.security = WiFiSecurity::WPA2;
+    return n;
+}
+
+StreamingOptions venueOptions() {
+    StreamingOptions opts;
+    opts.wifiNetworks = {{"venue-main", "main-psk"}, {"venue-backup", "backup-psk"}};
+    opts.wifiScanTimeoutMs = 500;
+    opts.rtmpUrl = "rtmp://test/live";
+    return opts;
+}
+
+} // namespace
+
+void TestWiFiScan::testParseReport() {
+    const QByteArray report =
+        MockDevice::wifiScanReport({network("alpha", -42, 1), network("beta", -77, 149)});
+
+    bool ok = false;
+    QList<WiFiNetwork> networks = WiFiScanTable::parseReport(report, &ok);
+    QVERIFY(ok);
+    QCOMPARE(networks.size(), 2);
+    QCOMPARE(networks[0].ssid, QString("alpha"));
+    QCOMPARE(networks[0].rssi, -42);
+    QCOMPARE(networks[0].channel, 1);
+    QCOMPARE(networks[0].security, WiFiSecurity::WPA2);
+    QCOMPARE(networks[1].ssid, QString("beta"));
+    QCOMPARE(networks[1].rssi, -77);
+    QCOMPARE(networks[1].channel, 149);
+
+    // A cut-off report keeps the complete entries.
+    networks = WiFiScanTable::parseReport(report.left(report.size() - 2), &ok);
+    QVERIFY(!ok);
+    QCOMPARE(networks.size(), 1);
+    QCOMPARE(networks[0].ssid, QString("alpha"));
+}
+
+void TestWiFiScan::testTableDeduplicates() {
+    WiFiScanTable table;
+    QVERIFY(table.update(MockDevice::wifiScanReport({network("alpha", -70)})));
+    QVERIFY(table.update(MockDevice::wifiScanReport({network("beta", -60), network("alpha", -50)})));
+    // A weaker AP with a known SSID changes nothing.
+    QVERIFY(!table.update(MockDevice::wifiScanReport({network("alpha", -80, 11)})));
+
+    QCOMPARE(table.size(), 2);
+    const QList<WiFiNetwork> networks = table.networks();
+    QCOMPARE(networks[0].ssid, QString("alpha"));
+    QCOMPARE(networks[0].rssi, -50);
+    QCOMPARE(networks[1].ssid, QString("beta"));
+
+    const QList<WiFiCredentials> ranked =
+        table.rank({{"hidden", "x"}, {"beta", "b"}, {"alpha", "a"}});
+    QCOMPARE(ranked.size(), 3);
+    QCOMPARE(ranked[0].ssid, QString("alpha"));
+    QCOMPARE(ranked[1].ssid, QString("beta"));
+    QCOMPARE(ranked[2].ssid, QString("hidden"));
+}
+
+void TestWiFiScan::testFlowJoinsStrongestNetwork() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    device.setWiFiNetworks({network("venue-main", -85), network("guest", -40),
+                            network("venue-backup", -55)});
+    DeviceManager manager(&device);
+    QSignalSpy spyFinished(&manager, &DeviceManager::finished);
+    QSignalSpy spyNetworks(device.pairer(), &SubsystemPairer::wifiNetworksChanged);
+
+    manager.connectToWiFiAndStartStreaming(&device, venueOptions());
+    QVERIFY(clock.advanceUntil([&]() { return spyFinished.count() == 1; }, 5000));
+    QCOMPARE(spyFinished.first().at(1).toBool(), true);
+
+    QCOMPARE(device.joinedSsids(), QStringList{"venue-backup"});
+    QVERIFY(spyNetworks.count() >= 2);
+    QCOMPARE(device.pairer()->wifiNetworks().first().ssid, QString("guest"));
+}
+
+void TestWiFiScan::testFlowFallsBackOnRejection() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    device.setWiFiNetworks({network("venue-main", -45), network("venue-backup", -70)});
+    device.setRejectedSsids({"venue-main"});
+    DeviceManager manager(&device);
+    QSignalSpy spyFinished(&manager, &DeviceManager::finished);
+
+    manager.connectToWiFiAndStartStreaming(&device, venueOptions());
+    QVERIFY(clock.advanceUntil([&]() { return spyFinished.count() == 1; }, 5000));
+    QCOMPARE(spyFinished.first().at(1).toBool(), true);
+
+    const QStringList expected{"venue-main", "venue-backup"};
+    QCOMPARE(device.joinedSsids(), expected);
+    QVERIFY(manager.isWiFiConnected(&device));
+    QVERIFY(device.isStreaming());
+}
+
+void TestWiFiScan::testFlowFailsWhenNothingJoins() {
+    VirtualScheduler clock;
+    ScopedScheduler scope(&clock);
+    MockDevice device;
+    device.setRejectedSsids({"venue-main", "venue-backup"});
+    DeviceManager manager(&device);
+    QSignalSpy spyFinished(&manager, &DeviceManager::finished);
+    QSignalSpy spyError(&manager, &DeviceManager::error);
+
+    // Nothing is heard: the scan times out and the list order is kept.
+    manager.connectToWiFiAndStartStreaming(&device, venueOptions());
+    QVERIFY(clock.advanceUntil([&]() { return spyFinished.count() == 1; }, 5000));
+    QCOMPARE(spyFinished.first().at(1).toBool(), false);
+    QVERIFY(!spyError.isEmpty());
+    QVERIFY(spyError.last().at(0).toString().contains("WiFi connection failed"));
+
+    const QStringList expected{"venue-main", "venue-backup"};
+    QCOMPARE(device.joinedSsids(), expected);
+    QVERIFY(!device.isStreaming());
+}
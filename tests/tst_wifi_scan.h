@@ -0,0 +1,14 @@
+#pragma once
+
+#include <QObject>
+#include <QTest>
+
+class TestWiFiScan : public QObject {
+    Q_OBJECT
+private slots:
+    void testParseReport();
+    void testTableDeduplicates();
+    void testFlowJoinsStrongestNetwork();
+    void testFlowFallsBackOnRejection();
+    void testFlowFailsWhenNothingJoins();
+};
@@ -0,0 +1,706 @@
+/**
+ * @file capture_analyze.cpp
+ * @brief Offline analysis of recorded captures, in parallel across cores.
+ *
+ * Splits a capture written by CaptureRecorder into chunks, decodes them on
+ * a pool of threads, resyncing on record boundaries at the start of each
+ * chunk and after corrupt bytes, and merges the per-chunk results in file
+ * order. Reports per-type counts, inter-arrival distributions,
+ * request-to-response latencies and the payloads of unknown types:
+ *
+ *   dji_capture_analyze --threads 8 --json report.json fleet.djicap
+ *
+ * Only the capture format of dji/capture.h is read; Android btsnoop logs
+ * and other HCI dumps have to be converted first. Needs only dji_protocol,
+ * so it builds without Qt.
+ */
+
+#include "dji/capture.h"
+#include "dji/protocol.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+using namespace dji;
+
+namespace {
+
+struct Options {
+    std::string path;
+    std::string jsonPath;
+    unsigned threads = 0;
+    uint64_t chunkBytes = 0;
+    size_t maxPayloads = 16;
+    // Answers later than this are not matched to their request, like
+    // LinkHealthMonitor forgets requests after 10 s.
+    uint64_t latencyTimeoutUs = 10000000;
+};
+
+// Frames of one type in one direction.
+struct TypeKey {
+    capture::Direction direction;
+    MessageType type;
+
+    bool operator<(const TypeKey &o) const {
+        return std::tie(direction, type) < std::tie(o.direction, o.type);
+    }
+};
+
+// A frame stream whose gaps are measured: one type from one device.
+struct StreamKey {
+    uint16_t device;
+    capture::Direction direction;
+    MessageType type;
+
+    bool operator<(const StreamKey &o) const {
+        return std::tie(device, direction, type) < std::tie(o.device, o.direction, o.type);
+    }
+};
+
+// Matches an answer to its request, like LinkHealthMonitor::requestKey().
+struct RequestKey {
+    uint16_t device;
+    SubsystemID subsystem;
+    MessageID msgId;
+
+    bool operator<(const RequestKey &o) const {
+        return std::tie(device, subsystem, msgId) < std::tie(o.device, o.subsystem, o.msgId);
+    }
+};
+
+struct UnknownKey {
+    SubsystemID subsystem;
+    MessageID msgId;
+    MessageType type;
+
+    bool operator<(const UnknownKey &o) const {
+        return std::tie(subsystem, msgId, type) < std::tie(o.subsystem, o.msgId, o.type);
+    }
+};
+
+struct TypeStats {
+    uint64_t frames = 0;
+    uint64_t payloadBytes = 0;
+};
+
+struct Stream {
+    uint64_t frames = 0;
+    uint64_t firstUs = 0;
+    uint64_t lastUs = 0;
+    std::vector<uint64_t> intervalsUs;
+};
+
+struct Pending {
+    uint64_t sentUs;
+    MessageType type;
+};
+
+// What a chunk did to one request key, so chunks can be chained in order.
+struct RequestTrace {
+    // An answer arrived before any request in this chunk; it answers the
+    // request left pending by the chunks before, if any.
+    bool headAnswer = false;
+    uint64_t headAnswerUs = 0;
+    // Pending at the end of the chunk.
+    bool pending = false;
+    Pending last{};
+};
+
+struct PayloadCount {
+    uint64_t count = 0;
+    // File offset of the first record carrying the payload; the bytes of
+    // the listed payloads are read back from there.
+    uint64_t firstOffset = 0;
+};
+
+struct ListedPayload {
+    std::string hex;
+    uint64_t count;
+};
+
+struct Unknown {
+    uint64_t frames = 0;
+    // Exact counts by payload hash until capPayloads(), which lists the most
+    // frequent. An entry takes the same few bytes however long the payload.
+    std::unordered_map<uint64_t, PayloadCount> payloads;
+    std::vector<ListedPayload> listed;
+    size_t distinctPayloads = 0;
+    // Frames whose payload is not listed.
+    uint64_t otherFrames = 0;
+};
+
+struct ChunkResult {
+    uint64_t records = 0;
+    uint64_t skippedBytes = 0;
+    // File offsets of the first record and of the byte after the last one.
+    uint64_t firstOffset = 0;
+    uint64_t endOffset = 0;
+    bool empty = true;
+    std::map<TypeKey, TypeStats> types;
+    std::map<StreamKey, Stream> streams;
+    std::map<RequestKey, RequestTrace> requests;
+    // Latencies resolved inside the chunk, by request type.
+    std::map<MessageType, std::vector<uint64_t>> latenciesUs;
+    std::map<UnknownKey, Unknown> unknowns;
+};
+
+std::string hex(const uint8_t *data, size_t size) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out(size * 2, '0');
+    for (size_t i = 0; i < size; ++i) {
+        out[2 * i] = digits[data[i] >> 4];
+        out[2 * i + 1] = digits[data[i] & 0x0F];
+    }
+    return out;
+}
+
+// FNV-1a; a collision among the distinct payloads of a capture is not a
+// practical concern at 64 bits.
+uint64_t payloadHash(const uint8_t *data, size_t size) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+std::string typeName(MessageType type) {
+    if (const char *name = protocol::messageTypeName(type))
+        return name;
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "0x%06" PRIX32, static_cast<uint32_t>(type));
+    return buf;
+}
+
+const char *directionName(capture::Direction direction) {
+    return direction == capture::Direction::Sent ? "sent" : "received";
+}
+
+// Like capture::findRecord(), but a record must be followed by another one
+// or by the end of the data, which makes a false sync inside a payload
+// practically impossible.
+size_t resync(const uint8_t *data, size_t size) {
+    capture::Record record;
+    for (size_t offset = 0; offset < size;) {
+        offset += capture::findRecord(data + offset, size - offset);
+        if (offset >= size)
+            return size;
+        const size_t next = offset + capture::readRecord(data + offset, size - offset, &record);
+        if (size - next < capture::recordHeaderSize + protocol::overhead ||
+            capture::readRecord(data + next, size - next, &record) > 0)
+            return offset;
+        ++offset;
+    }
+    return size;
+}
+
+void addRecord(ChunkResult &result, const capture::Record &record, uint64_t offset,
+               const Options &options) {
+    const protocol::FrameView &frame = record.frame;
+    ++result.records;
+
+    TypeStats &type = result.types[{record.direction, frame.msgType}];
+    ++type.frames;
+    type.payloadBytes += frame.payloadSize;
+
+    Stream &stream = result.streams[{record.device, record.direction, frame.msgType}];
+    if (stream.frames++ == 0) {
+        stream.firstUs = record.timestampUs;
+    } else {
+        stream.intervalsUs.push_back(record.timestampUs - stream.lastUs);
+    }
+    stream.lastUs = record.timestampUs;
+
+    const RequestKey requestKey{record.device, frame.subsystem, frame.msgId};
+    auto trace = result.requests.find(requestKey);
+    if (record.direction == capture::Direction::Sent) {
+        if (trace == result.requests.end()) {
+            trace = result.requests.emplace(requestKey, RequestTrace()).first;
+        }
+        trace->second.pending = true;
+        trace->second.last = {record.timestampUs, frame.msgType};
+    } else if (trace == result.requests.end()) {
+        RequestTrace head;
+        head.headAnswer = true;
+        head.headAnswerUs = record.timestampUs;
+        result.requests.emplace(requestKey, head);
+    } else if (trace->second.pending) {
+        const uint64_t latency = record.timestampUs - trace->second.last.sentUs;
+        if (latency <= options.latencyTimeoutUs) {
+            result.latenciesUs[trace->second.last.type].push_back(latency);
+        }
+        trace->second.pending = false;
+    }
+
+    if (!protocol::isKnownMessageType(frame.msgType)) {
+        // Counted exactly: a cap here would depend on where chunks start.
+        Unknown &unknown = result.unknowns[{frame.subsystem, frame.msgId, frame.msgType}];
+        ++unknown.frames;
+        PayloadCount &payload = unknown.payloads[payloadHash(frame.payload, frame.payloadSize)];
+        if (payload.count++ == 0) {
+            payload.firstOffset = offset;
+        }
+    }
+}
+
+// Decodes the records starting in [begin, end) of the file.
+void analyzeChunk(const Options &options, uint64_t begin, uint64_t end, uint64_t fileSize,
+                  std::vector<uint8_t> &buffer, ChunkResult &result) {
+    // A record starting just before end may reach up to maxRecordSize past it.
+    const uint64_t readEnd = std::min<uint64_t>(fileSize, end + capture::maxRecordSize);
+    buffer.resize(readEnd - begin);
+    std::ifstream file(options.path, std::ios::binary);
+    file.seekg(static_cast<std::streamoff>(begin));
+    file.read(reinterpret_cast<char *>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+    const size_t size = static_cast<size_t>(file.gcount());
+    const size_t owned = static_cast<size_t>(std::min<uint64_t>(end - begin, size));
+
+    capture::Record record;
+    size_t offset = 0;
+    while (offset < owned) {
+        const size_t recordSize =
+            capture::readRecord(buffer.data() + offset, size - offset, &record);
+        if (recordSize == 0) {
+            const size_t next = offset + resync(buffer.data() + offset, size - offset);
+            // Leading bytes are usually the tail of the previous chunk's last
+            // record; merge() accounts for them.
+            if (!result.empty) {
+                result.skippedBytes += std::min(next, owned) - offset;
+            }
+            offset = next;
+            continue;
+        }
+        if (result.empty) {
+            result.empty = false;
+            result.firstOffset = begin + offset;
+        }
+        addRecord(result, record, begin + offset, options);
+        offset += recordSize;
+        result.endOffset = begin + offset;
+    }
+}
+
+// Chains the chunk results in file order.
+struct Report {
+    uint64_t records = 0;
+    uint64_t skippedBytes = 0;
+    // Chunks whose first record overlaps the last record of the chunk before.
+    uint64_t resyncMismatches = 0;
+    uint64_t firstUs = 0;
+    uint64_t lastUs = 0;
+    std::map<TypeKey, TypeStats> types;
+    std::map<StreamKey, Stream> streams;
+    std::map<RequestKey, Pending> pending;
+    std::map<MessageType, std::vector<uint64_t>> latenciesUs;
+    std::map<UnknownKey, Unknown> unknowns;
+    // Where the next record should start.
+    uint64_t expectedOffset = capture::magicSize;
+};
+
+void merge(Report &report, ChunkResult &chunk, const Options &options) {
+    if (chunk.empty)
+        return;
+    if (chunk.firstOffset < report.expectedOffset) {
+        ++report.resyncMismatches;
+    } else {
+        report.skippedBytes += chunk.firstOffset - report.expectedOffset;
+    }
+    report.expectedOffset = chunk.endOffset;
+    report.records += chunk.records;
+    report.skippedBytes += chunk.skippedBytes;
+
+    for (const auto &[key, stats] : chunk.types) {
+        TypeStats &total = report.types[key];
+        total.frames += stats.frames;
+        total.payloadBytes += stats.payloadBytes;
+    }
+
+    for (auto &[key, stream] : chunk.streams) {
+        auto it = report.streams.find(key);
+        if (it == report.streams.end()) {
+            report.streams.emplace(key, std::move(stream));
+            continue;
+        }
+        Stream &total = it->second;
+        total.frames += stream.frames;
+        total.intervalsUs.push_back(stream.firstUs - total.lastUs);
+        total.intervalsUs.insert(total.intervalsUs.end(), stream.intervalsUs.begin(),
+                                 stream.intervalsUs.end());
+        total.lastUs = stream.lastUs;
+    }
+
+    for (const auto &[key, trace] : chunk.requests) {
+        auto carried = report.pending.find(key);
+        if (trace.headAnswer && carried != report.pending.end()) {
+            const uint64_t latency = trace.headAnswerUs - carried->second.sentUs;
+            if (latency <= options.latencyTimeoutUs) {
+                report.latenciesUs[carried->second.type].push_back(latency);
+            }
+        }
+        if (trace.pending) {
+            report.pending[key] = trace.last;
+        } else if (carried != report.pending.end()) {
+            report.pending.erase(carried);
+        }
+    }
+    for (auto &[type, samples] : chunk.latenciesUs) {
+        std::vector<uint64_t> &total = report.latenciesUs[type];
+        total.insert(total.end(), samples.begin(), samples.end());
+    }
+
+    for (auto &[key, unknown] : chunk.unknowns) {
+        Unknown &total = report.unknowns[key];
+        total.frames += unknown.frames;
+        for (const auto &[hash, payload] : unknown.payloads) {
+            PayloadCount &sum = total.payloads[hash];
+            // Chunks come in file order, so the earliest occurrence is kept.
+            if (sum.count == 0) {
+                sum.firstOffset = payload.firstOffset;
+            }
+            sum.count += payload.count;
+        }
+    }
+}
+
+struct Distribution {
+    size_t count = 0;
+    uint64_t min = 0;
+    uint64_t p50 = 0;
+    uint64_t p90 = 0;
+    uint64_t p99 = 0;
+    uint64_t max = 0;
+};
+
+Distribution distribution(std::vector<uint64_t> &samples) {
+    Distribution d;
+    d.count = samples.size();
+    if (samples.empty())
+        return d;
+    std::sort(samples.begin(), samples.end());
+    const auto at = [&samples](double q) {
+        return samples[static_cast<size_t>(q * static_cast<double>(samples.size() - 1))];
+    };
+    d.min = samples.front();
+    d.p50 = at(0.50);
+    d.p90 = at(0.90);
+    d.p99 = at(0.99);
+    d.max = samples.back();
+    return d;
+}
+
+// After the last merge: lists the most frequent payloads of each unknown
+// type, ties in file order, reading their bytes back from the capture.
+bool capPayloads(Report &report, const Options &options) {
+    std::ifstream file(options.path, std::ios::binary);
+    std::vector<uint8_t> buffer(capture::maxRecordSize);
+    capture::Record record;
+    for (auto &[key, unknown] : report.unknowns) {
+        std::vector<PayloadCount> top;
+        top.reserve(unknown.payloads.size());
+        for (const auto &[hash, payload] : unknown.payloads) {
+            top.push_back(payload);
+        }
+        const auto listed = top.begin() + static_cast<std::ptrdiff_t>(
+                                              std::min(options.maxPayloads, top.size()));
+        std::partial_sort(top.begin(), listed, top.end(),
+                          [](const PayloadCount &a, const PayloadCount &b) {
+                              return a.count != b.count ? a.count > b.count
+                                                        : a.firstOffset < b.firstOffset;
+                          });
+
+        unknown.distinctPayloads = unknown.payloads.size();
+        unknown.otherFrames = unknown.frames;
+        unknown.payloads.clear();
+        for (auto it = top.begin(); it != listed; ++it) {
+            file.clear();
+            file.seekg(static_cast<std::streamoff>(it->firstOffset));
+            file.read(reinterpret_cast<char *>(buffer.data()),
+                      static_cast<std::streamsize>(buffer.size()));
+            const size_t size = static_cast<size_t>(file.gcount());
+            if (capture::readRecord(buffer.data(), size, &record) == 0)
+                return false;
+            unknown.otherFrames -= it->count;
+            unknown.listed.push_back(
+                {hex(record.frame.payload, record.frame.payloadSize), it->count});
+        }
+    }
+    return true;
+}
+
+struct Summary {
+    std::map<TypeKey, Distribution> interArrival;
+    std::map<MessageType, Distribution> latency;
+};
+
+Summary summarize(Report &report) {
+    // Gaps are measured per device, then pooled per type.
+    std::map<TypeKey, std::vector<uint64_t>> intervals;
+    for (auto &[key, stream] : report.streams) {
+        std::vector<uint64_t> &pooled = intervals[{key.direction, key.type}];
+        pooled.insert(pooled.end(), stream.intervalsUs.begin(), stream.intervalsUs.end());
+    }
+    Summary summary;
+    for (auto &[key, samples] : intervals) {
+        if (!samples.empty()) {
+            summary.interArrival[key] = distribution(samples);
+        }
+    }
+    for (auto &[type, samples] : report.latenciesUs) {
+        summary.latency[type] = distribution(samples);
+    }
+    return summary;
+}
+
+void printDistribution(const char *label, const Distribution &d) {
+    std::printf("  %-44s %8zu %10.3f %10.3f %10.3f %10.3f %10.3f\n", label, d.count, d.min / 1e3,
+                d.p50 / 1e3, d.p90 / 1e3, d.p99 / 1e3, d.max / 1e3);
+}
+
+void printReport(const Report &report, const Summary &summary, const Options &options,
+                 double seconds) {
+    std::printf("%-28s %" PRIu64 "\n", "records", report.records);
+    std::printf("%-28s %" PRIu64 "\n", "skipped_bytes", report.skippedBytes);
+    std::printf("%-28s %" PRIu64 "\n", "resync_mismatches", report.resyncMismatches);
+    std::printf("%-28s %.3f\n", "capture_seconds", (report.lastUs - report.firstUs) / 1e6);
+    std::printf("%-28s %.3f\n", "analysis_seconds", seconds);
+
+    std::printf("\nFrames by type\n");
+    std::printf("  %-9s %-34s %10s %12s\n", "direction", "type", "frames", "payload_B");
+    for (const auto &[key, stats] : report.types) {
+        std::printf("  %-9s %-34s %10" PRIu64 " %12" PRIu64 "\n", directionName(key.direction),
+                    typeName(key.type).c_str(), stats.frames, stats.payloadBytes);
+    }
+
+    const char *header = "  %-44s %8s %10s %10s %10s %10s %10s\n";
+    std::printf("\nInter-arrival per device (ms)\n");
+    std::printf(header, "direction/type", "gaps", "min", "p50", "p90", "p99", "max");
+    for (const auto &[key, d] : summary.interArrival) {
+        const std::string label =
+            std::string(directionName(key.direction)) + " " + typeName(key.type);
+        printDistribution(label.c_str(), d);
+    }
+
+    std::printf("\nRequest to response latency (ms)\n");
+    std::printf(header, "request type", "answers", "min", "p50", "p90", "p99", "max");
+    for (const auto &[type, d] : summary.latency) {
+        printDistribution(typeName(type).c_str(), d);
+    }
+
+    std::printf("\nUnknown types\n");
+    for (const auto &[key, unknown] : report.unknowns) {
+        std::printf("  %s subsystem 0x%04X id 0x%04X: %" PRIu64 " frames, %zu distinct payloads\n",
+                    typeName(key.type).c_str(), static_cast<unsigned>(key.subsystem),
+                    static_cast<unsigned>(key.msgId), unknown.frames, unknown.distinctPayloads);
+        for (const ListedPayload &payload : unknown.listed) {
+            std::printf("    %8" PRIu64 "  %s\n", payload.count,
+                        payload.hex.empty() ? "-" : payload.hex.c_str());
+        }
+        if (unknown.otherFrames > 0) {
+            std::printf("    %8" PRIu64 "  (other payloads)\n", unknown.otherFrames);
+        }
+    }
+}
+
+void writeDistribution(std::FILE *out, const Distribution &d) {
+    std::fprintf(out,
+                 "{\"count\": %zu, \"min_us\": %" PRIu64 ", \"p50_us\": %" PRIu64
+                 ", \"p90_us\": %" PRIu64 ", \"p99_us\": %" PRIu64 ", \"max_us\": %" PRIu64 "}",
+                 d.count, d.min, d.p50, d.p90, d.p99, d.max);
+}
+
+void writeJson(std::FILE *out, const Report &report, const Summary &summary,
+               const Options &options) {
+    std::fprintf(out, "{\n  \"records\": %" PRIu64 ",\n", report.records);
+    std::fprintf(out, "  \"skipped_bytes\": %" PRIu64 ",\n", report.skippedBytes);
+    std::fprintf(out, "  \"resync_mismatches\": %" PRIu64 ",\n", report.resyncMismatches);
+    std::fprintf(out, "  \"first_us\": %" PRIu64 ",\n  \"last_us\": %" PRIu64 ",\n",
+                 report.firstUs, report.lastUs);
+
+    std::fprintf(out, "  \"types\": [");
+    const char *separator = "\n";
+    for (const auto &[key, stats] : report.types) {
+        const auto it = summary.interArrival.find(key);
+        std::fprintf(out,
+                     "%s    {\"direction\": \"%s\", \"type\": %" PRIu32 ", \"name\": \"%s\", "
+                     "\"frames\": %" PRIu64 ", \"payload_bytes\": %" PRIu64
+                     ", \"inter_arrival\": ",
+                     separator, directionName(key.direction), static_cast<uint32_t>(key.type),
+                     typeName(key.type).c_str(), stats.frames, stats.payloadBytes);
+        writeDistribution(out, it != summary.interArrival.end() ? it->second : Distribution());
+        std::fprintf(out, "}");
+        separator = ",\n";
+    }
+
+    std::fprintf(out, "\n  ],\n  \"latency\": [");
+    separator = "\n";
+    for (const auto &[type, d] : summary.latency) {
+        std::fprintf(out, "%s    {\"type\": %" PRIu32 ", \"name\": \"%s\", \"latency\": ",
+                     separator, static_cast<uint32_t>(type), typeName(type).c_str());
+        writeDistribution(out, d);
+        std::fprintf(out, "}");
+        separator = ",\n";
+    }
+
+    std::fprintf(out, "\n  ],\n  \"unknown\": [");
+    separator = "\n";
+    for (const auto &[key, unknown] : report.unknowns) {
+        std::fprintf(out,
+                     "%s    {\"subsystem\": %u, \"msg_id\": %u, \"type\": %" PRIu32
+                     ", \"frames\": %" PRIu64 ", \"distinct_payloads\": %zu"
+                     ", \"other_payload_frames\": %" PRIu64 ", \"payloads\": [",
+                     separator, static_cast<unsigned>(key.subsystem),
+                     static_cast<unsigned>(key.msgId), static_cast<uint32_t>(key.type),
+                     unknown.frames, unknown.distinctPayloads, unknown.otherFrames);
+        const char *payloadSeparator = "";
+        for (const ListedPayload &payload : unknown.listed) {
+            std::fprintf(out, "%s{\"hex\": \"%s\", \"count\": %" PRIu64 "}", payloadSeparator,
+                         payload.hex.c_str(), payload.count);
+            payloadSeparator = ", ";
+        }
+        std::fprintf(out, "]}");
+        separator = ",\n";
+    }
+    std::fprintf(out, "\n  ]\n}\n");
+}
+
+void usage() {
+    std::fprintf(stderr,
+                 "Usage: dji_capture_analyze [options] <capture>\n"
+                 "  --threads <n>        Decoding threads (default: all cores)\n"
+                 "  --chunk-mb <n>       Chunk size in MiB (default: spread over the threads)\n"
+                 "  --max-payloads <n>   Payloads listed per unknown type (default: 16)\n"
+                 "  --latency-timeout-ms <n>  Longest request-to-response match (default: 10000)\n"
+                 "  --json <file|->      Also write the report as JSON\n");
+}
+
+bool parseArguments(int argc, char **argv, Options *options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--threads" && hasValue) {
+            options->threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--chunk-mb" && hasValue) {
+            options->chunkBytes = std::strtoull(argv[++i], nullptr, 10) << 20;
+        } else if (arg == "--max-payloads" && hasValue) {
+            options->maxPayloads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--latency-timeout-ms" && hasValue) {
+            options->latencyTimeoutUs = std::strtoull(argv[++i], nullptr, 10) * 1000;
+        } else if (arg == "--json" && hasValue) {
+            options->jsonPath = argv[++i];
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            return false;
+        } else if (options->path.empty()) {
+            options->path = arg;
+        } else {
+            return false;
+        }
+    }
+    return !options->path.empty();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseArguments(argc, argv, &options)) {
+        usage();
+        return 2;
+    }
+
+    std::ifstream file(options.path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        std::fprintf(stderr, "Cannot read %s\n", options.path.c_str());
+        return 1;
+    }
+    const auto fileSize = static_cast<uint64_t>(file.tellg());
+    uint8_t magic[capture::magicSize] = {};
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(magic), sizeof(magic));
+    if (!capture::hasMagic(magic, static_cast<size_t>(file.gcount()))) {
+        std::fprintf(stderr, "%s is not a capture\n", options.path.c_str());
+        return 1;
+    }
+    file.close();
+
+    if (options.threads == 0) {
+        options.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const uint64_t dataSize = fileSize - capture::magicSize;
+    if (options.chunkBytes == 0) {
+        // A few chunks per thread evens out chunks that decode slower.
+        options.chunkBytes = std::max<uint64_t>(dataSize / (4 * options.threads) + 1, 1 << 20);
+    }
+    const size_t chunkCount =
+        std::max<uint64_t>(1, (dataSize + options.chunkBytes - 1) / options.chunkBytes);
+
+    const auto started = std::chrono::steady_clock::now();
+    std::vector<ChunkResult> chunks(chunkCount);
+    std::atomic<size_t> nextChunk{0};
+    const auto worker = [&]() {
+        std::vector<uint8_t> buffer;
+        for (size_t i = nextChunk++; i < chunkCount; i = nextChunk++) {
+            const uint64_t begin = capture::magicSize + i * options.chunkBytes;
+            const uint64_t end = std::min(fileSize, begin + options.chunkBytes);
+            analyzeChunk(options, begin, end, fileSize, buffer, chunks[i]);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < std::min<size_t>(options.threads, chunkCount); ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    Report report;
+    for (ChunkResult &chunk : chunks) {
+        merge(report, chunk, options);
+        chunk = ChunkResult();
+    }
+    report.skippedBytes += fileSize - std::min(fileSize, report.expectedOffset);
+    if (!capPayloads(report, options)) {
+        std::fprintf(stderr, "Cannot read %s\n", options.path.c_str());
+        return 1;
+    }
+    if (!report.streams.empty()) {
+        report.firstUs = UINT64_MAX;
+        for (const auto &[key, stream] : report.streams) {
+            report.firstUs = std::min(report.firstUs, stream.firstUs);
+            report.lastUs = std::max(report.lastUs, stream.lastUs);
+        }
+    }
+    const Summary summary = summarize(report);
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    // JSON on stdout replaces the text report.
+    if (options.jsonPath != "-") {
+        printReport(report, summary, options, seconds);
+    }
+    if (!options.jsonPath.empty()) {
+        std::FILE *out =
+            options.jsonPath == "-" ? stdout : std::fopen(options.jsonPath.c_str(), "w");
+        if (!out) {
+            std::fprintf(stderr, "Cannot write %s\n", options.jsonPath.c_str());
+            return 1;
+        }
+        writeJson(out, report, summary, options);
+        if (out != stdout) {
+            std::fclose(out);
+        }
+    }
+    return 0;
+}